@@ -0,0 +1,108 @@
+#!/bin/sh
+# Copyright 2025 Rishit Sharma
+# Licensed under the Apache License, Version 2.0
+#
+# Reproduces the figures quoted in commit messages and the README.
+#
+#   bench/reproduce.sh [SECTION...]    (default: every section)
+#
+# Sections:
+#   beacons   netsim, fixed vs. adaptive HELLO timing
+#   control   netsim, HELLO + ACKs vs. one aggregated CONTROL frame per beacon
+#   codec     wire codec round trip, then header encode/decode vs. memcpy (ns/op)
+#   trace     cost of the trace hooks: disabled (RemoveOld/10-fresh) and enabled
+#             (SendPacket/buffer vs. /traced). BASE=REV and TIP=REV add the same
+#             run on committed trees; the commit figures are BASE=27682bd
+#             (before tracing) against TIP=ca5725a (tracing added)
+#
+# Run from the repository root. Binaries are built into $OUT (default _repro).
+# netsim runs are deterministic for a seed; timings vary with the machine.
+set -e
+
+CXX=${CXX:-g++}
+OUT=${OUT:-_repro}
+mkdir -p "$OUT"
+
+netsim() {
+    if [ ! -x "$OUT/netsim" ]; then
+        $CXX -std=c++17 -O2 -I src examples/netsim/*.cpp src/*.cpp -o "$OUT/netsim" -lpthread
+    fi
+    "$OUT/netsim" "$@"
+}
+
+build() {
+    # build NAME SOURCE: one binary over every source file, once per run directory
+    if [ ! -x "$OUT/$1" ]; then
+        $CXX -std=c++17 -O2 -I src "$2" src/*.cpp -o "$OUT/$1" -lpthread
+    fi
+}
+
+# "label: N control frames, delivery R" from one csv row
+control_frames() {
+    label=$1
+    shift
+    netsim "$@" --format csv | awk -F, -v label="$label" '{ printf "%-28s %10d control frames, delivery %s\n", label, $14, $6 }'
+}
+
+beacons() {
+    echo "== beacons: 1000 nodes, 300 s, fixed vs. adaptive HELLO timing"
+    for mobility in rwp crowd; do
+        control_frames "$mobility fixed" --nodes 1000 --duration-s 300 --mobility $mobility --beacon-mode fixed
+        control_frames "$mobility adaptive" --nodes 1000 --duration-s 300 --mobility $mobility --beacon-mode adaptive
+    done
+}
+
+control() {
+    echo "== control: 1000 nodes, 300 s, HELLO + ACKs vs. aggregated CONTROL frames"
+    for mobility in rwp crowd; do
+        control_frames "$mobility hello" --nodes 1000 --duration-s 300 --mobility $mobility --control hello
+        control_frames "$mobility aggregate" --nodes 1000 --duration-s 300 --mobility $mobility --control aggregate
+    done
+}
+
+codec() {
+    echo "== codec: round trip, then Header/* ns/op"
+    build wire_roundtrip tests/wire_roundtrip.cpp
+    build thor_bench bench/thor_bench.cpp
+    "$OUT/wire_roundtrip"
+    "$OUT/thor_bench" --filter Header/ --min-time-ms 500
+}
+
+bench_at() {
+    # bench_at REV: thor_bench from a committed tree, into $OUT/thor_bench_REV
+    rm -rf "$OUT/tree_$1"
+    mkdir -p "$OUT/tree_$1"
+    git archive "$1" src bench | tar -x -C "$OUT/tree_$1"
+    $CXX -std=c++17 -O2 -I "$OUT/tree_$1/src" "$OUT/tree_$1/bench/thor_bench.cpp" "$OUT/tree_$1"/src/*.cpp \
+        -o "$OUT/thor_bench_$1" -lpthread
+}
+
+trace_figures() {
+    # trace_figures BINARY: the three rows under one header
+    "$1" --filter RemoveOld/10-fresh --min-time-ms 500
+    "$1" --filter SendPacket/buffer --min-time-ms 500 | tail -n +2
+    "$1" --filter SendPacket/traced --min-time-ms 500 | tail -n +2
+}
+
+trace() {
+    echo "== trace: RemoveOld/10-fresh, SendPacket/buffer and /traced ns/op"
+    for rev in $BASE $TIP; do
+        bench_at "$rev"
+        echo "-- $rev"
+        trace_figures "$OUT/thor_bench_$rev"
+    done
+    build thor_bench bench/thor_bench.cpp
+    echo "-- working tree"
+    trace_figures "$OUT/thor_bench"
+}
+
+[ $# -eq 0 ] && set -- beacons control codec trace
+for section in "$@"; do
+    case $section in
+        beacons) beacons ;;
+        control) control ;;
+        codec) codec ;;
+        trace) trace ;;
+        *) echo "unknown section: $section" >&2; exit 1 ;;
+    esac
+done
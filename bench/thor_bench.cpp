@@ -0,0 +1,578 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * Microbenchmarks for the THOR hot paths.
+ *
+ *   thor_bench [--format text|csv|json] [--filter SUBSTRING] [--min-time-ms MS]
+ *
+ * Reports ns/op and heap allocations/op (global operator new is counted in this
+ * binary). Both the vector API and the zero-copy buffer API are measured, so the
+ * output shows where allocations come from.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "THOR.h"
+#include "ScoreKernel.h"
+#include "WireCodec.h"
+
+// ---------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------
+
+namespace {
+    uint64_t allocCount = 0;
+    uint64_t allocBytes = 0;
+}
+
+void* operator new(size_t size)
+{
+    ++allocCount;
+    allocBytes += size;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+    // Keeps the compiler from discarding a result
+    template <typename T>
+    inline void Keep(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        volatile const T* sink = &value;
+        (void)sink;
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        double nsPerOp;
+        double allocsPerOp;
+        double bytesPerOp;
+    };
+
+    struct Options {
+        std::string format = "text";
+        std::string filter;
+        double minTimeMs = 200.0;
+    };
+
+    Options options;
+    std::vector<Result> results;
+
+    bool Selected(const std::string& name)
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    // Runs body(n) (n operations, timed) after setup(n) (untimed), growing n until
+    // the timed part takes at least --min-time-ms. maxBatch caps n for bodies whose
+    // state runs out (e.g. a queue that only holds so many packets).
+    template <typename Setup, typename Body>
+    void Measure(const std::string& name, uint64_t maxBatch, Setup setup, Body body)
+    {
+        if (!Selected(name)) {
+            return;
+        }
+        typedef std::chrono::steady_clock Clock;
+        uint64_t batch = 1;
+        // Warm-up, also sizes the batch to about 1 ms
+        while (true) {
+            setup(batch);
+            Clock::time_point start = Clock::now();
+            body(batch);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (ms >= 1.0 || batch >= maxBatch) {
+                break;
+            }
+            batch = std::min(maxBatch, batch * 2);
+        }
+
+        uint64_t iterations = 0;
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+        double elapsedNs = 0.0;
+        while (elapsedNs < options.minTimeMs * 1e6) {
+            setup(batch);
+            uint64_t allocsBefore = allocCount;
+            uint64_t bytesBefore = allocBytes;
+            Clock::time_point start = Clock::now();
+            body(batch);
+            Clock::time_point end = Clock::now();
+            allocs += allocCount - allocsBefore;
+            bytes += allocBytes - bytesBefore;
+            elapsedNs += std::chrono::duration<double, std::nano>(end - start).count();
+            iterations += batch;
+        }
+        results.push_back({ name, iterations, elapsedNs / iterations,
+                            static_cast<double>(allocs) / iterations, static_cast<double>(bytes) / iterations });
+    }
+
+    void NoSetup(uint64_t) {}
+
+    // Neighbor ids 1..count, mixed tiers and RSSI bands so scoring has real work
+    void AddNeighbors(THOR& node, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t id = static_cast<uint32_t>(i + 1);
+            int rssi = -40 - static_cast<int>((i * 7) % 60);
+            node.NeighborStore(id, rssi, i % 17 == 0, i % 5 == 0, false);
+        }
+    }
+
+    Header DataHeader(uint32_t sequence)
+    {
+        Header header = {};
+        header.type = THORPacketType::DATA;
+        header.flagsAndTTL.ttl = 15;
+        header.destinationId = 0xFFFFFFFE;
+        header.senderId = 7;
+        header.originId = 7;
+        header.nextHopId = 100;
+        header.sequence = sequence;
+        return header;
+    }
+
+    const size_t PAYLOAD = 16;
+
+    // ---------------------------------------------------------------
+
+    void BenchCodec()
+    {
+        THOR node;
+        Packet packet;
+        packet.header = DataHeader(1);
+        packet.payload.assign(PAYLOAD, 0x42);
+        std::vector<uint8_t> wire = node.Serialize(packet);
+        uint8_t buffer[64];
+
+        uint8_t wireHeader[WIRE_HEADER_SIZE];
+        EncodeHeader(packet.header, wireHeader);
+        Measure("Header/encode", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            Header header = packet.header;
+            for (uint64_t i = 0; i < n; ++i) {
+                header.sequence = static_cast<uint32_t>(i);
+                EncodeHeader(header, buffer);
+                Keep(buffer);
+            }
+        });
+        Measure("Header/decode", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                Keep(wireHeader);
+                Header header;
+                DecodeHeader(wireHeader, header);
+                Keep(header);
+            }
+        });
+        // The host-layout copy the codec replaced, for comparison
+        Measure("Header/memcpy", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                Keep(wireHeader);
+                Header header;
+                std::memcpy(&header, wireHeader, sizeof(Header));
+                Keep(header);
+            }
+        });
+        Measure("Serialize/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> out = node.Serialize(packet);
+                Keep(out);
+            }
+        });
+        Measure("Serialize/buffer", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = node.Serialize(packet.header, packet.payload.data(), packet.payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+                Keep(buffer);
+            }
+        });
+        Measure("Deserialize/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                Packet out;
+                bool ok = node.Deserialize(wire, out);
+                Keep(ok);
+                Keep(out);
+            }
+        });
+        Measure("Deserialize/view", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                PacketView view;
+                bool ok = node.Deserialize(wire.data(), wire.size(), view);
+                Keep(ok);
+                Keep(view);
+            }
+        });
+        THORConfig compactConfig;
+        compactConfig.compactHeaders = true;
+        THOR compactNode(compactConfig);
+        std::vector<uint8_t> compactWire = compactNode.Serialize(packet);
+        Measure("Serialize/compact", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = compactNode.Serialize(packet.header, packet.payload.data(), packet.payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+                Keep(buffer);
+            }
+        });
+        Measure("Deserialize/compact", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                PacketView view;
+                bool ok = node.Deserialize(compactWire.data(), compactWire.size(), view);
+                Keep(ok);
+                Keep(view);
+            }
+        });
+        Measure("CreateHello/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> out = node.CreateHello(BROADCAST_ID, 7, 7, static_cast<uint32_t>(i));
+                Keep(out);
+            }
+        });
+        Measure("CreateHello/buffer", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = node.CreateHello(BROADCAST_ID, 7, 7, static_cast<uint32_t>(i), buffer, sizeof(buffer));
+                Keep(size);
+                Keep(buffer);
+            }
+        });
+        Measure("CreateACK/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> out = node.CreateACK(8, 7, 7, 8, static_cast<uint32_t>(i), true, false);
+                Keep(out);
+            }
+        });
+        Measure("CreateACK/buffer", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = node.CreateACK(8, 7, 7, 8, static_cast<uint32_t>(i), true, false, buffer, sizeof(buffer));
+                Keep(size);
+                Keep(buffer);
+            }
+        });
+    }
+
+    void BenchSendAndReceive()
+    {
+        std::vector<uint8_t> payload(PAYLOAD, 0x42);
+        uint8_t buffer[64];
+
+        // Route available: the packet is written straight out
+        THOR sender;
+        AddNeighbors(sender, 100);
+        uint32_t sequence = 0;
+        Measure("SendPacket/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> out = sender.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload);
+                Keep(out);
+            }
+        });
+        Measure("SendPacket/buffer", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = sender.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+        // Routed frame handed to a transmit sink instead of a caller buffer
+        THOR pushing;
+        AddNeighbors(pushing, 100);
+        size_t sunk = 0;
+        pushing.SetTransmitSink([&sunk](const FrameView& frame, uint32_t) {
+            sunk += frame.size;
+            return true;
+        });
+        Measure("SendPacket/sink", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                THORVerdict verdict = pushing.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size());
+                Keep(verdict);
+            }
+        });
+        Keep(sunk);
+        // Same as SendPacket/buffer with the I/O trace on (in-memory ring, oldest records overwritten)
+        THORConfig tracedConfig;
+        tracedConfig.traceBytes = 1 << 20;
+        THOR traced(tracedConfig);
+        AddNeighbors(traced, 100);
+        Measure("SendPacket/traced", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = traced.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+
+        // No route: the packet goes to the store-and-forward queue (full queue evicts)
+        THOR isolated;
+        Measure("SendPacket/queued", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t size = isolated.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+        // Same with a lifetime on every packet: each push also expires what came due
+        uint64_t virtualMs = 0;
+        THORConfig timedConfig;
+        timedConfig.queueLifetimeMs = 1000;
+        timedConfig.clock = [&virtualMs] { return virtualMs; };
+        THOR timed(timedConfig);
+        Measure("SendPacket/queued-lifetime", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                virtualMs += 50; // 20 packets live at a time
+                size_t size = timed.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size(), buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+        // Latest-value-wins beacons from 50 origins in a full queue
+        THOR beacons;
+        QueueOptions latest;
+        latest.supersede = 1;
+        Measure("SendPacket/superseding", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                uint32_t origin = 1 + static_cast<uint32_t>(i % 50);
+                size_t size = beacons.SendPacket(0xFFFFFFFE, origin, origin, ++sequence, payload.data(), payload.size(), latest, buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+
+        // Relay with 100 neighbors forwarding fresh packets (unique sequence numbers)
+        THOR relay;
+        AddNeighbors(relay, 100);
+        std::vector<uint8_t> frame(sizeof(Header) + PAYLOAD, 0x42);
+        Measure("HandleData/vector", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                Header header = DataHeader(++sequence);
+                EncodeHeader(header, frame.data());
+                Packet out;
+                std::vector<uint8_t> forwarded = relay.HandleData(frame, out, 200);
+                Keep(forwarded);
+            }
+        });
+        Measure("HandleData/buffer", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                Header header = DataHeader(++sequence);
+                EncodeHeader(header, frame.data());
+                PacketView view;
+                size_t size = relay.HandleData(frame.data(), frame.size(), view, 200, buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+        // Replays of one frame: dropped by duplicate suppression before routing
+        Measure("HandleData/duplicate", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            Header header = DataHeader(1);
+            EncodeHeader(header, frame.data());
+            for (uint64_t i = 0; i < n; ++i) {
+                PacketView view;
+                size_t size = relay.HandleData(frame.data(), frame.size(), view, 200, buffer, sizeof(buffer));
+                Keep(size);
+            }
+        });
+    }
+
+    void BenchNeighbors()
+    {
+        const size_t sizes[] = { 10, 100, 1000 };
+        for (size_t count : sizes) {
+            THOR node;
+            AddNeighbors(node, count);
+            Measure("GetBestNextHop/" + std::to_string(count), UINT64_MAX, NoSetup, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    uint32_t hop = node.GetBestNextHop();
+                    Keep(hop);
+                }
+            });
+        }
+        // Budgeted forwarding, half the battery gone: the best few are weighed by link cost
+        THORConfig budgetedConfig;
+        budgetedConfig.energy.budgeted = true;
+        THOR budgeted(budgetedConfig);
+        AddNeighbors(budgeted, 100);
+        budgeted.SetEnergyBudget(500000000, 1000000000);
+        Measure("GetBestNextHop/budgeted-100", UINT64_MAX, NoSetup, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                uint32_t hop = budgeted.GetBestNextHop();
+                Keep(hop);
+            }
+        });
+
+        // Nothing due: the common case on a maintenance timer
+        for (size_t count : sizes) {
+            uint64_t now = 0;
+            THORConfig config;
+            config.clock = [&now]() { return now; };
+            THOR node(config);
+            AddNeighbors(node, count);
+            Measure("RemoveOld/" + std::to_string(count) + "-fresh", UINT64_MAX, NoSetup, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    ++now;
+                    node.RemoveOld();
+                }
+            });
+        }
+
+        // Whole table times out at once; ns/op is per RemoveOld call
+        for (size_t count : sizes) {
+            uint64_t now = 0;
+            THORConfig config;
+            config.clock = [&now]() { return now; };
+            THOR node(config);
+            Measure("RemoveOld/" + std::to_string(count) + "-expire", 1,
+                [&](uint64_t) {
+                    AddNeighbors(node, count);
+                    now += config.neighborTimeoutMs + 1000;
+                },
+                [&](uint64_t) { node.RemoveOld(); });
+        }
+    }
+
+    void BenchQueue()
+    {
+        std::vector<uint8_t> payload(PAYLOAD, 0x42);
+        uint8_t buffer[64];
+        THORConfig config;
+        const size_t fills[] = { 0, config.queueCapacity / 2, config.queueCapacity };
+        const char* labels[] = { "empty", "half", "full" };
+
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t sequence = 0;
+            uint64_t now = 0;
+            config.clock = [&now]() { return now; };
+            THOR node(config);
+            std::vector<FrameView> views;
+            views.reserve(config.queueCapacity);
+
+            // Refill while nobody is in range, then let one neighbor appear
+            auto fill = [&](uint64_t) {
+                now += config.neighborTimeoutMs + 1000;
+                node.RemoveOld();
+                for (size_t i = 0; i < fills[k]; ++i) {
+                    node.SendPacket(0xFFFFFFFE, 7, 7, ++sequence, payload.data(), payload.size(), buffer, sizeof(buffer));
+                }
+                node.NeighborStore(100, -60, false, true, false);
+            };
+            Measure(std::string("ProcessQueue/vector-") + labels[k], 1, fill, [&](uint64_t) {
+                std::vector<std::vector<uint8_t>> out = node.ProcessQueue();
+                Keep(out);
+            });
+            Measure(std::string("ProcessQueue/view-") + labels[k], 1, fill, [&](uint64_t) {
+                size_t count = node.ProcessQueue(views);
+                Keep(count);
+            });
+            // Same drain pushed into a sink (installed after the fill, so NeighborStore does not flush)
+            size_t sunk = 0;
+            TransmitSink sink = [&sunk](const FrameView& frame, uint32_t) {
+                sunk += frame.size;
+                return true;
+            };
+            auto fillForSink = [&](uint64_t batch) {
+                node.SetTransmitSink(nullptr);
+                fill(batch);
+                node.SetTransmitSink(sink);
+            };
+            Measure(std::string("Flush/sink-") + labels[k], 1, fillForSink, [&](uint64_t) {
+                size_t count = node.Flush();
+                Keep(count);
+            });
+            Keep(sunk);
+        }
+    }
+
+    // Bulk rescoring (policy switch) and the full-scan argmax, kernel vs. scalar loop
+    void BenchScoring()
+    {
+        const size_t sizes[] = { 100, 500, 1000 };
+        RoutingPolicy policy;
+        for (size_t count : sizes) {
+            std::vector<uint8_t> flags(count);
+            std::vector<int8_t> rssi(count);
+            std::vector<int> scores(count);
+            for (size_t i = 0; i < count; ++i) {
+                flags[i] = static_cast<uint8_t>((i % 17 == 0 ? NEIGHBOR_INTERNET_DIRECT : 0) | (i % 5 == 0 ? NEIGHBOR_INTERNET_INDIRECT : 0));
+                rssi[i] = static_cast<int8_t>(-40 - static_cast<int>((i * 7) % 60));
+            }
+            std::string suffix = std::to_string(count);
+            Measure("ScoreBatch/scalar-" + suffix, UINT64_MAX, NoSetup, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    for (size_t row = 0; row < count; ++row) {
+                        scores[row] = RuntimePolicyScorer(policy, flags[row], rssi[row]);
+                    }
+                    Keep(scores[i % count]);
+                }
+            });
+            Measure(std::string("ScoreBatch/") + ScoreKernelName() + "-" + suffix, UINT64_MAX, NoSetup, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    ScoreNeighborsBatch(policy, flags.data(), rssi.data(), count, scores.data());
+                    Keep(scores[i % count]);
+                }
+            });
+        }
+    }
+
+    // ---------------------------------------------------------------
+
+    void Print()
+    {
+        if (options.format == "json") {
+            std::printf("{\"benchmarks\":[");
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Result& r = results[i];
+                std::printf("%s\n  {\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}",
+                            i ? "," : "", r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+            }
+            std::printf("\n]}\n");
+            return;
+        }
+        if (options.format == "csv") {
+            std::printf("name,iterations,ns_per_op,allocs_per_op,bytes_per_op\n");
+            for (const Result& r : results) {
+                std::printf("%s,%llu,%.2f,%.3f,%.1f\n", r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+                            r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+            }
+            return;
+        }
+        std::printf("%-28s %12s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+        for (const Result& r : results) {
+            std::printf("%-28s %12llu %12.2f %10.3f %10.1f\n", r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+                        r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Usage: thor_bench [--format text|csv|json] [--filter SUBSTRING] [--min-time-ms MS]\n");
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--format") {
+            options.format = value;
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--min-time-ms") {
+            options.minTimeMs = std::atof(value);
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    BenchCodec();
+    BenchSendAndReceive();
+    BenchNeighbors();
+    BenchScoring();
+    BenchQueue();
+    Print();
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * Replays an I/O trace recorded with THORConfig::traceFile.
+ *
+ *   thor_replay TRACE [--repeat N]
+ *
+ * The trace is fed into a fresh THOR once with verification (every output the
+ * recording holds must come out again, byte for byte), then N more times at full
+ * speed without tracing to time the core on real traffic. Exits with status 1 on
+ * a mismatch, 2 if the file cannot be read as a trace.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "TraceReplay.h"
+
+namespace {
+    bool ReadFile(const char* path, std::vector<uint8_t>& out)
+    {
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        uint8_t chunk[64 * 1024];
+        size_t got = 0;
+        while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            out.insert(out.end(), chunk, chunk + got);
+        }
+        bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    long repeat = 10;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::atol(argv[++i]);
+        } else if (path == nullptr && arg.compare(0, 2, "--") != 0) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr) {
+        std::fprintf(stderr, "Usage: thor_replay TRACE [--repeat N]\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> trace;
+    ReplayResult result;
+    if (!ReadFile(path, trace) || !ReplayTrace(trace.data(), trace.size(), true, result)) {
+        std::fprintf(stderr, "%s: not a THOR trace\n", path);
+        return 2;
+    }
+    std::printf("%s: %llu bytes, %llu inputs, %llu outputs%s\n", path, static_cast<unsigned long long>(trace.size()),
+                static_cast<unsigned long long>(result.inputs), static_cast<unsigned long long>(result.outputs),
+                result.truncated ? " (truncated)" : "");
+    if (result.skipped != 0) {
+        std::printf("skipped %llu inputs of unknown kind\n", static_cast<unsigned long long>(result.skipped));
+    }
+    if (result.mismatches != 0) {
+        std::printf("MISMATCH: %llu outputs differ, first at input %llu\n", static_cast<unsigned long long>(result.mismatches),
+                    static_cast<unsigned long long>(result.firstMismatch));
+        return 1;
+    }
+    std::printf("replay matches the recording\n");
+
+    if (repeat > 0 && result.inputs > 0) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < repeat; ++i) {
+            ReplayTrace(trace.data(), trace.size(), false, result);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double calls = static_cast<double>(result.inputs) * static_cast<double>(repeat);
+        std::printf("full speed: %.1f ns/input, %.0f inputs/s (%ld runs)\n", seconds * 1e9 / calls, calls / seconds, repeat);
+    }
+    return 0;
+}
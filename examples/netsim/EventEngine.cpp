@@ -0,0 +1,409 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "NetSim.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+
+namespace {
+    const size_t FRAME_BUFFER = 600; // Header + largest payload the nodes accept
+
+    enum class EventType : uint8_t {
+        MOBILITY = 1, // Move everyone, rebuild the grid, sample queues
+        BEACON   = 2, // One node sends HELLO and drains its queue
+        TRAFFIC  = 3, // One node originates a message
+        FRAME    = 4  // A DATA frame arrives at its next hop
+    };
+
+    struct Event {
+        uint64_t timeMs;
+        uint64_t seq;      // Insertion order, breaks ties deterministically
+        EventType type;
+        uint32_t node;     // Index, not id
+        uint32_t frame;    // FRAME: slot in the frame pool
+    };
+
+    struct EventLater {
+        bool operator()(const Event& a, const Event& b) const
+        {
+            return a.timeMs > b.timeMs || (a.timeMs == b.timeMs && a.seq > b.seq);
+        }
+    };
+
+    struct Node {
+        std::unique_ptr<THOR> thor;
+        bool gateway;
+        uint64_t gatewaySeenMs;   // Last time a gateway answered our HELLO or announced itself (UINT64_MAX = never)
+        uint64_t nextBeaconMs;    // Earlier BEACON events are stale (adaptive timing moved them)
+        uint32_t sequence;
+        SimRng rng;
+    };
+
+    class EventSimulation
+    {
+    public:
+        explicit EventSimulation(const SimConfig& cfg)
+            : config(cfg), radio(cfg), rootRng({ cfg.seed }), mobility(cfg, rootRng),
+              grid(cfg.worldSize, radio.MaxRange()), now(0), nextSeq(0)
+        {
+            maxRange2 = radio.MaxRange() * radio.MaxRange();
+            trafficEndMs = (config.durationMs > config.cooldownMs) ? config.durationMs - config.cooldownMs : 0;
+
+            THORConfig nodeConfig = config.node;
+            nodeConfig.clock = [this]() { return now; };
+            if (config.adaptiveBeacon) {
+                nodeConfig.beacon.minIntervalMs = std::max<uint64_t>(config.beaconMs / 4, 1);
+            }
+
+            nodes.resize(config.nodes);
+            motion.resize(config.nodes);
+            size_t gateways = static_cast<size_t>(std::lround(config.gatewayRatio * config.nodes));
+            for (size_t i = 0; i < config.nodes; ++i) {
+                Node& node = nodes[i];
+                node.thor.reset(new THOR(nodeConfig));
+                if (config.batteryJ > 0.0) {
+                    uint64_t battery = static_cast<uint64_t>(config.batteryJ * 1e9);
+                    node.thor->SetEnergyBudget(battery, battery);
+                }
+                // Spread gateways evenly over the index range (positions are random anyway)
+                node.gateway = gateways > 0 && (i * gateways) / config.nodes != ((i + 1) * gateways) / config.nodes;
+                node.gatewaySeenMs = UINT64_MAX;
+                node.sequence = 0;
+                node.rng.state = config.seed * 0x9E3779B97F4A7C15ull + i + 1;
+                mobility.Init(motion[i], node.rng);
+            }
+            grid.Rebuild(motion);
+        }
+
+        SimReport Run()
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            Schedule(0, EventType::MOBILITY, 0, 0);
+            for (uint32_t i = 0; i < nodes.size(); ++i) {
+                if (!nodes[i].gateway) {
+                    ScheduleBeacon(i, nodes[i].rng.Next() % config.beaconMs);
+                    Schedule(NextTrafficDelay(nodes[i]), EventType::TRAFFIC, i, 0);
+                } else if (config.aggregateControl) {
+                    ScheduleBeacon(i, nodes[i].rng.Next() % config.beaconMs); // Nobody asks, so announce
+                }
+            }
+
+            while (!events.empty() && events.top().timeMs <= config.durationMs) {
+                Event event = events.top();
+                events.pop();
+                now = event.timeMs;
+                ++report.events;
+
+                switch (event.type) {
+                case EventType::MOBILITY: OnMobility(); break;
+                case EventType::BEACON:   OnBeacon(event.node); break;
+                case EventType::TRAFFIC:  OnTraffic(event.node); break;
+                case EventType::FRAME:    OnFrame(event.node, event.frame); break;
+                }
+            }
+            for (const Node& node : nodes) {
+                const EnergyStats& energy = node.thor->GetEnergyStats();
+                report.energyJ += static_cast<double>(energy.txNj + energy.rxNj) * 1e-9;
+                report.held += energy.held;
+            }
+            report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return report;
+        }
+
+    private:
+        static uint32_t IdOf(uint32_t index) { return index + 1; }
+
+        void Schedule(uint64_t timeMs, EventType type, uint32_t node, uint32_t frame)
+        {
+            events.push({ timeMs, nextSeq++, type, node, frame });
+        }
+
+        void ScheduleBeacon(uint32_t i, uint64_t timeMs)
+        {
+            nodes[i].nextBeaconMs = timeMs;
+            Schedule(timeMs, EventType::BEACON, i, 0);
+        }
+
+        // Adaptive timing: queued data may have made a HELLO due sooner
+        void RearmBeacon(uint32_t i)
+        {
+            if (!config.adaptiveBeacon) {
+                return;
+            }
+            uint64_t due = std::max(now, nodes[i].thor->NextHelloAt());
+            if (due < nodes[i].nextBeaconMs) {
+                ScheduleBeacon(i, due);
+            }
+        }
+
+        uint64_t NextTrafficDelay(Node& node)
+        {
+            // Exponential inter-arrival (Poisson traffic per node)
+            double u = node.rng.Uniform();
+            return 1 + static_cast<uint64_t>(-std::log(1.0 - u) * static_cast<double>(config.trafficMs));
+        }
+
+        bool Link(uint32_t a, uint32_t b, int& outRssi) const
+        {
+            double dx = motion[a].pos.x - motion[b].pos.x;
+            double dy = motion[a].pos.y - motion[b].pos.y;
+            double d2 = dx * dx + dy * dy;
+            if (d2 > maxRange2) {
+                return false;
+            }
+            return radio.Rssi(IdOf(a), IdOf(b), std::sqrt(d2), outRssi);
+        }
+
+        bool HeardGateway(const Node& node) const
+        {
+            return node.gatewaySeenMs != UINT64_MAX && now - node.gatewaySeenMs <= config.node.neighborTimeoutMs;
+        }
+
+        void OnMobility()
+        {
+            double dtS = static_cast<double>(config.mobilityStepMs) / 1000.0;
+            mobility.StepClusters(now, dtS, rootRng);
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                mobility.Step(motion[i], now, dtS, nodes[i].rng);
+            }
+            grid.Rebuild(motion);
+
+            for (const Node& node : nodes) {
+                if (node.gateway) continue;
+                size_t queued = node.thor->QueueSize();
+                report.queueSumSamples += static_cast<double>(queued);
+                ++report.queueSamples;
+                if (queued > report.queueMax) {
+                    report.queueMax = queued;
+                }
+            }
+            Schedule(now + config.mobilityStepMs, EventType::MOBILITY, 0, 0);
+        }
+
+        void OnBeacon(uint32_t i)
+        {
+            Node& node = nodes[i];
+            if (now != node.nextBeaconMs) {
+                return; // Rescheduled
+            }
+            node.thor->RemoveOld();
+            if (config.aggregateControl) {
+                BroadcastControl(i);
+            } else {
+                HelloExchange(i);
+            }
+            FlushQueue(i);
+
+            if (config.adaptiveBeacon) {
+                ScheduleBeacon(i, std::max(now + 1, node.thor->NextHelloAt()));
+                return;
+            }
+            // +/-10% jitter keeps beacons from synchronizing
+            uint64_t jitter = config.beaconMs / 5 + 1;
+            ScheduleBeacon(i, now + config.beaconMs - config.beaconMs / 10 + node.rng.Next() % jitter);
+        }
+
+        // HELLO, answered by one ACK per peer in range: the sender learns its neighbors
+        void HelloExchange(uint32_t i)
+        {
+            Node& node = nodes[i];
+            uint32_t myId = IdOf(i);
+            uint8_t hello[sizeof(Header) + LOAD_ADVERT_SIZE];
+            uint8_t ack[sizeof(Header) + LOAD_ADVERT_SIZE];
+            size_t helloSize = node.thor->CreateHello(BROADCAST_ID, myId, myId, node.sequence++, hello, sizeof(hello));
+            ++report.controlFrames;
+
+            grid.ForEachNear(motion[i].pos, [&](uint32_t j) {
+                int rssi = 0;
+                if (j == i || !Link(i, j, rssi)) {
+                    return;
+                }
+                Node& peer = nodes[j];
+                Header header;
+                if (!peer.thor->HandleHello(hello, helloSize, header)) {
+                    return;
+                }
+                uint32_t peerId = IdOf(j);
+                bool myInternet = peer.gateway;
+                bool intNeighbour = HeardGateway(peer);
+                size_t ackSize = peer.thor->CreateACK(myId, peerId, peerId, myId, peer.sequence++, myInternet, intNeighbour, ack, sizeof(ack));
+                ++report.controlFrames;
+
+                if (!node.thor->HandleAck(ack, ackSize, header)) {
+                    return;
+                }
+                bool direct = header.flagsAndTTL.myInternet != 0;
+                bool indirect = header.flagsAndTTL.intneighbour != 0;
+                node.thor->NeighborStore(peerId, rssi, direct, indirect, false);
+                if (direct) {
+                    node.gatewaySeenMs = now;
+                }
+            });
+        }
+
+        // One CONTROL frame: every peer in range learns the sender
+        void BroadcastControl(uint32_t i)
+        {
+            Node& node = nodes[i];
+            uint32_t myId = IdOf(i);
+            uint8_t control[sizeof(Header) + CONTROL_BODY_SIZE + CONTROL_MAX_ACKS * CONTROL_ACK_SIZE + LOAD_ADVERT_SIZE];
+            size_t size = node.thor->CreateControl(myId, node.sequence++, node.gateway, HeardGateway(node), control, sizeof(control));
+            ++report.controlFrames;
+
+            grid.ForEachNear(motion[i].pos, [&](uint32_t j) {
+                int rssi = 0;
+                if (j == i || !Link(i, j, rssi)) {
+                    return;
+                }
+                Node& peer = nodes[j];
+                Header header;
+                if (!peer.thor->HandleAck(control, size, header)) {
+                    return;
+                }
+                bool direct = header.flagsAndTTL.myInternet != 0;
+                peer.thor->NeighborStore(myId, rssi, direct, header.flagsAndTTL.intneighbour != 0, false);
+                if (direct) {
+                    peer.gatewaySeenMs = now;
+                }
+                FlushQueue(j);
+            });
+        }
+
+        // A route may have appeared: flush the store-and-forward queue
+        void FlushQueue(uint32_t i)
+        {
+            Node& node = nodes[i];
+            if (node.gateway || node.thor->QueueSize() == 0) {
+                return;
+            }
+            views.clear();
+            node.thor->ProcessQueue(views);
+            for (const FrameView& view : views) {
+                Transmit(i, view.data, view.size);
+            }
+        }
+
+        void OnTraffic(uint32_t i)
+        {
+            if (now >= trafficEndMs) {
+                return;
+            }
+            Node& node = nodes[i];
+            uint32_t myId = IdOf(i);
+
+            // Payload starts with the creation time so the gateway can measure latency
+            std::vector<uint8_t> payload(std::max<size_t>(config.payloadBytes, sizeof(uint64_t)), 0);
+            std::memcpy(payload.data(), &now, sizeof(now));
+
+            uint8_t frame[FRAME_BUFFER];
+            size_t size = node.thor->SendPacket(INTERNET_ID, myId, myId, node.sequence++, payload.data(), payload.size(), frame, sizeof(frame));
+            ++report.generated;
+            if (size > 0) {
+                Transmit(i, frame, size);
+            }
+            RearmBeacon(i);
+            Schedule(now + NextTrafficDelay(node), EventType::TRAFFIC, i, 0);
+        }
+
+        void Transmit(uint32_t from, const uint8_t* data, size_t size)
+        {
+            Header header;
+            if (!nodes[from].thor->DeserializeHeader(data, size, header)) {
+                return;
+            }
+            ++report.framesSent;
+            uint32_t nextHop = header.nextHopId;
+            int rssi = 0;
+            if (nextHop == 0 || nextHop > nodes.size() || !Link(from, nextHop - 1, rssi)) {
+                ++report.framesLost; // Neighbor moved away since its last ACK
+                return;
+            }
+
+            uint32_t slot = 0;
+            if (!freeFrames.empty()) {
+                slot = freeFrames.back();
+                freeFrames.pop_back();
+            } else {
+                slot = static_cast<uint32_t>(framePool.size());
+                framePool.emplace_back();
+            }
+            framePool[slot].assign(data, data + size);
+
+            // 1 Mbit/s PHY plus a connection event: never under 1 ms
+            uint64_t airtimeMs = 1 + (size * 8) / 1000;
+            Schedule(now + airtimeMs, EventType::FRAME, nextHop - 1, slot);
+        }
+
+        void OnFrame(uint32_t i, uint32_t slot)
+        {
+            std::vector<uint8_t>& frame = framePool[slot];
+            Node& node = nodes[i];
+
+            if (node.gateway) {
+                Deliver(node, frame);
+            } else {
+                PacketView view;
+                uint8_t out[FRAME_BUFFER];
+                size_t size = node.thor->HandleData(frame.data(), frame.size(), view, IdOf(i), out, sizeof(out));
+                if (size > 0) {
+                    Transmit(i, out, size);
+                }
+                RearmBeacon(i);
+            }
+            freeFrames.push_back(slot);
+        }
+
+        void Deliver(Node& gateway, const std::vector<uint8_t>& frame)
+        {
+            PacketView view;
+            if (!gateway.thor->Deserialize(frame.data(), frame.size(), view) || view.payloadSize < sizeof(uint64_t)) {
+                return;
+            }
+            uint64_t key = (static_cast<uint64_t>(view.header.originId) << 32) | view.header.sequence;
+            if (!delivered.insert(key).second) {
+                ++report.duplicates;
+                return;
+            }
+            uint64_t createdMs = 0;
+            std::memcpy(&createdMs, view.payload, sizeof(createdMs));
+            uint64_t latency = now - createdMs;
+
+            ++report.delivered;
+            report.latencySumMs += static_cast<double>(latency);
+            report.latenciesMs.push_back(latency);
+            report.hopSum += 16u - view.header.flagsAndTTL.ttl; // Origin sends TTL 15, each relay takes one
+        }
+
+        SimConfig config;
+        RadioModel radio;
+        SimRng rootRng;
+        Mobility mobility;
+        SpatialGrid grid;
+        double maxRange2;
+        uint64_t trafficEndMs;
+
+        std::vector<Node> nodes;
+        std::vector<MotionState> motion;
+
+        uint64_t now;
+        uint64_t nextSeq;
+        std::priority_queue<Event, std::vector<Event>, EventLater> events;
+        std::vector<std::vector<uint8_t>> framePool; // In-flight frames, slots are recycled
+        std::vector<uint32_t> freeFrames;
+        std::vector<FrameView> views;
+
+        std::unordered_set<uint64_t> delivered;      // (originId, sequence) seen at any gateway
+        SimReport report;
+    };
+}
+
+    SimReport RunEventSimulation(const SimConfig& config)
+    {
+        EventSimulation simulation(config);
+        return simulation.Run();
+    }
@@ -0,0 +1,239 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "NetSim.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+    // ---------------------------------------------------------------
+    // Radio
+    // ---------------------------------------------------------------
+
+    RadioModel::RadioModel(const SimConfig& config)
+        : txPower(config.txPowerDbm), pathLossRef(config.pathLossRef), pathLossExp(config.pathLossExp),
+          shadowing(config.shadowingDb), sensitivity(config.sensitivityDbm), maxRange(1.0), seed(config.seed)
+    {
+        // Shadowing is clamped to +/- 3 sigma, so nothing is heard beyond this distance
+        double budget = txPower - pathLossRef + 3.0 * shadowing - sensitivity;
+        maxRange = std::pow(10.0, budget / (10.0 * pathLossExp));
+        if (maxRange < 1.0) {
+            maxRange = 1.0;
+        }
+    }
+
+    double RadioModel::Shadowing(uint32_t a, uint32_t b) const
+    {
+        // Same value in both directions and on every call for this pair
+        SimRng rng = { seed ^ ((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)) };
+        double value = rng.Gaussian() * shadowing;
+        double limit = 3.0 * shadowing;
+        return std::max(-limit, std::min(limit, value));
+    }
+
+    bool RadioModel::Rssi(uint32_t a, uint32_t b, double distance, int& outRssi) const
+    {
+        if (distance > maxRange) {
+            return false;
+        }
+        double d = std::max(distance, 1.0);
+        double rx = txPower - pathLossRef - 10.0 * pathLossExp * std::log10(d) + Shadowing(a, b);
+        if (rx < sensitivity) {
+            return false;
+        }
+        outRssi = static_cast<int>(std::lround(rx));
+        return true;
+    }
+
+    // ---------------------------------------------------------------
+    // Mobility
+    // ---------------------------------------------------------------
+
+    Mobility::Mobility(const SimConfig& cfg, SimRng& rng)
+        : config(cfg)
+    {
+        if (config.mobility == MobilityModel::CROWD_CLUSTERS) {
+            centers.resize(std::max<size_t>(config.clusters, 1));
+            for (MotionState& center : centers) {
+                center.pos = RandomPoint(rng);
+                center.target = RandomPoint(rng);
+                center.speed = 0.3; // Crowds drift slowly
+                center.pauseUntilMs = 0;
+                center.cluster = 0;
+            }
+        }
+    }
+
+    Vec2 Mobility::RandomPoint(SimRng& rng) const
+    {
+        return { rng.Uniform(0.0, config.worldSize), rng.Uniform(0.0, config.worldSize) };
+    }
+
+    Vec2 Mobility::PickTarget(const MotionState& state, SimRng& rng) const
+    {
+        if (config.mobility == MobilityModel::RANDOM_WAYPOINT) {
+            return RandomPoint(rng);
+        }
+        // Wander around the (moving) crowd center
+        const Vec2& center = centers[state.cluster].pos;
+        Vec2 target = { center.x + rng.Gaussian() * config.clusterRadius,
+                        center.y + rng.Gaussian() * config.clusterRadius };
+        target.x = std::max(0.0, std::min(config.worldSize, target.x));
+        target.y = std::max(0.0, std::min(config.worldSize, target.y));
+        return target;
+    }
+
+    void Mobility::Init(MotionState& state, SimRng& rng) const
+    {
+        state.cluster = centers.empty() ? 0 : static_cast<uint32_t>(rng.Next() % centers.size());
+        state.pos = RandomPoint(rng);
+        if (!centers.empty()) {
+            state.pos = PickTarget(state, rng);
+        }
+        state.target = PickTarget(state, rng);
+        state.speed = rng.Uniform(config.minSpeed, config.maxSpeed);
+        state.pauseUntilMs = 0;
+    }
+
+    void Mobility::MoveToward(MotionState& state, uint64_t nowMs, double dtS, double pauseS, SimRng& rng, bool isCenter) const
+    {
+        if (nowMs < state.pauseUntilMs) {
+            return;
+        }
+        double dx = state.target.x - state.pos.x;
+        double dy = state.target.y - state.pos.y;
+        double dist = std::sqrt(dx * dx + dy * dy);
+        double step = state.speed * dtS;
+
+        if (dist > step) {
+            state.pos.x += dx / dist * step;
+            state.pos.y += dy / dist * step;
+            return;
+        }
+        // Waypoint reached: pause, then pick the next one
+        state.pos = state.target;
+        state.pauseUntilMs = nowMs + static_cast<uint64_t>(pauseS * 1000.0);
+        state.target = isCenter ? RandomPoint(rng) : PickTarget(state, rng);
+        if (!isCenter) {
+            state.speed = rng.Uniform(config.minSpeed, config.maxSpeed);
+        }
+    }
+
+    void Mobility::Step(MotionState& state, uint64_t nowMs, double dtS, SimRng& rng) const
+    {
+        MoveToward(state, nowMs, dtS, config.pauseS, rng, false);
+    }
+
+    void Mobility::StepClusters(uint64_t nowMs, double dtS, SimRng& rng)
+    {
+        for (MotionState& center : centers) {
+            MoveToward(center, nowMs, dtS, 0.0, rng, true);
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Spatial grid
+    // ---------------------------------------------------------------
+
+    SpatialGrid::SpatialGrid(double worldSize, double cell)
+        : cellSize(cell), cells(1)
+    {
+        cells = static_cast<size_t>(std::ceil(worldSize / cellSize));
+        if (cells == 0) {
+            cells = 1;
+        }
+        cellStart.assign(cells * cells + 1, 0);
+    }
+
+    long SpatialGrid::CellCoord(double v) const
+    {
+        long c = static_cast<long>(v / cellSize);
+        return std::max(0L, std::min(static_cast<long>(cells) - 1, c));
+    }
+
+    void SpatialGrid::Rebuild(const std::vector<MotionState>& states)
+    {
+        // Counting sort by cell: two passes, no per-cell allocations
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        for (const MotionState& state : states) {
+            size_t cell = static_cast<size_t>(CellCoord(state.pos.y)) * cells + static_cast<size_t>(CellCoord(state.pos.x));
+            ++cellStart[cell + 1];
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        members.resize(states.size());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < states.size(); ++i) {
+            size_t cell = static_cast<size_t>(CellCoord(states[i].pos.y)) * cells + static_cast<size_t>(CellCoord(states[i].pos.x));
+            members[fill[cell]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Report
+    // ---------------------------------------------------------------
+
+    double SimReport::LatencyPercentile(double p) const
+    {
+        if (latenciesMs.empty()) {
+            return 0.0;
+        }
+        std::vector<uint64_t> sorted(latenciesMs);
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1));
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<long>(rank), sorted.end());
+        return static_cast<double>(sorted[rank]);
+    }
+
+    void PrintReport(const SimConfig& config, const SimReport& report, const std::string& format, bool header)
+    {
+        const char* mobility = (config.mobility == MobilityModel::CROWD_CLUSTERS) ? "crowd" : "rwp";
+        double p50 = report.LatencyPercentile(0.50);
+        double p95 = report.LatencyPercentile(0.95);
+
+        if (format == "csv") {
+            if (header) {
+                std::printf("nodes,mobility,seed,generated,delivered,delivery_ratio,latency_mean_ms,latency_p50_ms,latency_p95_ms,"
+                            "hops_mean,queue_mean,queue_max,frames_sent,control_frames,frames_lost,duplicates,events,threads,wall_s,energy_j,mj_per_delivered\n");
+            }
+            std::printf("%zu,%s,%llu,%llu,%llu,%.4f,%.1f,%.0f,%.0f,%.2f,%.3f,%zu,%llu,%llu,%llu,%llu,%llu,%zu,%.3f,%.3f,%.3f\n",
+                        config.nodes, mobility, static_cast<unsigned long long>(config.seed),
+                        static_cast<unsigned long long>(report.generated), static_cast<unsigned long long>(report.delivered),
+                        report.DeliveryRatio(), report.MeanLatencyMs(), p50, p95, report.MeanHops(), report.MeanQueue(),
+                        report.queueMax, static_cast<unsigned long long>(report.framesSent),
+                        static_cast<unsigned long long>(report.controlFrames), static_cast<unsigned long long>(report.framesLost),
+                        static_cast<unsigned long long>(report.duplicates), static_cast<unsigned long long>(report.events),
+                        report.threads, report.wallSeconds, report.energyJ, report.MilliJoulesPerDelivered());
+            return;
+        }
+        if (format == "json") {
+            std::printf("{\"nodes\":%zu,\"mobility\":\"%s\",\"seed\":%llu,\"generated\":%llu,\"delivered\":%llu,"
+                        "\"delivery_ratio\":%.4f,\"latency_mean_ms\":%.1f,\"latency_p50_ms\":%.0f,\"latency_p95_ms\":%.0f,"
+                        "\"hops_mean\":%.2f,\"queue_mean\":%.3f,\"queue_max\":%zu,\"frames_sent\":%llu,\"control_frames\":%llu,"
+                        "\"frames_lost\":%llu,\"duplicates\":%llu,\"events\":%llu,\"threads\":%zu,\"wall_s\":%.3f,"
+                        "\"energy_j\":%.3f,\"mj_per_delivered\":%.3f}\n",
+                        config.nodes, mobility, static_cast<unsigned long long>(config.seed),
+                        static_cast<unsigned long long>(report.generated), static_cast<unsigned long long>(report.delivered),
+                        report.DeliveryRatio(), report.MeanLatencyMs(), p50, p95, report.MeanHops(), report.MeanQueue(),
+                        report.queueMax, static_cast<unsigned long long>(report.framesSent),
+                        static_cast<unsigned long long>(report.controlFrames), static_cast<unsigned long long>(report.framesLost),
+                        static_cast<unsigned long long>(report.duplicates), static_cast<unsigned long long>(report.events),
+                        report.threads, report.wallSeconds, report.energyJ, report.MilliJoulesPerDelivered());
+            return;
+        }
+        std::printf("========== THOR network simulation ==========\n");
+        std::printf("Nodes           : %zu (%s mobility, seed %llu)\n", config.nodes, mobility, static_cast<unsigned long long>(config.seed));
+        std::printf("Messages        : %llu generated, %llu delivered (ratio %.1f%%)\n",
+                    static_cast<unsigned long long>(report.generated), static_cast<unsigned long long>(report.delivered),
+                    100.0 * report.DeliveryRatio());
+        std::printf("Latency         : mean %.1f ms, p50 %.0f ms, p95 %.0f ms\n", report.MeanLatencyMs(), p50, p95);
+        std::printf("Hop count       : mean %.2f\n", report.MeanHops());
+        std::printf("Queue occupancy : mean %.3f packets/node, max %zu\n", report.MeanQueue(), report.queueMax);
+        std::printf("Frames          : %llu DATA, %llu control, %llu lost, %llu duplicate deliveries\n",
+                    static_cast<unsigned long long>(report.framesSent), static_cast<unsigned long long>(report.controlFrames),
+                    static_cast<unsigned long long>(report.framesLost), static_cast<unsigned long long>(report.duplicates));
+        std::printf("Energy          : %.2f J radio tx + rx, %.3f mJ per delivered message, %llu relays held\n", report.energyJ,
+                    report.MilliJoulesPerDelivered(), static_cast<unsigned long long>(report.held));
+        std::printf("Engine          : %llu events in %.2f s (%zu thread%s)\n", static_cast<unsigned long long>(report.events),
+                    report.wallSeconds, report.threads, report.threads == 1 ? "" : "s");
+    }
@@ -0,0 +1,203 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * Large-scale THOR network simulator (shared models).
+ *
+ * Every node runs a real THOR instance on a virtual millisecond clock.
+ * Nodes move (random waypoint or crowd clusters), discover each other with
+ * HELLO/ACK over an RSSI-vs-distance radio model, and carry DATA toward
+ * gateway nodes. Neighbor discovery uses a uniform spatial grid, so a beacon
+ * only looks at the 3x3 cells around the sender instead of every node.
+ */
+#ifndef NETSIM_H
+#define NETSIM_H
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "THOR.h"
+
+// Destination id used for "the internet" (delivered at any gateway)
+const uint32_t INTERNET_ID = 0xFFFFFFFE;
+
+enum class MobilityModel : uint8_t {
+    RANDOM_WAYPOINT = 1,
+    CROWD_CLUSTERS  = 2
+};
+
+// Small per-node random stream (splitmix64). 8 bytes per node instead of a
+// full std::mt19937, and independent of the order nodes are processed in.
+struct SimRng {
+    uint64_t state;
+
+    uint64_t Next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); } // [0, 1)
+    double Uniform(double lo, double hi) { return lo + (hi - lo) * Uniform(); }
+    double Gaussian()
+    {
+        // Irwin-Hall approximation, plenty for mobility jitter
+        double sum = Uniform() + Uniform() + Uniform() + Uniform();
+        return (sum - 2.0) * 1.7320508075688772;
+    }
+};
+
+struct SimConfig {
+    SimConfig() { node.maxPayload = 64; }
+
+    size_t   nodes          = 1000;
+    double   gatewayRatio   = 0.02;    // Fraction of nodes with internet
+    double   worldSize      = 2000.0;  // Square side, meters
+    MobilityModel mobility  = MobilityModel::RANDOM_WAYPOINT;
+    double   minSpeed       = 0.5;     // m/s
+    double   maxSpeed       = 1.5;
+    double   pauseS         = 30.0;    // Waypoint pause
+    size_t   clusters       = 8;       // CROWD_CLUSTERS: number of crowds
+    double   clusterRadius  = 60.0;    // Spread of a crowd around its center
+    uint64_t durationMs     = 600000;
+    uint64_t cooldownMs     = 60000;   // No new traffic in the last part of the run
+    uint64_t mobilityStepMs = 1000;
+    uint64_t beaconMs       = 2000;    // HELLO interval (jittered)
+    bool     adaptiveBeacon = false;   // Let THOR time HELLOs (NextHelloAt), min interval beaconMs / 4
+    bool     aggregateControl = false; // Beacon with one CONTROL frame instead of HELLO + an ACK per peer
+    uint64_t trafficMs      = 60000;   // Mean interval between messages per node
+    size_t   payloadBytes   = 16;
+    // Radio: log-distance path loss
+    double   txPowerDbm     = 0.0;
+    double   pathLossRef    = 40.0;    // dB at 1 m
+    double   pathLossExp    = 2.7;
+    double   shadowingDb    = 4.0;     // Std-dev of per-link shadowing
+    double   sensitivityDbm = -95.0;
+    THORConfig node;                   // Per-node protocol settings (clock is set by the simulator)
+    double   batteryJ       = 0.0;     // Per-node SetEnergyBudget at start, 0 = none. node.energy.budgeted lets it steer
+    // Parallel engine
+    uint64_t stepMs         = 10;      // Time step. Frames sent in a step arrive in a later one.
+    size_t   regionsPerSide = 8;       // The world is cut into regionsPerSide^2 regions
+    uint64_t seed           = 1;
+};
+
+struct Vec2 {
+    double x;
+    double y;
+};
+
+// RSSI from distance. Shadowing is a fixed, symmetric value per node pair so a
+// link does not flicker between two beacons.
+class RadioModel
+{
+public:
+    explicit RadioModel(const SimConfig& config);
+    double MaxRange() const { return maxRange; }
+    // Received power in dBm, or false if below sensitivity.
+    bool Rssi(uint32_t a, uint32_t b, double distance, int& outRssi) const;
+
+private:
+    double Shadowing(uint32_t a, uint32_t b) const;
+
+    double txPower, pathLossRef, pathLossExp, shadowing, sensitivity, maxRange;
+    uint64_t seed;
+};
+
+// Position state of one node
+struct MotionState {
+    Vec2 pos;
+    Vec2 target;
+    double speed;
+    uint64_t pauseUntilMs;
+    uint32_t cluster;
+};
+
+class Mobility
+{
+public:
+    Mobility(const SimConfig& config, SimRng& rng);
+    void Init(MotionState& state, SimRng& rng) const;
+    // Advances one node by dt. Each node draws from its own rng stream so the result
+    // does not depend on the order nodes are processed in.
+    void Step(MotionState& state, uint64_t nowMs, double dtS, SimRng& rng) const;
+    // Moves the crowd centers (CROWD_CLUSTERS only). Call once per step, before Step.
+    void StepClusters(uint64_t nowMs, double dtS, SimRng& rng);
+
+private:
+    Vec2 RandomPoint(SimRng& rng) const;
+    Vec2 PickTarget(const MotionState& state, SimRng& rng) const;
+    void MoveToward(MotionState& state, uint64_t nowMs, double dtS, double pauseS, SimRng& rng, bool isCenter) const;
+
+    SimConfig config;
+    std::vector<MotionState> centers; // CROWD_CLUSTERS: crowd centers drift with random waypoint
+};
+
+// Uniform grid over the world, cell side = radio range
+class SpatialGrid
+{
+public:
+    SpatialGrid(double worldSize, double cellSize);
+    void Rebuild(const std::vector<MotionState>& states);
+    // Calls fn(index) for every node in the 3x3 cells around pos.
+    template <typename Fn>
+    void ForEachNear(const Vec2& pos, Fn fn) const
+    {
+        long cx = CellCoord(pos.x);
+        long cy = CellCoord(pos.y);
+        for (long y = cy - 1; y <= cy + 1; ++y) {
+            if (y < 0 || y >= static_cast<long>(cells)) continue;
+            for (long x = cx - 1; x <= cx + 1; ++x) {
+                if (x < 0 || x >= static_cast<long>(cells)) continue;
+                size_t cell = static_cast<size_t>(y) * cells + static_cast<size_t>(x);
+                for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                    fn(members[i]);
+                }
+            }
+        }
+    }
+
+private:
+    long CellCoord(double v) const;
+
+    double cellSize;
+    size_t cells;                    // Per side
+    std::vector<uint32_t> cellStart; // Counting-sort layout: members of cell c are [cellStart[c], cellStart[c+1])
+    std::vector<uint32_t> members;
+};
+
+struct SimReport {
+    uint64_t generated = 0;        // Messages counted for delivery ratio
+    uint64_t delivered = 0;
+    uint64_t duplicates = 0;       // Copies reaching a gateway after the first
+    double   latencySumMs = 0.0;
+    std::vector<uint64_t> latenciesMs;
+    uint64_t hopSum = 0;
+    uint64_t framesSent = 0;       // DATA frames put on the air
+    uint64_t controlFrames = 0;    // HELLO + ACK, or CONTROL
+    uint64_t framesLost = 0;       // Next hop out of range
+    double   queueSumSamples = 0.0;
+    uint64_t queueSamples = 0;
+    size_t   queueMax = 0;
+    double   energyJ = 0.0;        // Radio energy the nodes accounted for (EnergyModel), all nodes
+    uint64_t held = 0;             // Relays a low battery kept queued (budgeted mode)
+    uint64_t events = 0;
+    size_t   threads = 1;
+    double   wallSeconds = 0.0;
+
+    double DeliveryRatio() const { return generated ? static_cast<double>(delivered) / generated : 0.0; }
+    double MeanLatencyMs() const { return delivered ? latencySumMs / delivered : 0.0; }
+    double MeanHops() const { return delivered ? static_cast<double>(hopSum) / delivered : 0.0; }
+    double MeanQueue() const { return queueSamples ? queueSumSamples / queueSamples : 0.0; }
+    double MilliJoulesPerDelivered() const { return delivered ? 1000.0 * energyJ / delivered : 0.0; }
+    double LatencyPercentile(double p) const;
+};
+
+// Sequential discrete-event engine (one global event queue)
+SimReport RunEventSimulation(const SimConfig& config);
+// Time-stepped engine: regions run on a work-stealing pool. The result depends on
+// the seed, the step and the region count, never on the number of threads.
+SimReport RunParallelSimulation(const SimConfig& config, size_t threads);
+
+void PrintReport(const SimConfig& config, const SimReport& report, const std::string& format, bool header);
+
+#endif /* NETSIM_H */
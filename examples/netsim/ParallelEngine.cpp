@@ -0,0 +1,529 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "NetSim.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+
+/*
+ * Time-stepped parallel engine.
+ *
+ * The world is cut into square regions. In each step every region runs the
+ * events of the nodes it currently owns, on whichever pool thread picks it up.
+ * A node only ever changes its own THOR instance; everything it reads about other
+ * nodes (positions, gateway contact) is frozen for the duration of the step.
+ * Frames always land in a later step. Frames for a node in another region go
+ * through that region's lock-free inbox, and every node sorts its arrivals by
+ * (time, sender, sender's frame count) before handling them. So the outcome
+ * never depends on thread scheduling, only on the seed, step and region count.
+ */
+
+namespace {
+    const size_t FRAME_BUFFER = 600;
+
+    struct Arrival {
+        uint64_t timeMs;
+        uint32_t from;      // Sender index
+        uint64_t txCount;   // Sender's frame counter, makes the sort key unique
+        std::vector<uint8_t> data;
+    };
+
+    bool ArrivesBefore(const Arrival& a, const Arrival& b)
+    {
+        if (a.timeMs != b.timeMs) return a.timeMs < b.timeMs;
+        if (a.from != b.from) return a.from < b.from;
+        return a.txCount < b.txCount;
+    }
+
+    // Cross-region frame, owned by the sending region until the step is committed
+    struct Message {
+        Message* next;
+        uint32_t to;
+        Arrival arrival;
+    };
+
+    // Multi-producer inbox (Treiber stack). Pushes race freely during a step,
+    // the commit phase takes the whole list once every region is done.
+    class RegionInbox
+    {
+    public:
+        RegionInbox() : head(nullptr) {}
+        void Push(Message* message)
+        {
+            message->next = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(message->next, message, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+        Message* TakeAll() { return head.exchange(nullptr, std::memory_order_acquire); }
+
+    private:
+        std::atomic<Message*> head;
+    };
+
+    struct Delivery {
+        uint64_t key;        // originId << 32 | sequence
+        uint64_t latencyMs;
+        uint32_t hops;
+    };
+
+    struct Node {
+        std::unique_ptr<THOR> thor;
+        bool gateway;
+        uint64_t nowMs;            // This node's virtual clock
+        uint64_t gatewaySeenMs;    // Live value, only this node writes it
+        uint64_t nextBeaconMs;
+        uint64_t nextTrafficMs;
+        uint64_t txCount;
+        uint32_t sequence;
+        SimRng rng;
+        std::vector<Arrival> inbox;
+    };
+
+    struct Region {
+        std::vector<uint32_t> members;           // Ascending node index
+        std::deque<Message> outgoing;            // Storage for messages pushed to other regions
+        RegionInbox inbox;
+        std::vector<std::pair<uint32_t, uint64_t>> gatewaySeen; // Contact updates to publish
+        std::vector<Delivery> deliveries;
+        std::vector<FrameView> views;
+        SimReport stats;                         // Counters only
+    };
+
+    class ParallelSimulation
+    {
+    public:
+        ParallelSimulation(const SimConfig& cfg, size_t threads)
+            : config(cfg), radio(cfg), rootRng({ cfg.seed }), mobility(cfg, rootRng),
+              grid(cfg.worldSize, radio.MaxRange()), pool(threads)
+        {
+            maxRange2 = radio.MaxRange() * radio.MaxRange();
+            trafficEndMs = (config.durationMs > config.cooldownMs) ? config.durationMs - config.cooldownMs : 0;
+            regionsPerSide = std::max<size_t>(config.regionsPerSide, 1);
+            regions.reset(new Region[regionsPerSide * regionsPerSide]);
+
+            size_t count = config.nodes;
+            nodes.reset(new Node[count]);
+            motion.resize(count);
+            regionOf.resize(count);
+            gatewaySeen.assign(count, UINT64_MAX);
+
+            size_t gateways = static_cast<size_t>(std::lround(config.gatewayRatio * count));
+            for (size_t i = 0; i < count; ++i) {
+                Node& node = nodes[i];
+                THORConfig nodeConfig = config.node;
+                nodeConfig.clock = [&node]() { return node.nowMs; };
+                if (config.adaptiveBeacon) {
+                    nodeConfig.beacon.minIntervalMs = std::max<uint64_t>(config.beaconMs / 4, 1);
+                }
+                node.thor.reset(new THOR(nodeConfig));
+                if (config.batteryJ > 0.0) {
+                    uint64_t battery = static_cast<uint64_t>(config.batteryJ * 1e9);
+                    node.thor->SetEnergyBudget(battery, battery);
+                }
+                node.gateway = gateways > 0 && (i * gateways) / count != ((i + 1) * gateways) / count;
+                node.nowMs = 0;
+                node.gatewaySeenMs = UINT64_MAX;
+                node.txCount = 0;
+                node.sequence = 0;
+                node.rng.state = config.seed * 0x9E3779B97F4A7C15ull + i + 1;
+                mobility.Init(motion[i], node.rng);
+                // Gateways only answer HELLOs, unless CONTROL frames are used: then they announce themselves
+                node.nextBeaconMs = (node.gateway && !config.aggregateControl) ? UINT64_MAX : node.rng.Next() % config.beaconMs;
+                node.nextTrafficMs = node.gateway ? UINT64_MAX : NextTrafficDelay(node);
+            }
+            grid.Rebuild(motion);
+            AssignRegions();
+        }
+
+        SimReport Run()
+        {
+            auto start = std::chrono::steady_clock::now();
+            size_t regionCount = regionsPerSide * regionsPerSide;
+            uint64_t step = std::max<uint64_t>(config.stepMs, 1);
+            uint64_t nextMobilityMs = 0;
+
+            for (uint64_t stepStart = 0; stepStart <= config.durationMs; stepStart += step) {
+                if (stepStart >= nextMobilityMs) {
+                    MoveNodes(nextMobilityMs);
+                    nextMobilityMs += config.mobilityStepMs;
+                }
+                uint64_t stepEnd = std::min(stepStart + step, config.durationMs + 1);
+                pool.Run(regionCount, [&](size_t r) { RunRegion(regions[r], stepEnd); });
+                Commit();
+            }
+            for (size_t i = 0; i < config.nodes; ++i) {
+                const EnergyStats& energy = nodes[i].thor->GetEnergyStats();
+                report.energyJ += static_cast<double>(energy.txNj + energy.rxNj) * 1e-9;
+                report.held += energy.held;
+            }
+            report.threads = pool.Threads();
+            report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return report;
+        }
+
+    private:
+        static uint32_t IdOf(uint32_t index) { return index + 1; }
+
+        uint64_t NextTrafficDelay(Node& node)
+        {
+            double u = node.rng.Uniform();
+            return 1 + static_cast<uint64_t>(-std::log(1.0 - u) * static_cast<double>(config.trafficMs));
+        }
+
+        size_t RegionAt(const Vec2& pos) const
+        {
+            double side = config.worldSize / static_cast<double>(regionsPerSide);
+            long x = std::max(0L, std::min(static_cast<long>(regionsPerSide) - 1, static_cast<long>(pos.x / side)));
+            long y = std::max(0L, std::min(static_cast<long>(regionsPerSide) - 1, static_cast<long>(pos.y / side)));
+            return static_cast<size_t>(y) * regionsPerSide + static_cast<size_t>(x);
+        }
+
+        void AssignRegions()
+        {
+            size_t regionCount = regionsPerSide * regionsPerSide;
+            for (size_t r = 0; r < regionCount; ++r) {
+                regions[r].members.clear();
+            }
+            for (uint32_t i = 0; i < config.nodes; ++i) {
+                regionOf[i] = static_cast<uint32_t>(RegionAt(motion[i].pos));
+                regions[regionOf[i]].members.push_back(i);
+            }
+        }
+
+        // Mobility phase: nodes move in parallel (each on its own rng), then the grid
+        // and the region ownership are rebuilt on the calling thread.
+        void MoveNodes(uint64_t nowMs)
+        {
+            double dtS = static_cast<double>(config.mobilityStepMs) / 1000.0;
+            if (nowMs > 0) {
+                mobility.StepClusters(nowMs, dtS, rootRng);
+                pool.Run(regionsPerSide * regionsPerSide, [&](size_t r) {
+                    for (uint32_t i : regions[r].members) {
+                        mobility.Step(motion[i], nowMs, dtS, nodes[i].rng);
+                    }
+                });
+                grid.Rebuild(motion);
+                AssignRegions();
+            }
+            for (size_t i = 0; i < config.nodes; ++i) {
+                if (nodes[i].gateway) continue;
+                size_t queued = nodes[i].thor->QueueSize();
+                report.queueSumSamples += static_cast<double>(queued);
+                ++report.queueSamples;
+                report.queueMax = std::max(report.queueMax, queued);
+            }
+            ++report.events;
+        }
+
+        bool Link(uint32_t a, uint32_t b, int& outRssi) const
+        {
+            double dx = motion[a].pos.x - motion[b].pos.x;
+            double dy = motion[a].pos.y - motion[b].pos.y;
+            double d2 = dx * dx + dy * dy;
+            if (d2 > maxRange2) {
+                return false;
+            }
+            return radio.Rssi(IdOf(a), IdOf(b), std::sqrt(d2), outRssi);
+        }
+
+        void RunRegion(Region& region, uint64_t stepEnd)
+        {
+            region.outgoing.clear(); // Last step's messages were moved out by Commit
+            for (uint32_t i : region.members) {
+                Node& node = nodes[i];
+                std::sort(node.inbox.begin(), node.inbox.end(), ArrivesBefore);
+                size_t next = 0;
+                while (true) {
+                    uint64_t frameMs = (next < node.inbox.size()) ? node.inbox[next].timeMs : UINT64_MAX;
+                    uint64_t t = std::min(frameMs, std::min(node.nextBeaconMs, node.nextTrafficMs));
+                    if (t >= stepEnd) {
+                        break;
+                    }
+                    node.nowMs = t;
+                    ++region.stats.events;
+                    // Same-time order: frames, beacon, traffic
+                    if (frameMs == t) {
+                        OnFrame(region, i, node.inbox[next], stepEnd);
+                        ++next;
+                    } else if (node.nextBeaconMs == t) {
+                        OnBeacon(region, i, stepEnd);
+                    } else {
+                        OnTraffic(region, i, stepEnd);
+                    }
+                }
+                node.inbox.erase(node.inbox.begin(), node.inbox.begin() + static_cast<long>(next));
+            }
+        }
+
+        void OnBeacon(Region& region, uint32_t i, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            node.thor->RemoveOld();
+            if (config.aggregateControl) {
+                BroadcastControl(region, i, stepEnd);
+            } else {
+                HelloExchange(region, i);
+            }
+            FlushQueue(region, i, stepEnd);
+
+            if (config.adaptiveBeacon) {
+                node.nextBeaconMs = std::max(node.nowMs + 1, node.thor->NextHelloAt());
+                return;
+            }
+            uint64_t jitter = config.beaconMs / 5 + 1;
+            node.nextBeaconMs = node.nowMs + config.beaconMs - config.beaconMs / 10 + node.rng.Next() % jitter;
+        }
+
+        void HelloExchange(Region& region, uint32_t i)
+        {
+            Node& node = nodes[i];
+            uint32_t myId = IdOf(i);
+            // Header-sized: both frames are encoded by this node, so a load advertisement
+            // would carry its own queue instead of the peer's. CONTROL frames carry it.
+            uint8_t hello[sizeof(Header)];
+            uint8_t ack[sizeof(Header)];
+            uint32_t helloSequence = node.sequence++;
+            size_t helloSize = node.thor->CreateHello(BROADCAST_ID, myId, myId, helloSequence, hello, sizeof(hello));
+            ++region.stats.controlFrames;
+            bool sawGateway = false;
+
+            grid.ForEachNear(motion[i].pos, [&](uint32_t j) {
+                int rssi = 0;
+                if (j == i || !Link(i, j, rssi)) {
+                    return;
+                }
+                // The peer's reply is encoded here, from the peer's published state, so no
+                // other node's THOR instance is touched from this thread.
+                Header header;
+                if (!node.thor->HandleHello(hello, helloSize, header)) {
+                    return;
+                }
+                uint32_t peerId = IdOf(j);
+                bool myInternet = nodes[j].gateway;
+                bool intNeighbour = gatewaySeen[j] != UINT64_MAX && node.nowMs - gatewaySeen[j] <= config.node.neighborTimeoutMs;
+                size_t ackSize = node.thor->CreateACK(myId, peerId, peerId, myId, helloSequence + 1, myInternet, intNeighbour, ack, sizeof(ack));
+                ++region.stats.controlFrames;
+
+                if (!node.thor->HandleAck(ack, ackSize, header)) {
+                    return;
+                }
+                bool direct = header.flagsAndTTL.myInternet != 0;
+                bool indirect = header.flagsAndTTL.intneighbour != 0;
+                node.thor->NeighborStore(peerId, rssi, direct, indirect, false);
+                sawGateway = sawGateway || direct;
+            });
+            if (sawGateway) {
+                node.gatewaySeenMs = node.nowMs;
+                region.gatewaySeen.emplace_back(i, node.nowMs);
+            }
+        }
+
+        // One CONTROL frame, delivered to every peer in range in a later step
+        void BroadcastControl(Region& region, uint32_t i, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            uint32_t myId = IdOf(i);
+            bool heardGateway = node.gatewaySeenMs != UINT64_MAX && node.nowMs - node.gatewaySeenMs <= config.node.neighborTimeoutMs;
+            uint8_t control[sizeof(Header) + CONTROL_BODY_SIZE + CONTROL_MAX_ACKS * CONTROL_ACK_SIZE + LOAD_ADVERT_SIZE];
+            size_t size = node.thor->CreateControl(myId, node.sequence++, node.gateway, heardGateway, control, sizeof(control));
+            ++region.stats.controlFrames;
+
+            grid.ForEachNear(motion[i].pos, [&](uint32_t j) {
+                int rssi = 0;
+                if (j != i && Link(i, j, rssi)) {
+                    Deliver(region, i, j, control, size, std::max<uint64_t>(node.nowMs + 1, stepEnd));
+                }
+            });
+        }
+
+        void FlushQueue(Region& region, uint32_t i, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            if (node.gateway || node.thor->QueueSize() == 0) {
+                return;
+            }
+            region.views.clear();
+            node.thor->ProcessQueue(region.views);
+            for (const FrameView& view : region.views) {
+                Transmit(region, i, view.data, view.size, stepEnd);
+            }
+        }
+
+        void OnTraffic(Region& region, uint32_t i, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            if (node.nowMs >= trafficEndMs) {
+                node.nextTrafficMs = UINT64_MAX;
+                return;
+            }
+            uint32_t myId = IdOf(i);
+            std::vector<uint8_t> payload(std::max<size_t>(config.payloadBytes, sizeof(uint64_t)), 0);
+            std::memcpy(payload.data(), &node.nowMs, sizeof(node.nowMs));
+
+            uint8_t frame[FRAME_BUFFER];
+            size_t size = node.thor->SendPacket(INTERNET_ID, myId, myId, node.sequence++, payload.data(), payload.size(), frame, sizeof(frame));
+            ++region.stats.generated;
+            if (size > 0) {
+                Transmit(region, i, frame, size, stepEnd);
+            }
+            RearmBeacon(node);
+            node.nextTrafficMs = node.nowMs + NextTrafficDelay(node);
+        }
+
+        void Transmit(Region& region, uint32_t from, const uint8_t* data, size_t size, uint64_t stepEnd)
+        {
+            Node& node = nodes[from];
+            Header header;
+            if (!node.thor->DeserializeHeader(data, size, header)) {
+                return;
+            }
+            ++region.stats.framesSent;
+            uint32_t nextHop = header.nextHopId;
+            int rssi = 0;
+            if (nextHop == 0 || nextHop > config.nodes || !Link(from, nextHop - 1, rssi)) {
+                ++region.stats.framesLost;
+                return;
+            }
+            // Never inside the current step: the receiver may already be past that time
+            Deliver(region, from, nextHop - 1, data, size, std::max<uint64_t>(node.nowMs + 1 + (size * 8) / 1000, stepEnd));
+        }
+
+        // Hands a frame to node 'to', directly or through the inbox of its region
+        void Deliver(Region& region, uint32_t from, uint32_t to, const uint8_t* data, size_t size, uint64_t arrivalMs)
+        {
+            Arrival arrival = { arrivalMs, from, nodes[from].txCount++, std::vector<uint8_t>(data, data + size) };
+            Region& target = regions[regionOf[to]];
+            if (&target == &region) {
+                nodes[to].inbox.push_back(std::move(arrival));
+                return;
+            }
+            region.outgoing.push_back({ nullptr, to, std::move(arrival) });
+            target.inbox.Push(&region.outgoing.back());
+        }
+
+        void OnFrame(Region& region, uint32_t i, const Arrival& arrival, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            const std::vector<uint8_t>& frame = arrival.data;
+            if (frame[0] == static_cast<uint8_t>(THORPacketType::CONTROL)) {
+                OnControl(region, i, arrival, stepEnd);
+                return;
+            }
+            if (node.gateway) {
+                PacketView view;
+                if (!node.thor->Deserialize(frame.data(), frame.size(), view) || view.payloadSize < sizeof(uint64_t)) {
+                    return;
+                }
+                uint64_t createdMs = 0;
+                std::memcpy(&createdMs, view.payload, sizeof(createdMs));
+                uint64_t key = (static_cast<uint64_t>(view.header.originId) << 32) | view.header.sequence;
+                region.deliveries.push_back({ key, node.nowMs - createdMs, 16u - view.header.flagsAndTTL.ttl });
+                return;
+            }
+            PacketView view;
+            uint8_t out[FRAME_BUFFER];
+            size_t size = node.thor->HandleData(frame.data(), frame.size(), view, IdOf(i), out, sizeof(out));
+            if (size > 0) {
+                Transmit(region, i, out, size, stepEnd);
+            }
+            RearmBeacon(node);
+        }
+
+        // A peer announced itself. The link is checked again on arrival, the peer may have moved.
+        void OnControl(Region& region, uint32_t i, const Arrival& arrival, uint64_t stepEnd)
+        {
+            Node& node = nodes[i];
+            int rssi = 0;
+            Header header;
+            if (!Link(arrival.from, i, rssi) || !node.thor->HandleAck(arrival.data.data(), arrival.data.size(), header)) {
+                return;
+            }
+            bool direct = header.flagsAndTTL.myInternet != 0;
+            node.thor->NeighborStore(header.senderId, rssi, direct, header.flagsAndTTL.intneighbour != 0, false);
+            if (direct) {
+                node.gatewaySeenMs = node.nowMs;
+                region.gatewaySeen.emplace_back(i, node.nowMs);
+            }
+            FlushQueue(region, i, stepEnd);
+        }
+
+        // Adaptive timing: queued data may have made a HELLO due sooner
+        void RearmBeacon(Node& node)
+        {
+            if (config.adaptiveBeacon) {
+                node.nextBeaconMs = std::min(node.nextBeaconMs, std::max(node.nowMs, node.thor->NextHelloAt()));
+            }
+        }
+
+        // Single-threaded, between steps: publish gateway contact, hand cross-region
+        // frames to their nodes and fold the region counters into the report, always
+        // in region order.
+        void Commit()
+        {
+            size_t regionCount = regionsPerSide * regionsPerSide;
+            for (size_t r = 0; r < regionCount; ++r) {
+                Region& region = regions[r];
+                for (const std::pair<uint32_t, uint64_t>& seen : region.gatewaySeen) {
+                    gatewaySeen[seen.first] = seen.second;
+                }
+                region.gatewaySeen.clear();
+
+                for (Message* message = region.inbox.TakeAll(); message != nullptr; message = message->next) {
+                    nodes[message->to].inbox.push_back(std::move(message->arrival));
+                }
+
+                for (const Delivery& delivery : region.deliveries) {
+                    if (!delivered.insert(delivery.key).second) {
+                        ++report.duplicates;
+                        continue;
+                    }
+                    ++report.delivered;
+                    report.latencySumMs += static_cast<double>(delivery.latencyMs);
+                    report.latenciesMs.push_back(delivery.latencyMs);
+                    report.hopSum += delivery.hops;
+                }
+                region.deliveries.clear();
+
+                SimReport& stats = region.stats;
+                report.generated += stats.generated;
+                report.framesSent += stats.framesSent;
+                report.controlFrames += stats.controlFrames;
+                report.framesLost += stats.framesLost;
+                report.events += stats.events;
+                stats = SimReport();
+            }
+        }
+
+        SimConfig config;
+        RadioModel radio;
+        SimRng rootRng;
+        Mobility mobility;
+        SpatialGrid grid;
+        WorkStealingPool pool;
+        double maxRange2;
+        uint64_t trafficEndMs;
+        size_t regionsPerSide;
+
+        std::unique_ptr<Node[]> nodes;            // Never reallocated: THOR clocks point into it
+        std::vector<MotionState> motion;
+        std::vector<uint32_t> regionOf;
+        std::vector<uint64_t> gatewaySeen;        // Published at the end of each step
+        std::unique_ptr<Region[]> regions;
+
+        std::unordered_set<uint64_t> delivered;
+        SimReport report;
+    };
+}
+
+    SimReport RunParallelSimulation(const SimConfig& config, size_t threads)
+    {
+        ParallelSimulation simulation(config, threads);
+        return simulation.Run();
+    }
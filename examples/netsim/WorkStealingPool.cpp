@@ -0,0 +1,119 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "WorkStealingPool.h"
+
+namespace {
+    inline uint64_t Pack(uint64_t begin, uint64_t end) { return (begin << 32) | end; }
+    inline uint64_t Begin(uint64_t span) { return span >> 32; }
+    inline uint64_t End(uint64_t span) { return span & 0xFFFFFFFFu; }
+}
+
+    WorkStealingPool::WorkStealingPool(size_t threads)
+        : shares(threads == 0 ? 1 : threads), job(nullptr), generation(0), busy(0), stopping(false)
+    {
+        for (Share& share : shares) {
+            share.span.store(0, std::memory_order_relaxed);
+        }
+        // Worker 0 is the thread that calls Run
+        for (size_t worker = 1; worker < shares.size(); ++worker) {
+            workers.emplace_back(&WorkStealingPool::WorkerLoop, this, worker);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+    }
+
+    void WorkStealingPool::Run(size_t taskCount, const std::function<void(size_t)>& fn)
+    {
+        size_t count = shares.size();
+        for (size_t worker = 0; worker < count; ++worker) {
+            uint64_t begin = taskCount * worker / count;
+            uint64_t end = taskCount * (worker + 1) / count;
+            shares[worker].span.store(Pack(begin, end), std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        Work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busy == 0; });
+        job = nullptr;
+    }
+
+    void WorkStealingPool::WorkerLoop(size_t worker)
+    {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+            Work(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --busy;
+            }
+            done.notify_one();
+        }
+    }
+
+    void WorkStealingPool::Work(size_t worker)
+    {
+        size_t task = 0;
+        while (TakeOwn(worker, task)) {
+            (*job)(task);
+        }
+        // Own share is empty: help the others, nearest neighbor first
+        for (size_t offset = 1; offset < shares.size(); ++offset) {
+            size_t victim = (worker + offset) % shares.size();
+            while (Steal(victim, task)) {
+                (*job)(task);
+            }
+        }
+    }
+
+    bool WorkStealingPool::TakeOwn(size_t worker, size_t& task)
+    {
+        std::atomic<uint64_t>& span = shares[worker].span;
+        uint64_t current = span.load(std::memory_order_acquire);
+        while (Begin(current) < End(current)) {
+            if (span.compare_exchange_weak(current, Pack(Begin(current) + 1, End(current)), std::memory_order_acq_rel)) {
+                task = static_cast<size_t>(Begin(current));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool WorkStealingPool::Steal(size_t victim, size_t& task)
+    {
+        std::atomic<uint64_t>& span = shares[victim].span;
+        uint64_t current = span.load(std::memory_order_acquire);
+        while (Begin(current) < End(current)) {
+            if (span.compare_exchange_weak(current, Pack(Begin(current), End(current) - 1), std::memory_order_acq_rel)) {
+                task = static_cast<size_t>(End(current) - 1);
+                return true;
+            }
+        }
+        return false;
+    }
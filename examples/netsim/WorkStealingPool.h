@@ -0,0 +1,53 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running one batch of tasks at a time (fork-join).
+// Each worker starts with a contiguous share of the task indices and takes from
+// its front; a worker that runs dry steals from the back of another share. A share
+// is a single atomic (begin, end) pair, so neither side ever takes a lock.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(size_t threads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Calls fn(task) for every task in [0, taskCount) and returns when all are done.
+    // The calling thread works too.
+    void Run(size_t taskCount, const std::function<void(size_t)>& fn);
+    size_t Threads() const { return shares.size(); }
+
+private:
+    struct alignas(64) Share {
+        std::atomic<uint64_t> span; // begin << 32 | end
+    };
+
+    void WorkerLoop(size_t worker);
+    void Work(size_t worker);
+    bool TakeOwn(size_t worker, size_t& task);
+    bool Steal(size_t victim, size_t& task);
+
+    std::vector<Share> shares;
+    std::vector<std::thread> workers;
+    const std::function<void(size_t)>* job;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation;
+    size_t busy;
+    bool stopping;
+};
+
+#endif /* WORK_STEALING_POOL_H */
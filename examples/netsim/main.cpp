@@ -0,0 +1,143 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * netsim - run thousands of THOR nodes on a virtual clock.
+ *
+ *   netsim --nodes 5000 --world 4500 --mobility crowd --format csv --header
+ *   netsim --nodes 10000 --world 6300 --threads 8
+ *
+ * Parameter sweeps: loop over a flag in a shell script and append the csv lines.
+ */
+#include "NetSim.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+    void Usage()
+    {
+        std::printf("Usage: netsim [options]\n"
+                    "  --nodes N          Number of nodes (default 1000)\n"
+                    "  --gateways R       Fraction of nodes with internet (default 0.02)\n"
+                    "  --world M          Side of the square world in meters (default 2000)\n"
+                    "  --mobility rwp|crowd\n"
+                    "  --duration-s S     Simulated time (default 600)\n"
+                    "  --beacon-ms MS     HELLO interval (default 2000)\n"
+                    "  --beacon-mode fixed|adaptive\n"
+                    "                     adaptive: THOR times HELLOs, from beacon-ms / 4 up to a third\n"
+                    "                     of the neighbor timeout (default fixed)\n"
+                    "  --control hello|aggregate\n"
+                    "                     aggregate: one CONTROL broadcast per beacon instead of\n"
+                    "                     HELLO + one ACK per peer (default hello)\n"
+                    "  --traffic-s S      Mean interval between messages per node (default 60)\n"
+                    "  --queue N          Store-and-forward slots per node (default 50)\n"
+                    "  --spread K         Drain across the K best neighbors (default 1)\n"
+                    "  --battery-j J      Per-node battery for budgeted forwarding (default: unlimited)\n"
+                    "  --threads N        Time-stepped parallel engine on N threads (default: event engine)\n"
+                    "  --step-ms MS       Parallel engine time step (default 10)\n"
+                    "  --regions N        Parallel engine regions per side (default 8)\n"
+                    "  --seed N\n"
+                    "  --format text|csv|json\n"
+                    "  --header           Print the csv header line\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SimConfig config;
+    std::string format = "text";
+    bool header = false;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool used = true;
+
+        if (arg == "--header") {
+            header = true;
+            used = false;
+        } else if (arg == "--help" || arg == "-h") {
+            Usage();
+            return 0;
+        } else if (value == nullptr) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return 1;
+        } else if (arg == "--nodes") {
+            config.nodes = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--gateways") {
+            config.gatewayRatio = std::atof(value);
+        } else if (arg == "--world") {
+            config.worldSize = std::atof(value);
+        } else if (arg == "--mobility") {
+            if (std::strcmp(value, "crowd") == 0) {
+                config.mobility = MobilityModel::CROWD_CLUSTERS;
+            } else if (std::strcmp(value, "rwp") == 0) {
+                config.mobility = MobilityModel::RANDOM_WAYPOINT;
+            } else {
+                std::fprintf(stderr, "Unknown mobility model %s\n", value);
+                return 1;
+            }
+        } else if (arg == "--duration-s") {
+            config.durationMs = static_cast<uint64_t>(std::atof(value) * 1000.0);
+        } else if (arg == "--beacon-ms") {
+            config.beaconMs = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--beacon-mode") {
+            if (std::strcmp(value, "adaptive") == 0) {
+                config.adaptiveBeacon = true;
+            } else if (std::strcmp(value, "fixed") == 0) {
+                config.adaptiveBeacon = false;
+            } else {
+                std::fprintf(stderr, "Unknown beacon mode %s\n", value);
+                return 1;
+            }
+        } else if (arg == "--control") {
+            if (std::strcmp(value, "aggregate") == 0) {
+                config.aggregateControl = true;
+            } else if (std::strcmp(value, "hello") == 0) {
+                config.aggregateControl = false;
+            } else {
+                std::fprintf(stderr, "Unknown control mode %s\n", value);
+                return 1;
+            }
+        } else if (arg == "--traffic-s") {
+            config.trafficMs = static_cast<uint64_t>(std::atof(value) * 1000.0);
+        } else if (arg == "--queue") {
+            config.node.queueCapacity = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--spread") {
+            config.node.spreadNeighbors = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--battery-j") {
+            config.batteryJ = std::atof(value);
+            config.node.energy.budgeted = config.batteryJ > 0.0;
+        } else if (arg == "--threads") {
+            threads = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--step-ms") {
+            config.stepMs = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--regions") {
+            config.regionsPerSide = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--format") {
+            format = value;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            Usage();
+            return 1;
+        }
+        if (used) {
+            ++i;
+        }
+    }
+    if (config.nodes == 0 || config.worldSize <= 0.0 || config.beaconMs == 0 || config.trafficMs == 0) {
+        std::fprintf(stderr, "nodes, world, beacon-ms and traffic-s must be positive\n");
+        return 1;
+    }
+    if (config.cooldownMs >= config.durationMs) {
+        config.cooldownMs = config.durationMs / 10;
+    }
+
+    SimReport report = (threads > 0) ? RunParallelSimulation(config, threads) : RunEventSimulation(config);
+    PrintReport(config, report, format, header);
+    return 0;
+}
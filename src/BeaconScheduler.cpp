@@ -0,0 +1,74 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "BeaconScheduler.h"
+
+namespace {
+    const uint64_t DEFAULT_MAX_INTERVAL_MS = 10000; // A third of THOR's default neighbor timeout
+
+    inline uint32_t Mix(uint32_t nodeId, uint64_t count)
+    {
+        // Murmur3 finalizer over id and beacon count
+        uint32_t h = nodeId ^ static_cast<uint32_t>(count * 0x9E3779B9u);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+}
+
+    BeaconScheduler::BeaconScheduler(const BeaconConfig& config)
+        : minInterval(config.minIntervalMs == 0 ? 1 : config.minIntervalMs),
+          maxInterval(config.maxIntervalMs == 0 ? DEFAULT_MAX_INTERVAL_MS : config.maxIntervalMs),
+          densityNeighbors(config.densityNeighbors),
+          jitterPercent(config.jitterPercent > 100 ? 100 : config.jitterPercent),
+          interval(0), lastSentMs(0), beacons(0), churn(0), jitter(0)
+    {
+        if (maxInterval < minInterval) {
+            maxInterval = minInterval;
+        }
+        interval = minInterval;
+    }
+
+    uint64_t BeaconScheduler::Adapted(bool urgent) const
+    {
+        if (urgent) {
+            return minInterval;
+        }
+        // One halving per churn event
+        uint64_t adapted = (churn >= 63) ? 0 : (interval >> churn);
+        return adapted < minInterval ? minInterval : adapted;
+    }
+
+    uint64_t BeaconScheduler::NextAt(size_t neighbors, bool urgent) const
+    {
+        if (beacons == 0) {
+            return 0;
+        }
+        uint64_t delay = Adapted(urgent);
+        // A route is needed now, stretching for density would only delay it
+        if (!urgent && densityNeighbors > 0) {
+            delay *= 1 + neighbors / densityNeighbors;
+            if (delay > maxInterval) {
+                delay = maxInterval;
+            }
+        }
+        delay -= delay * jitter / 100;
+        return lastSentMs + (delay == 0 ? 1 : delay);
+    }
+
+    void BeaconScheduler::Sent(uint64_t nowMs, uint32_t nodeId, bool urgent)
+    {
+        if (urgent || churn > 0) {
+            interval = Adapted(urgent);
+        } else if (beacons > 0) {
+            // Stable for a whole interval: back off
+            interval = (interval > maxInterval / 2) ? maxInterval : interval * 2;
+        }
+        churn = 0;
+        lastSentMs = nowMs;
+        ++beacons;
+        jitter = jitterPercent ? Mix(nodeId, beacons) % (jitterPercent + 1) : 0;
+    }
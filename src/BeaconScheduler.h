@@ -0,0 +1,52 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef BEACON_SCHEDULER_H
+#define BEACON_SCHEDULER_H
+#include <cstdint>
+#include <cstddef>
+
+struct BeaconConfig {
+    uint64_t minIntervalMs = 1000;   // Fastest HELLO rate: churn, or data queued with no route
+    uint64_t maxIntervalMs = 0;      // Slowest, after backing off. 0 = a third of the neighbor timeout
+    size_t densityNeighbors = 8;     // Each this many neighbors adds one interval of delay, 0 = off
+    uint32_t jitterPercent = 25;     // Each delay is shortened by a random 0..this percent
+};
+
+// Trickle-style HELLO timing. The interval doubles after every beacon sent into a
+// stable neighborhood, up to maxIntervalMs. Churn (neighbors appearing, expiring
+// or changing internet flags) halves it once per event, down to minIntervalMs.
+// With data queued and no route the next beacon is due minIntervalMs after the
+// last one. In crowds the delay is stretched by neighbor count: many nodes
+// beaconing already cover the area. Times are monotonic ms, supplied by the caller.
+class BeaconScheduler
+{
+public:
+    explicit BeaconScheduler(const BeaconConfig& config);
+
+    void Churn(size_t events = 1) { churn += events; }
+    // When the next HELLO is due, for the current table size and route state.
+    // 0 before the first beacon (send at once).
+    uint64_t NextAt(size_t neighbors, bool urgent) const;
+    // A HELLO went out at nowMs: adapts the interval and starts the next one.
+    // nodeId seeds the jitter so neighbors do not beacon in lockstep.
+    void Sent(uint64_t nowMs, uint32_t nodeId, bool urgent);
+
+    uint64_t Interval() const { return interval; }  // Base interval before density and jitter
+    uint64_t Beacons() const { return beacons; }
+
+private:
+    uint64_t Adapted(bool urgent) const;
+
+    uint64_t minInterval;
+    uint64_t maxInterval;
+    size_t densityNeighbors;
+    uint32_t jitterPercent;
+
+    uint64_t interval;
+    uint64_t lastSentMs;
+    uint64_t beacons;
+    size_t churn;       // Events since the last beacon
+    uint32_t jitter;    // Percent drawn for the current interval
+};
+
+#endif /* BEACON_SCHEDULER_H */
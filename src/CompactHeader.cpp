@@ -0,0 +1,137 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "CompactHeader.h"
+#include "WireCodec.h"
+#include <cstring>
+
+namespace {
+    const uint8_t ORIGIN_PRESENT = 0x40;
+    const uint8_t LONG_SEQUENCE = 0x20;
+    const uint8_t RESERVED_BIT = 0x10;
+    const uint8_t TYPE_MASK = 0x0F;
+
+    // 0, 0xFFFFFFFF, 1, 0xFFFFFFFE, ... -> 0, 1, 2, 3, ...
+    inline uint32_t ZigZag(uint32_t id) { return (id << 1) ^ (0u - (id >> 31)); }
+    inline uint32_t UnZigZag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+    inline size_t VarintSize(uint32_t value)
+    {
+        // Comparisons instead of a loop: no data-dependent branches
+        return 1 + (value >= (1u << 7)) + (value >= (1u << 14)) + (value >= (1u << 21)) + (value >= (1u << 28));
+    }
+
+    inline uint8_t* PutVarint(uint8_t* out, uint32_t value)
+    {
+        if (value < 0x80) {
+            *out = static_cast<uint8_t>(value);
+            return out + 1;
+        }
+        while (value >= 0x80) {
+            *out++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(value);
+        return out;
+    }
+
+    // nullptr if truncated or wider than 32 bits
+    inline const uint8_t* GetVarint(const uint8_t* in, const uint8_t* end, uint32_t& outValue)
+    {
+        if (in < end && *in < 0x80) {
+            outValue = *in; // One-byte ids are the common case
+            return in + 1;
+        }
+        uint32_t value = 0;
+        for (unsigned shift = 0; shift <= 28 && in < end; shift += 7) {
+            uint8_t byte = *in++;
+            if (shift == 28 && byte > 0x0F) {
+                return nullptr;
+            }
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                outValue = value;
+                return in;
+            }
+        }
+        return nullptr;
+    }
+
+    inline bool HasOrigin(const Header& header) { return header.originId != header.senderId; }
+    inline bool LongSequence(const Header& header) { return header.sequence > 0xFFFF; }
+}
+
+size_t CompactHeaderSize(const Header& header)
+{
+    bool origin = HasOrigin(header);
+    return 2 + VarintSize(ZigZag(header.destinationId)) + VarintSize(ZigZag(header.senderId)) +
+           (origin ? VarintSize(ZigZag(header.originId)) : 0) + VarintSize(ZigZag(header.nextHopId)) +
+           (LongSequence(header) ? 4 : 2);
+}
+
+size_t EncodeCompactHeader(const Header& header, uint8_t* out, size_t outSize)
+{
+    size_t size = CompactHeaderSize(header);
+    if (out == nullptr || outSize < size) {
+        return 0;
+    }
+    bool origin = HasOrigin(header);
+    bool longSequence = LongSequence(header);
+    uint8_t* p = out;
+    *p++ = static_cast<uint8_t>(COMPACT_HEADER_BIT | (origin ? ORIGIN_PRESENT : 0) | (longSequence ? LONG_SEQUENCE : 0) |
+                                (static_cast<uint8_t>(header.type) & TYPE_MASK));
+    *p++ = PackFlags(header.flagsAndTTL);
+    p = PutVarint(p, ZigZag(header.destinationId));
+    p = PutVarint(p, ZigZag(header.senderId));
+    if (origin) {
+        p = PutVarint(p, ZigZag(header.originId));
+    }
+    p = PutVarint(p, ZigZag(header.nextHopId));
+    uint32_t sequence = header.sequence;
+    *p++ = static_cast<uint8_t>(sequence);
+    *p++ = static_cast<uint8_t>(sequence >> 8);
+    if (longSequence) {
+        *p++ = static_cast<uint8_t>(sequence >> 16);
+        *p++ = static_cast<uint8_t>(sequence >> 24);
+    }
+    return size;
+}
+
+size_t DecodeCompactHeader(const uint8_t* data, size_t size, Header& outHeader)
+{
+    if (data == nullptr || size < COMPACT_HEADER_MIN || (data[0] & COMPACT_HEADER_BIT) == 0 ||
+        (data[0] & RESERVED_BIT) != 0) {
+        return 0;
+    }
+    const uint8_t* end = data + size;
+    Header header = {};
+    header.type = static_cast<THORPacketType>(data[0] & TYPE_MASK);
+    header.flagsAndTTL = UnpackFlags(data[1]);
+
+    uint32_t value = 0;
+    const uint8_t* p = GetVarint(data + 2, end, value);
+    if (p == nullptr) return 0;
+    header.destinationId = UnZigZag(value);
+    if ((p = GetVarint(p, end, value)) == nullptr) return 0;
+    header.senderId = UnZigZag(value);
+    header.originId = header.senderId;
+    if (data[0] & ORIGIN_PRESENT) {
+        if ((p = GetVarint(p, end, value)) == nullptr) return 0;
+        header.originId = UnZigZag(value);
+    }
+    if ((p = GetVarint(p, end, value)) == nullptr) return 0;
+    header.nextHopId = UnZigZag(value);
+
+    size_t sequenceSize = (data[0] & LONG_SEQUENCE) ? 4 : 2;
+    if (static_cast<size_t>(end - p) < sequenceSize) {
+        return 0;
+    }
+    header.sequence = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+    if (sequenceSize == 4) {
+        header.sequence |= (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    p += sequenceSize;
+
+    outHeader = header;
+    return static_cast<size_t>(p - data);
+}
@@ -0,0 +1,36 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef COMPACT_HEADER_H
+#define COMPACT_HEADER_H
+#include <cstdint>
+#include <cstddef>
+#include "THOR.h"
+
+// Variable-length wire form of Header, for 31-byte BLE advertisements.
+//
+//   byte 0   1 (compact) | originPresent | longSequence | 0 | type (4 bits)
+//   byte 1   flags, as in Header
+//   varint   destinationId, senderId, [originId], nextHopId
+//   2 or 4   sequence, little-endian
+//
+// Ids are zigzag varints: small ids and the reserved ids at the top of the range
+// (BROADCAST_ID, 0xFFFFFFFE) take one byte. originId is left out when it equals
+// senderId, which is every frame a node sends itself. Type values never use bit 7,
+// so a receiver tells the two encodings apart from the first byte alone.
+const uint8_t COMPACT_HEADER_BIT = 0x80;
+const size_t COMPACT_HEADER_MIN = 7;   // One-byte ids, 16-bit sequence, no origin
+const size_t COMPACT_HEADER_MAX = 26;  // Every field at full width
+
+// False for a null or empty buffer
+inline bool IsCompactFrame(const uint8_t* data, size_t size)
+{
+    return data != nullptr && size >= 1 && (data[0] & COMPACT_HEADER_BIT) != 0;
+}
+
+size_t CompactHeaderSize(const Header& header);
+// Writes the compact form, returns its size (0 if outSize is too small).
+size_t EncodeCompactHeader(const Header& header, uint8_t* out, size_t outSize);
+// Returns the number of bytes consumed, 0 if the header is truncated or malformed.
+size_t DecodeCompactHeader(const uint8_t* data, size_t size, Header& outHeader);
+
+#endif /* COMPACT_HEADER_H */
@@ -0,0 +1,325 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "ConcurrentTHOR.h"
+#include "WireCodec.h"
+#include <climits>
+#include <cstring>
+
+namespace {
+    size_t RoundUpPow2(size_t value)
+    {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+    ConcurrentTHOR::ConcurrentTHOR(uint32_t myNodeId, const THORConfig& config, size_t ingressSlots, size_t snapshotNeighbors)
+        : node(config), nodeId(myNodeId), cells(RoundUpPow2(ingressSlots)),
+          slotSize(sizeof(Header) + config.maxPayload), mask(cells.size() - 1),
+          enqueuePos(0), dequeuePos(0), version(0), bestHop(0), neighborCount(0), queueSize(0), rowCount(0),
+          rows(snapshotNeighbors)
+    {
+        topRows.reserve(snapshotNeighbors);
+        slots.resize(cells.size() * slotSize);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        frame.resize(slotSize);
+        // One output frame per item in the worst case
+        outbox.reserve(cells.size() * slotSize);
+        spans.reserve(cells.size());
+    }
+
+    ConcurrentTHOR::IngressCell* ConcurrentTHOR::Claim(size_t& outPosition)
+    {
+        size_t position = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            IngressCell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    outPosition = position;
+                    return &cell;
+                }
+            } else if (diff < 0) {
+                return nullptr; // Consumer has not freed this cell yet: full
+            } else {
+                position = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool ConcurrentTHOR::PostData(const uint8_t* data, size_t size)
+    {
+        if (data == nullptr || size > slotSize) {
+            return false;
+        }
+        size_t position = 0;
+        IngressCell* cell = Claim(position);
+        if (cell == nullptr) {
+            return false;
+        }
+        std::memcpy(Slot(position), data, size);
+        cell->kind = IngressKind::DATA;
+        cell->size = static_cast<uint32_t>(size);
+        cell->sequence.store(position + 1, std::memory_order_release); // Publish to the consumer
+        return true;
+    }
+
+    bool ConcurrentTHOR::PostNeighbor(uint32_t nodeIdIn, int rssi, bool hasInternetDirect, bool hasInternetIndirect, bool isVisited)
+    {
+        size_t position = 0;
+        IngressCell* cell = Claim(position);
+        if (cell == nullptr) {
+            return false;
+        }
+        uint8_t flags = 0;
+        if (hasInternetDirect)   flags |= NEIGHBOR_INTERNET_DIRECT;
+        if (hasInternetIndirect) flags |= NEIGHBOR_INTERNET_INDIRECT;
+        if (isVisited)           flags |= NEIGHBOR_VISITED;
+        cell->kind = IngressKind::NEIGHBOR;
+        cell->flags = flags;
+        cell->rssi = rssi;
+        cell->args[0] = nodeIdIn;
+        cell->size = 0;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool ConcurrentTHOR::PostSend(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize)
+    {
+        if (payloadSize > slotSize - sizeof(Header) || (payload == nullptr && payloadSize != 0)) {
+            return false;
+        }
+        size_t position = 0;
+        IngressCell* cell = Claim(position);
+        if (cell == nullptr) {
+            return false;
+        }
+        if (payloadSize != 0) {
+            std::memcpy(Slot(position), payload, payloadSize);
+        }
+        cell->kind = IngressKind::SEND;
+        cell->args[0] = DestId;
+        cell->args[1] = SenderId;
+        cell->args[2] = OriginId;
+        cell->args[3] = Sequence;
+        cell->size = static_cast<uint32_t>(payloadSize);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t ConcurrentTHOR::BeginRead() const
+    {
+        while (true) {
+            uint32_t before = version.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                return before;
+            }
+            // Consumer is mid-publish
+        }
+    }
+
+    bool ConcurrentTHOR::Retry(uint32_t before) const
+    {
+        // The acquire loads of the fields keep this load behind them
+        return version.load(std::memory_order_relaxed) != before;
+    }
+
+    uint32_t ConcurrentTHOR::GetBestNextHop() const
+    {
+        while (true) {
+            uint32_t before = BeginRead();
+            uint32_t hop = bestHop.load(std::memory_order_acquire);
+            if (!Retry(before)) {
+                return hop;
+            }
+        }
+    }
+
+    size_t ConcurrentTHOR::NeighborCount() const
+    {
+        while (true) {
+            uint32_t before = BeginRead();
+            size_t count = neighborCount.load(std::memory_order_acquire);
+            if (!Retry(before)) {
+                return count;
+            }
+        }
+    }
+
+    size_t ConcurrentTHOR::QueueSize() const
+    {
+        while (true) {
+            uint32_t before = BeginRead();
+            size_t size = queueSize.load(std::memory_order_acquire);
+            if (!Retry(before)) {
+                return size;
+            }
+        }
+    }
+
+    void ConcurrentTHOR::Snapshot(RoutingSnapshot& outSnapshot) const
+    {
+        while (true) {
+            uint32_t before = BeginRead();
+            outSnapshot.bestHop = bestHop.load(std::memory_order_acquire);
+            outSnapshot.neighborCount = neighborCount.load(std::memory_order_acquire);
+            outSnapshot.queueSize = queueSize.load(std::memory_order_acquire);
+            size_t count = rowCount.load(std::memory_order_acquire);
+            outSnapshot.neighbors.resize(count < rows.size() ? count : rows.size());
+            for (size_t i = 0; i < outSnapshot.neighbors.size(); ++i) {
+                NeighborSnapshot& neighbor = outSnapshot.neighbors[i];
+                neighbor.nodeId = rows[i].nodeId.load(std::memory_order_acquire);
+                neighbor.score = rows[i].score.load(std::memory_order_acquire);
+                neighbor.rssi = rows[i].rssi.load(std::memory_order_acquire);
+                neighbor.flags = rows[i].flags.load(std::memory_order_acquire);
+            }
+            if (!Retry(before)) {
+                return;
+            }
+        }
+    }
+
+    bool ConcurrentTHOR::GetNeighbor(uint32_t nodeIdIn, NeighborSnapshot& outNeighbor) const
+    {
+        while (true) {
+            uint32_t before = BeginRead();
+            bool found = false;
+            size_t count = rowCount.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count && i < rows.size() && !found; ++i) {
+                if (rows[i].nodeId.load(std::memory_order_acquire) == nodeIdIn) {
+                    outNeighbor.nodeId = nodeIdIn;
+                    outNeighbor.score = rows[i].score.load(std::memory_order_acquire);
+                    outNeighbor.rssi = rows[i].rssi.load(std::memory_order_acquire);
+                    outNeighbor.flags = rows[i].flags.load(std::memory_order_acquire);
+                    found = true;
+                }
+            }
+            if (!Retry(before)) {
+                return found;
+            }
+        }
+    }
+
+    void ConcurrentTHOR::Publish()
+    {
+        // Gather first, so the write window stays short
+        const NeighborTable& table = node.GetNeighborTable();
+        table.TopRows(rows.size(), INT_MIN, topRows);
+        uint32_t hop = node.GetBestNextHop();
+
+        // Single writer: bump to odd, store, bump to even. The fields are release stores
+        // and their reads acquire loads, so a reader that sees any new field also sees the
+        // odd version and retries (no fences, which ThreadSanitizer cannot follow).
+        uint32_t current = version.load(std::memory_order_relaxed);
+        version.store(current + 1, std::memory_order_relaxed);
+        bestHop.store(hop, std::memory_order_release);
+        neighborCount.store(static_cast<uint32_t>(node.NeighborCount()), std::memory_order_release);
+        queueSize.store(static_cast<uint32_t>(node.QueueSize()), std::memory_order_release);
+        for (size_t i = 0; i < topRows.size(); ++i) {
+            uint32_t row = topRows[i];
+            rows[i].nodeId.store(table.Ids()[row], std::memory_order_release);
+            rows[i].score.store(table.Scores()[row], std::memory_order_release);
+            rows[i].rssi.store(table.Rssi()[row], std::memory_order_release);
+            rows[i].flags.store(table.Flags()[row], std::memory_order_release);
+        }
+        rowCount.store(static_cast<uint32_t>(topRows.size()), std::memory_order_release);
+        version.store(current + 2, std::memory_order_release);
+    }
+
+    void ConcurrentTHOR::AppendOut(const uint8_t* data, size_t size, bool delivered)
+    {
+        spans.push_back({ outbox.size(), size, delivered });
+        outbox.insert(outbox.end(), data, data + size);
+    }
+
+    void ConcurrentTHOR::AppendDelivered(const PacketView& view)
+    {
+        size_t offset = outbox.size();
+        outbox.resize(offset + sizeof(Header) + view.payloadSize);
+        EncodeHeader(view.header, outbox.data() + offset);
+        if (view.payloadSize > 0) {
+            std::memcpy(outbox.data() + offset + sizeof(Header), view.payload, view.payloadSize);
+        }
+        spans.push_back({ offset, sizeof(Header) + view.payloadSize, true });
+    }
+
+    size_t ConcurrentTHOR::Poll(std::vector<FrameView>& outFrames, std::vector<PacketView>& outDelivered, size_t maxItems)
+    {
+        outFrames.clear();
+        outDelivered.clear();
+        outbox.clear();
+        spans.clear();
+
+        size_t handled = 0;
+        while (maxItems == 0 || handled < maxItems) {
+            IngressCell& cell = cells[dequeuePos & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                break; // Empty (or the next producer is still writing)
+            }
+            const uint8_t* slot = Slot(dequeuePos);
+            size_t written = 0;
+
+            switch (cell.kind) {
+            case IngressKind::DATA: {
+                PacketView view;
+                THORVerdict verdict;
+                written = node.HandleData(slot, cell.size, view, nodeId, frame.data(), frame.size(), verdict);
+                if (verdict == THORVerdict::DELIVER) {
+                    AppendDelivered(view); // May be a reassembled message, not the frame in the slot
+                }
+                break;
+            }
+            case IngressKind::NEIGHBOR:
+                node.NeighborStore(cell.args[0], cell.rssi, (cell.flags & NEIGHBOR_INTERNET_DIRECT) != 0,
+                                   (cell.flags & NEIGHBOR_INTERNET_INDIRECT) != 0, (cell.flags & NEIGHBOR_VISITED) != 0);
+                break;
+            case IngressKind::SEND:
+                written = node.SendPacket(cell.args[0], cell.args[1], cell.args[2], cell.args[3], slot, cell.size, frame.data(), frame.size());
+                break;
+            }
+            if (written > 0) {
+                AppendOut(frame.data(), written, false);
+            }
+
+            // Hand the cell back to the producers, one lap later
+            cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+            ++dequeuePos;
+            ++handled;
+        }
+
+        // The outbox no longer grows: views into it are stable now
+        for (const OutSpan& span : spans) {
+            const uint8_t* data = outbox.data() + span.offset;
+            if (span.delivered) {
+                PacketView view;
+                node.Deserialize(data, span.size, view);
+                outDelivered.push_back(view);
+            } else {
+                outFrames.push_back({ data, span.size });
+            }
+        }
+        if (handled > 0) {
+            Publish();
+        }
+        return handled;
+    }
+
+    size_t ConcurrentTHOR::ProcessQueue(std::vector<FrameView>& outFrames)
+    {
+        size_t count = node.ProcessQueue(outFrames);
+        Publish();
+        return count;
+    }
+
+    void ConcurrentTHOR::RemoveOld()
+    {
+        node.RemoveOld();
+        Publish();
+    }
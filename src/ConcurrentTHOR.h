@@ -0,0 +1,137 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef CONCURRENT_THOR_H
+#define CONCURRENT_THOR_H
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "THOR.h"
+
+// THOR node shared by several threads (BLE scan callback, GATT callback, timers).
+//
+// Producer threads never touch the routing state: PostData, PostNeighbor and
+// PostSend copy their input into a bounded lock-free MPSC ring and return.
+// One consumer thread owns the THOR instance and applies the ring in order in
+// Poll, then runs ProcessQueue / RemoveOld. After every consumer step a routing
+// snapshot (best hop, table and queue size, and the best snapshotNeighbors rows) is
+// published through a seqlock, so readers are lock-free from any thread and never
+// wait for maintenance.
+
+// One neighbor as published, best first
+struct NeighborSnapshot {
+    uint32_t nodeId;
+    int score;                // As GetBestNextHop ranks it, learned bonus included
+    int rssi;
+    uint8_t flags;            // NEIGHBOR_* bits
+};
+
+struct RoutingSnapshot {
+    uint32_t bestHop;
+    size_t neighborCount;     // Whole table, may be more than neighbors.size()
+    size_t queueSize;
+    std::vector<NeighborSnapshot> neighbors;
+};
+
+class ConcurrentTHOR
+{
+public:
+    // ingressSlots is rounded up to a power of two. Each slot holds one frame
+    // (header + config.maxPayload), allocated once here, like the snapshot rows.
+    ConcurrentTHOR(uint32_t myNodeId, const THORConfig& config = THORConfig(), size_t ingressSlots = 256,
+                   size_t snapshotNeighbors = 64);
+    ConcurrentTHOR(const ConcurrentTHOR&) = delete;
+    ConcurrentTHOR& operator=(const ConcurrentTHOR&) = delete;
+
+    // --- Any thread. Lock-free, never block. false = ring full or frame too big. ---
+    bool PostData(const uint8_t* data, size_t size);
+    bool PostNeighbor(uint32_t nodeId, int rssi, bool hasInternetDirect, bool hasInternetIndirect, bool isVisited);
+    bool PostSend(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize);
+
+    // Snapshot readers, consistent as of the last consumer step.
+    uint32_t GetBestNextHop() const;
+    size_t NeighborCount() const;
+    size_t QueueSize() const;
+    // Every published field from one consumer step. Does not allocate once outSnapshot
+    // has held snapshotNeighbors rows.
+    void Snapshot(RoutingSnapshot& outSnapshot) const;
+    // Published row of nodeId. False if it is not among the best snapshotNeighbors
+    bool GetNeighbor(uint32_t nodeId, NeighborSnapshot& outNeighbor) const;
+
+    // --- Consumer thread only. ---
+    // Applies up to maxItems posted items (0 = all). outFrames gets the frames to
+    // transmit (forwarded DATA and routed sends), outDelivered the DATA addressed
+    // to this node. Both point into an internal buffer valid until the next Poll.
+    size_t Poll(std::vector<FrameView>& outFrames, std::vector<PacketView>& outDelivered, size_t maxItems = 0);
+    size_t ProcessQueue(std::vector<FrameView>& outFrames);
+    void RemoveOld();
+    // Direct access for everything else (DrainQueue, stats, ...). Call Publish afterwards
+    // if the neighbor table or queue may have changed.
+    THOR& Node() { return node; }
+    void Publish();
+
+private:
+    enum class IngressKind : uint8_t {
+        DATA     = 1,
+        NEIGHBOR = 2,
+        SEND     = 3
+    };
+
+    struct IngressCell {
+        std::atomic<size_t> sequence; // Vyukov ring: == position when free, position + 1 when full
+        IngressKind kind;
+        uint8_t flags;                // NEIGHBOR: NEIGHBOR_* bits
+        int rssi;
+        uint32_t args[4];             // NEIGHBOR: id / SEND: dest, sender, origin, sequence
+        uint32_t size;                // Bytes in the slot
+    };
+
+    // Reserves the next free cell for a producer, nullptr when the ring is full.
+    IngressCell* Claim(size_t& outPosition);
+    uint8_t* Slot(size_t position) { return slots.data() + (position & mask) * slotSize; }
+    void AppendOut(const uint8_t* data, size_t size, bool delivered);
+    void AppendDelivered(const PacketView& view);
+
+    THOR node;
+    uint32_t nodeId;
+
+    // Ingress ring
+    std::vector<IngressCell> cells;
+    std::vector<uint8_t> slots;
+    size_t slotSize;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;   // Consumer only
+
+    // Consumer scratch (reserved at construction)
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> outbox;
+    struct OutSpan {
+        size_t offset;
+        size_t size;
+        bool delivered;
+    };
+    std::vector<OutSpan> spans;
+
+    // Seqlock-protected snapshot (odd version = write in progress). Every field is an
+    // atomic, so a reader that overlaps a write is retried, never undefined.
+    struct SnapshotRow {
+        std::atomic<uint32_t> nodeId;
+        std::atomic<int> score;
+        std::atomic<int> rssi;
+        std::atomic<uint8_t> flags;
+    };
+    // Begin / Retry bracket a read: Retry is true if a write overlapped it
+    uint32_t BeginRead() const;
+    bool Retry(uint32_t before) const;
+
+    alignas(64) std::atomic<uint32_t> version;
+    std::atomic<uint32_t> bestHop;
+    std::atomic<uint32_t> neighborCount;
+    std::atomic<uint32_t> queueSize;
+    std::atomic<uint32_t> rowCount;
+    std::vector<SnapshotRow> rows;
+    std::vector<uint32_t> topRows;    // Publish scratch (consumer only)
+};
+
+#endif /* CONCURRENT_THOR_H */
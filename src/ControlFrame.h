@@ -0,0 +1,53 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef CONTROL_FRAME_H
+#define CONTROL_FRAME_H
+#include <cstdint>
+#include <cstddef>
+
+// Aggregated control frame (THORPacketType::CONTROL). The header announces the
+// sender like an ACK does (myInternet / intneighbour) and is followed by
+//   uint8_t ackCount, uint8_t neighborCount, uint64_t neighborBitmap,
+//   ackCount x { uint32_t originId, uint32_t sequence }
+// One broadcast replaces a HELLO plus one ACK per HELLO heard since the last one.
+const size_t CONTROL_BODY_SIZE = 10;  // Fixed part after the header
+const size_t CONTROL_ACK_SIZE = 8;
+const size_t CONTROL_MAX_ACKS = 32;   // Pending ACKs kept between two control frames
+
+struct ControlAck {
+    uint32_t originId;  // Node whose HELLO is acknowledged
+    uint32_t sequence;  // Sequence of that HELLO
+};
+static_assert(sizeof(ControlAck) == CONTROL_ACK_SIZE, "ControlAck matches its wire size");
+
+// Bit of a node id in the 64-bit neighbor summary
+inline uint64_t NeighborSummaryBit(uint32_t nodeId)
+{
+    uint32_t h = nodeId * 0x9E3779B1u;
+    return 1ull << (h >> 26);
+}
+
+// Decoded body of a control frame. The ACK entries stay in the source buffer.
+struct ControlView {
+    uint8_t ackCount;
+    uint8_t neighborCount;    // Sender's neighbor table size, saturated at 255
+    uint64_t neighborBitmap;  // OR of NeighborSummaryBit over the sender's neighbors
+    const uint8_t* acks;      // ackCount packed ControlAck entries
+
+    ControlAck Ack(size_t index) const;
+    bool Acknowledges(uint32_t originId, uint32_t sequence) const;
+    // Whether the sender may have nodeId as a neighbor (false positives possible, no false negatives)
+    bool MayKnow(uint32_t nodeId) const { return (neighborBitmap & NeighborSummaryBit(nodeId)) != 0; }
+};
+
+// Congestion signal, appended to HELLO and ACK frames after the header and to CONTROL
+// frames after the ACK entries. Receivers that predate it ignore trailing bytes; a frame
+// without it leaves the sender's previous (or unlimited) credits in place.
+const size_t LOAD_ADVERT_SIZE = 2;
+
+struct LoadAdvert {
+    uint8_t load;     // Queue occupancy, 0..255 = empty..full
+    uint8_t credits;  // Frames each neighbor may still send before the next advertisement
+};
+
+#endif /* CONTROL_FRAME_H */
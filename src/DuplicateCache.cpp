@@ -0,0 +1,135 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "DuplicateCache.h"
+
+namespace {
+    inline size_t HashKey(uint32_t originId, uint32_t sequence, uint16_t part)
+    {
+        uint64_t key = (static_cast<uint64_t>(originId) << 32) | sequence;
+        key ^= static_cast<uint64_t>(part) * 0x9E3779B97F4A7C15ull;
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+}
+
+    DuplicateCache::DuplicateCache(size_t capacity, uint64_t maxAge)
+        : ring(capacity == 0 ? 1 : capacity), head(0), count(0), unstamped(0), mask(0), maxAgeMs(maxAge), hits(0), misses(0)
+    {
+        // Index at least eight times the ring size: every send inserts and evicts, and
+        // the probes past a miss (unpredictable branches) are most of that cost
+        size_t slotCount = 1;
+        while (slotCount < ring.size() * 8) {
+            slotCount <<= 1;
+        }
+        slots.assign(slotCount, -1);
+        mask = slotCount - 1;
+    }
+
+    size_t DuplicateCache::SlotOf(uint32_t originId, uint32_t sequence, uint16_t part, size_t home) const
+    {
+        size_t slot = home;
+        while (slots[slot] != -1) {
+            const Entry& entry = ring[slots[slot]];
+            if (entry.originId == originId && entry.sequence == sequence && entry.part == part) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void DuplicateCache::EraseOldest()
+    {
+        // The oldest entry's slot is the one holding its ring position
+        size_t hole = ring[head].home;
+        while (slots[hole] != static_cast<int32_t>(head)) {
+            hole = (hole + 1) & mask;
+        }
+
+        // Backward-shift delete, same scheme as NeighborTable
+        size_t next = hole;
+        while (true) {
+            next = (next + 1) & mask;
+            if (slots[next] == -1) {
+                break;
+            }
+            // Move the entry back if its home slot is not inside (hole, next]
+            size_t home = ring[slots[next]].home;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = -1;
+
+        head = (head + 1 == ring.size()) ? 0 : head + 1;
+        --count;
+        if (unstamped > count) {
+            unstamped = count;
+        }
+    }
+
+    void DuplicateCache::Insert(uint32_t originId, uint32_t sequence, uint16_t part, size_t home, size_t slot, uint64_t nowMs)
+    {
+        if (count == ring.size()) {
+            EraseOldest();
+            slot = SlotOf(originId, sequence, part, home);
+        }
+        size_t pos = head + count;
+        if (pos >= ring.size()) {
+            pos -= ring.size();
+        }
+        ring[pos] = { originId, sequence, nowMs, part, static_cast<uint32_t>(home) };
+        slots[slot] = static_cast<int32_t>(pos);
+        ++count;
+    }
+
+    bool DuplicateCache::CheckAndInsert(uint32_t originId, uint32_t sequence, uint64_t nowMs, uint16_t part)
+    {
+        // 1. Stamp what Record added since the last call
+        for (; unstamped > 0; --unstamped) {
+            size_t pos = head + count - unstamped;
+            ring[pos >= ring.size() ? pos - ring.size() : pos].seenMs = nowMs;
+        }
+
+        // 2. Expire from the old end (entries are in arrival order). A clock that stepped
+        // back leaves everything in place.
+        while (count > 0 && nowMs > ring[head].seenMs && nowMs - ring[head].seenMs > maxAgeMs) {
+            EraseOldest();
+        }
+
+        // 3. Seen recently?
+        size_t home = HashKey(originId, sequence, part) & mask;
+        size_t slot = SlotOf(originId, sequence, part, home);
+        if (slots[slot] != -1) {
+            ++hits;
+            return true;
+        }
+
+        // 4. Record it
+        ++misses;
+        Insert(originId, sequence, part, home, slot, nowMs);
+        return false;
+    }
+
+    void DuplicateCache::Record(uint32_t originId, uint32_t sequence, uint16_t part)
+    {
+        size_t home = HashKey(originId, sequence, part) & mask;
+        size_t slot = SlotOf(originId, sequence, part, home);
+        if (slots[slot] != -1) {
+            return; // Sent twice: keep the first entry
+        }
+        Insert(originId, sequence, part, home, slot, 0);
+        ++unstamped;
+    }
+
+    void DuplicateCache::Clear()
+    {
+        slots.assign(slots.size(), -1);
+        head = 0;
+        count = 0;
+        unstamped = 0;
+    }
@@ -0,0 +1,63 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef DUPLICATE_CACHE_H
+#define DUPLICATE_CACHE_H
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Defaults for THORConfig::duplicateCapacity / duplicateMaxAgeMs
+const size_t DUPLICATE_CACHE_SIZE = 128;       // (originId, sequence) pairs remembered
+const uint64_t DUPLICATE_MAX_AGE_MS = 60000;   // Before a pair may be accepted again
+
+// Bounded "recently seen" set of (originId, sequence, part) keys. 'part' tells the
+// fragments of one message apart: 0 = a whole DATA frame, index + 1 = a fragment.
+// A ring buffer holds the entries in arrival order (oldest evicted first) and a
+// compact open-addressing index of ring positions answers lookups. Memory is
+// fixed at construction.
+// Record needs no clock: its entries are stamped with the time of the next
+// CheckAndInsert, so they live at most that much longer than maxAgeMs.
+class DuplicateCache
+{
+public:
+    DuplicateCache(size_t capacity, uint64_t maxAgeMs);
+
+    // True if the key was seen at most maxAgeMs ago, otherwise records it.
+    bool CheckAndInsert(uint32_t originId, uint32_t sequence, uint64_t nowMs, uint16_t part = 0);
+    // Records a key without checking it or counting a hit or miss (own sends)
+    void Record(uint32_t originId, uint32_t sequence, uint16_t part = 0);
+    void Clear();
+
+    size_t Size() const { return count; }
+
+    uint64_t Hits() const { return hits; }
+    uint64_t Misses() const { return misses; }
+
+private:
+    struct Entry {
+        uint32_t originId;
+        uint32_t sequence;
+        uint64_t seenMs;
+        uint16_t part;
+        uint32_t home;  // Index slot the key hashes to, kept so eviction needs no rehash
+    };
+
+    // Slot holding the key, or the empty slot where it would go; probing starts at 'home'
+    size_t SlotOf(uint32_t originId, uint32_t sequence, uint16_t part, size_t home) const;
+    // Appends a key known to be absent, evicting the oldest entry when full
+    void Insert(uint32_t originId, uint32_t sequence, uint16_t part, size_t home, size_t slot, uint64_t nowMs);
+    void EraseOldest();
+
+    std::vector<Entry>   ring;
+    size_t head;                 // Oldest entry
+    size_t count;
+    size_t unstamped;            // Newest entries from Record, still without a time
+    std::vector<int32_t> slots;  // Ring position, -1 = empty. Size is a power of two.
+    size_t mask;
+    uint64_t maxAgeMs;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+#endif /* DUPLICATE_CACHE_H */
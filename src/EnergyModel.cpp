@@ -0,0 +1,88 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "EnergyModel.h"
+
+namespace {
+    const uint32_t MAX_ATTEMPTS = 255; // Expected attempts x256 must fit the uint16_t table
+
+    // Loss per attempt at this RSSI, 0..1
+    double LossAt(const EnergyConfig& config, int rssi)
+    {
+        double maxLoss = (config.maxLossPercent > 99 ? 99 : config.maxLossPercent) / 100.0;
+        if (rssi >= config.goodRssi) {
+            return 0.0;
+        }
+        if (rssi <= config.deadRssi || config.goodRssi <= config.deadRssi) {
+            return maxLoss;
+        }
+        return maxLoss * (config.goodRssi - rssi) / (config.goodRssi - config.deadRssi);
+    }
+}
+
+    EnergyModel::EnergyModel(const EnergyConfig& config)
+        : txPerByte(static_cast<uint64_t>(config.txPowerMw) * 8000 * 256 / (config.bitrateKbps == 0 ? 1 : config.bitrateKbps)),
+          rxPerByte(static_cast<uint64_t>(config.rxPowerMw) * 8000 * 256 / (config.bitrateKbps == 0 ? 1 : config.bitrateKbps)),
+          overheadBytes(config.frameOverheadBytes), wakeNj(config.frameWakeNj),
+          budgeted(config.budgeted), weight(config.energyWeight), lowPercent(config.lowPercent > 100 ? 100 : config.lowPercent),
+          candidates(config.candidates == 0 ? 1 : config.candidates),
+          remaining(0), full(0), steering(false), pressure(0), low(false), stats()
+    {
+        // Attempts until one gets through or the link layer gives up:
+        // 1 + p + p^2 + ... + p^(n-1) for a loss p per attempt
+        uint32_t limit = config.maxAttempts == 0 ? 1 : (config.maxAttempts > MAX_ATTEMPTS ? MAX_ATTEMPTS : config.maxAttempts);
+        for (int rssi = -128; rssi <= 127; ++rssi) {
+            double loss = LossAt(config, rssi);
+            double expected = 0.0;
+            double term = 1.0;
+            for (uint32_t k = 0; k < limit; ++k) {
+                expected += term;
+                term *= loss;
+            }
+            attempts[Index(rssi)] = static_cast<uint16_t>(expected * 256.0 + 0.5);
+        }
+    }
+
+    void EnergyModel::Sent(size_t bytes, size_t frames, int rssi)
+    {
+        uint64_t nj = LinkNj(bytes, frames, rssi);
+        stats.txFrames += frames;
+        stats.txNj += nj;
+        Spend(nj);
+    }
+
+    void EnergyModel::Broadcast(size_t bytes)
+    {
+        uint64_t nj = TxNj(bytes, 1);
+        ++stats.txFrames;
+        stats.txNj += nj;
+        Spend(nj);
+    }
+
+    void EnergyModel::Received(size_t bytes)
+    {
+        uint64_t nj = RxNj(bytes, 1);
+        ++stats.rxFrames;
+        stats.rxNj += nj;
+        Spend(nj);
+    }
+
+    void EnergyModel::SetBudget(uint64_t remainingNj, uint64_t fullNj)
+    {
+        full = fullNj;
+        remaining = (fullNj != 0 && remainingNj > fullNj) ? fullNj : remainingNj;
+        steering = budgeted && full != 0;
+        Spend(0);
+    }
+
+    void EnergyModel::Spend(uint64_t nj)
+    {
+        remaining = (remaining > nj) ? remaining - nj : 0;
+        if (!steering) {
+            return;
+        }
+        // In double: remaining x 256 may not fit 64 bits for a budget given as UINT64_MAX
+        double left = static_cast<double>(remaining) / static_cast<double>(full);
+        pressure = static_cast<uint32_t>(256.0 - left * 256.0);
+        low = left * 100.0 < lowPercent;
+    }
@@ -0,0 +1,98 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+#include <cstdint>
+#include <cstddef>
+
+// Radio costs, in mW, bytes and nJ. Defaults: a BLE 1M radio at 0 dBm on a 3 V supply.
+struct EnergyConfig {
+    uint32_t txPowerMw = 18;          // Draw while transmitting
+    uint32_t rxPowerMw = 16;          // Draw while receiving
+    uint32_t bitrateKbps = 1000;      // PHY rate: 1000 = LE 1M, 2000 = LE 2M, 125 = LE Coded S8
+    uint32_t frameOverheadBytes = 21; // Around every frame: preamble, access address, LL header, MIC, CRC, L2CAP, ATT
+    uint32_t frameWakeNj = 3000;      // Fixed cost per frame: ramp-up, turnaround, the peer's link-layer ACK
+    int goodRssi = -70;               // At or above: every attempt gets through
+    int deadRssi = -100;              // At or below: maxLossPercent of attempts are lost
+    uint32_t maxLossPercent = 90;     // Loss grows linearly between goodRssi and deadRssi
+    uint32_t maxAttempts = 8;         // Link-layer retry limit
+    bool budgeted = false;            // Let the budget from SetEnergyBudget steer routing
+    int energyWeight = 50;            // Budgeted: score points per expected retransmission, on an empty battery
+    uint32_t lowPercent = 20;         // Budgeted: below this much of the budget, relay only toward the internet
+    size_t candidates = 4;            // Budgeted: best neighbors weighed against their cost
+};
+
+struct EnergyStats {
+    uint64_t txFrames;
+    uint64_t txNj;      // Expected, retransmissions included
+    uint64_t rxFrames;
+    uint64_t rxNj;
+    uint64_t held;      // Budgeted: relayed frames queued instead of sent on a low battery
+};
+
+// Estimated radio energy per frame, and the battery budget it is spent from.
+// A frame costs its airtime at the radio's draw plus a fixed wake-up cost. Unicast
+// frames are sent again until the link layer gets an ACK: the expected number of
+// attempts comes from the link's RSSI. Advertising frames (HELLO, ACK, CONTROL)
+// go out once. A frame's cost is a table lookup and a few integer multiply-adds.
+class EnergyModel
+{
+public:
+    explicit EnergyModel(const EnergyConfig& config);
+
+    // Expected attempts per frame at this RSSI, x256 (256 = first time, every time)
+    uint32_t Attempts(int rssi) const { return attempts[Index(rssi)]; }
+    // Cost of 'frames' frames totalling 'bytes', each on the air once
+    uint64_t TxNj(size_t bytes, size_t frames) const { return Cost(bytes, frames, txPerByte); }
+    uint64_t RxNj(size_t bytes, size_t frames) const { return Cost(bytes, frames, rxPerByte); }
+    // Same, with the retransmissions a link at this RSSI needs
+    uint64_t LinkNj(size_t bytes, size_t frames, int rssi) const { return (TxNj(bytes, frames) * Attempts(rssi)) >> 8; }
+
+    // Spend from the budget: unicast frames on a link, one advertising frame, one frame heard
+    void Sent(size_t bytes, size_t frames, int rssi);
+    void Broadcast(size_t bytes);
+    void Received(size_t bytes);
+    void Held() { ++stats.held; }
+
+    // Battery the wrapper measured; sends spend it until the next call. fullNj 0 = no budget
+    void SetBudget(uint64_t remainingNj, uint64_t fullNj);
+    uint64_t Remaining() const { return remaining; }
+    // Budgeted mode with a budget set
+    bool Steering() const { return steering; }
+    // How much of the budget is gone, 0..256. Always 0 unless Steering()
+    uint32_t Pressure() const { return pressure; }
+    // Below lowPercent of the budget. Never unless Steering()
+    bool Low() const { return low; }
+
+    int Weight() const { return weight; }
+    size_t Candidates() const { return candidates; }
+    const EnergyStats& Stats() const { return stats; }
+
+private:
+    static size_t Index(int rssi) { return static_cast<size_t>((rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi)) + 128); }
+    uint64_t Cost(size_t bytes, size_t frames, uint64_t perByte) const
+    {
+        return ((static_cast<uint64_t>(bytes + frames * overheadBytes) * perByte) >> 8) + frames * wakeNj;
+    }
+    void Spend(uint64_t nj);
+
+    uint64_t txPerByte;   // nJ per byte on the air, x256
+    uint64_t rxPerByte;
+    size_t overheadBytes;
+    uint64_t wakeNj;
+    uint16_t attempts[256];
+
+    bool budgeted;
+    int weight;
+    uint32_t lowPercent;
+    size_t candidates;
+
+    uint64_t remaining;
+    uint64_t full;
+    bool steering;
+    uint32_t pressure;
+    bool low;
+    EnergyStats stats;
+};
+
+#endif /* ENERGY_MODEL_H */
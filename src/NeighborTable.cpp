@@ -0,0 +1,515 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "NeighborTable.h"
+#include <algorithm>
+#include "ScoreKernel.h"
+
+namespace {
+    const size_t INITIAL_SLOTS = 16;
+    const size_t WHEEL_BUCKETS = 64;   // One rotation covers about one timeout
+
+    inline size_t HashId(uint32_t id)
+    {
+        // Murmur3 finalizer: node ids are often sequential, spread them out
+        id ^= id >> 16;
+        id *= 0x85EBCA6Bu;
+        id ^= id >> 13;
+        id *= 0xC2B2AE35u;
+        id ^= id >> 16;
+        return id;
+    }
+
+    inline int8_t SaturateRssi(int rssi)
+    {
+        if (rssi < -128) return -128;
+        if (rssi > 127) return 127;
+        return static_cast<int8_t>(rssi);
+    }
+
+    inline LinkStats FreshLink(uint64_t nowMs)
+    {
+        LinkStats link = {};
+        link.delivery = LINK_DELIVERY_NEUTRAL;
+        link.decayedAt = nowMs;
+        link.pendingSince = LINK_NOT_PENDING;
+        link.credits = LINK_CREDITS_UNLIMITED;
+        return link;
+    }
+
+    inline uint16_t SaturatingIncrement(uint16_t value)
+    {
+        return static_cast<uint16_t>(value == UINT16_MAX ? value : value + 1);
+    }
+}
+
+    NeighborTable::NeighborTable(NeighborScorer scoreFn, uint64_t timeout, uint64_t linkDecay)
+        : scorer(scoreFn), slots(INITIAL_SLOTS, -1), mask(INITIAL_SLOTS - 1),
+          timeoutMs(timeout), tickMs(timeout / WHEEL_BUCKETS), lastTick(0), wheel(WHEEL_BUCKETS),
+          linkDecayMs(linkDecay)
+    {
+        if (tickMs == 0) {
+            tickMs = 1;
+        }
+    }
+
+    void NeighborTable::Schedule(size_t row)
+    {
+        // First tick whose start is past lastSeen + timeout (expiry is strict '>')
+        uint64_t tick = DueTick(row);
+        if (expiryTick[row] != 0 && expiryTick[row] <= tick) {
+            return; // The entry already in the wheel fires first, Expire moves it on
+        }
+        // Only a clock step back gets here with an entry: the old one stays behind and is skipped as stale
+        expiryTick[row] = tick;
+        wheel[tick % WHEEL_BUCKETS].push_back({ ids[row], tick });
+    }
+
+    size_t NeighborTable::Expire(uint64_t nowMs)
+    {
+        size_t removed = 0;
+        uint64_t nowTick = nowMs / tickMs;
+        if (nowTick <= lastTick) {
+            return 0;
+        }
+        // After a long gap each bucket only needs one visit
+        uint64_t first = (nowTick - lastTick > WHEEL_BUCKETS) ? nowTick - WHEEL_BUCKETS + 1 : lastTick + 1;
+
+        for (uint64_t tick = first; tick <= nowTick; ++tick) {
+            std::vector<WheelEntry>& bucket = wheel[tick % WHEEL_BUCKETS];
+            size_t i = 0;
+            while (i < bucket.size()) {
+                WheelEntry entry = bucket[i];
+                if (entry.tick > nowTick) {
+                    ++i; // Due in a later rotation
+                    continue;
+                }
+                long row = Find(entry.nodeId);
+                bool current = (row >= 0 && expiryTick[row] == entry.tick);
+                if (current && nowMs > lastSeen[row] && nowMs - lastSeen[row] > timeoutMs) {
+                    RemoveAt(static_cast<size_t>(row));
+                    ++removed;
+                } else if (current) {
+                    // Heard from since it was scheduled: move the entry to its new tick (always past nowTick)
+                    uint64_t due = DueTick(static_cast<size_t>(row));
+                    expiryTick[row] = due;
+                    wheel[due % WHEEL_BUCKETS].push_back({ entry.nodeId, due });
+                }
+                // Expired, moved or stale: swap-remove from the bucket
+                bucket[i] = bucket.back();
+                bucket.pop_back();
+            }
+        }
+        lastTick = nowTick;
+        return removed;
+    }
+
+    void NeighborTable::SetScorer(NeighborScorer scoreFn, const RoutingPolicy& scorePolicy)
+    {
+        scorer = scoreFn;
+        policy = scorePolicy;
+        RescoreAll(false);
+    }
+
+    void NeighborTable::SetPolicyScorer(NeighborScorer scoreFn, const RoutingPolicy& scorePolicy)
+    {
+        scorer = scoreFn;
+        policy = scorePolicy;
+        RescoreAll(true);
+    }
+
+    void NeighborTable::RescoreAll(bool vectorized)
+    {
+        if (vectorized) {
+            ScoreNeighborsBatch(policy, flags.data(), rssi.data(), ids.size(), scores.data());
+        } else {
+            for (size_t row = 0; row < ids.size(); ++row) {
+                scores[row] = scorer(policy, flags[row], rssi[row]);
+            }
+        }
+        // The weights may have changed with the policy
+        for (size_t row = 0; row < ids.size(); ++row) {
+            learned[row] = LinkBonus(links[row]);
+            scores[row] += learned[row];
+        }
+        // Bottom-up heapify
+        for (size_t pos = heap.size() / 2; pos-- > 0;) {
+            SiftDown(pos);
+        }
+    }
+
+    bool NeighborTable::Better(uint32_t rowA, uint32_t rowB) const
+    {
+        return scores[rowA] > scores[rowB] || (scores[rowA] == scores[rowB] && ids[rowA] < ids[rowB]);
+    }
+
+    void NeighborTable::HeapSet(size_t pos, uint32_t row)
+    {
+        heap[pos] = row;
+        heapPos[row] = static_cast<uint32_t>(pos);
+    }
+
+    void NeighborTable::SiftUp(size_t pos)
+    {
+        uint32_t row = heap[pos];
+        while (pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if (!Better(row, heap[parent])) {
+                break;
+            }
+            HeapSet(pos, heap[parent]);
+            pos = parent;
+        }
+        HeapSet(pos, row);
+    }
+
+    void NeighborTable::SiftDown(size_t pos)
+    {
+        uint32_t row = heap[pos];
+        size_t count = heap.size();
+        while (true) {
+            size_t child = 2 * pos + 1;
+            if (child >= count) {
+                break;
+            }
+            if (child + 1 < count && Better(heap[child + 1], heap[child])) {
+                ++child;
+            }
+            if (!Better(heap[child], row)) {
+                break;
+            }
+            HeapSet(pos, heap[child]);
+            pos = child;
+        }
+        HeapSet(pos, row);
+    }
+
+    void NeighborTable::Rescore(size_t row)
+    {
+        int score = scorer(policy, flags[row], rssi[row]) + learned[row];
+        int old = scores[row];
+        scores[row] = score;
+        if (score > old) {
+            SiftUp(heapPos[row]);
+        } else if (score < old) {
+            SiftDown(heapPos[row]);
+        }
+    }
+
+    size_t NeighborTable::SlotOf(uint32_t nodeId) const
+    {
+        // Either the slot holding nodeId or the empty slot where it belongs
+        size_t slot = HashId(nodeId) & mask;
+        while (slots[slot] != -1 && ids[slots[slot]] != nodeId) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void NeighborTable::Grow()
+    {
+        std::vector<int32_t> bigger(slots.size() * 2, -1);
+        slots.swap(bigger);
+        mask = slots.size() - 1;
+        for (size_t row = 0; row < ids.size(); ++row) {
+            slots[SlotOf(ids[row])] = static_cast<int32_t>(row);
+        }
+    }
+
+    void NeighborTable::Store(uint32_t nodeId, uint64_t seen, int signal, uint8_t flagBits)
+    {
+        size_t slot = SlotOf(nodeId);
+        size_t row = 0;
+
+        if (slots[slot] != -1) {
+            row = static_cast<size_t>(slots[slot]);
+        } else {
+            // Keep the load factor under 1/2 so probe chains stay short
+            if ((ids.size() + 1) * 2 > slots.size()) {
+                Grow();
+                slot = SlotOf(nodeId);
+            }
+            row = ids.size();
+            slots[slot] = static_cast<int32_t>(row);
+            ids.push_back(nodeId);
+            rssi.push_back(SaturateRssi(signal));
+            lastSeen.push_back(seen);
+            flags.push_back(flagBits);
+            scores.push_back(scorer(policy, flagBits, rssi[row]));
+            throughput.push_back(0.0f);
+            learned.push_back(0);
+            links.push_back(FreshLink(seen));
+            expiryTick.push_back(0);
+            heapPos.push_back(0);
+            heap.push_back(static_cast<uint32_t>(row));
+            SiftUp(heap.size() - 1);
+            Schedule(row);
+            return;
+        }
+        // RSSI trend per HELLO, EWMA alpha = 1/4
+        LinkStats& link = links[row];
+        Decay(row, seen);
+        int delta = (SaturateRssi(signal) - rssi[row]) * 8;
+        link.rssiTrend = static_cast<int16_t>(link.rssiTrend + (delta - link.rssiTrend) / 4);
+        learned[row] = LinkBonus(link);
+
+        rssi[row] = SaturateRssi(signal);
+        lastSeen[row] = seen;
+        flags[row] = flagBits;
+        Rescore(row);
+        Schedule(row);
+    }
+
+    bool NeighborTable::Decay(size_t row, uint64_t nowMs)
+    {
+        LinkStats& link = links[row];
+        if (linkDecayMs == 0 || nowMs <= link.decayedAt) {
+            return false;
+        }
+        uint64_t halves = (nowMs - link.decayedAt) / linkDecayMs;
+        if (halves == 0) {
+            return false;
+        }
+        // Whole half-lives only, the remainder counts toward the next one
+        link.decayedAt += halves * linkDecayMs;
+        if (halves >= 16) {
+            LinkStats forgotten = FreshLink(link.decayedAt);
+            forgotten.pendingSince = link.pendingSince;
+            forgotten.load = link.load; // Advertised, not learned: kept until the next advertisement
+            forgotten.credits = link.credits;
+            link = forgotten;
+            return true;
+        }
+        int shift = static_cast<int>(halves);
+        int deviation = static_cast<int>(link.delivery) - LINK_DELIVERY_NEUTRAL;
+        link.delivery = static_cast<uint16_t>(LINK_DELIVERY_NEUTRAL + deviation / (1 << shift));
+        link.ackLatencyMs = static_cast<uint16_t>(link.ackLatencyMs >> shift);
+        link.rssiTrend = static_cast<int16_t>(link.rssiTrend / (1 << shift));
+        link.samples = static_cast<uint16_t>(link.samples >> shift);
+        return true;
+    }
+
+    int NeighborTable::LinkBonus(const LinkStats& link) const
+    {
+        // Zero for a link without history: the tier and RSSI band decide alone
+        int64_t delivery = static_cast<int64_t>(link.delivery) - LINK_DELIVERY_NEUTRAL;
+        int bonus = static_cast<int>(policy.deliveryWeight * delivery / LINK_DELIVERY_NEUTRAL);
+        if (policy.latencyStepMs > 0) {
+            bonus -= std::min(static_cast<int>(link.ackLatencyMs) / policy.latencyStepMs, policy.latencyMaxPenalty);
+        }
+        int trend = link.rssiTrend * policy.rssiTrendWeight / 8;
+        bonus += std::max(-policy.rssiTrendMax, std::min(trend, policy.rssiTrendMax));
+        // Congestion: proportional to the advertised occupancy, and no credits left makes the link unusable
+        bonus -= policy.congestionWeight * link.load / 255;
+        if (link.credits == 0) {
+            bonus -= policy.noCreditPenalty;
+        }
+        return bonus;
+    }
+
+    void NeighborTable::Relearn(size_t row)
+    {
+        learned[row] = LinkBonus(links[row]);
+        Rescore(row);
+    }
+
+    void NeighborTable::RecordSent(size_t row, uint64_t nowMs)
+    {
+        // No rescore: nothing the score depends on changes until the ACK or the outcome
+        if (links[row].pendingSince == LINK_NOT_PENDING) {
+            links[row].pendingSince = nowMs;
+        }
+    }
+
+    void NeighborTable::RecordAck(size_t row, uint64_t nowMs)
+    {
+        LinkStats& link = links[row];
+        Decay(row, nowMs);
+        if (link.pendingSince != LINK_NOT_PENDING) {
+            // EWMA alpha = 1/4, latency saturates at 65 s
+            uint64_t elapsed = (nowMs > link.pendingSince) ? nowMs - link.pendingSince : 0;
+            int sample = static_cast<int>(std::min<uint64_t>(elapsed, UINT16_MAX));
+            link.ackLatencyMs = static_cast<uint16_t>(link.ackLatencyMs + (sample - link.ackLatencyMs) / 4);
+            link.pendingSince = LINK_NOT_PENDING;
+            RecordOutcome(row, true, nowMs);
+            return;
+        }
+        Relearn(row);
+    }
+
+    void NeighborTable::RecordOutcome(size_t row, bool delivered, uint64_t nowMs)
+    {
+        // EWMA alpha = 1/8: a single loss does not bury a good relay
+        LinkStats& link = links[row];
+        Decay(row, nowMs);
+        int target = delivered ? UINT16_MAX : 0;
+        link.delivery = static_cast<uint16_t>(link.delivery + (target - link.delivery) / 8);
+        link.samples = SaturatingIncrement(link.samples);
+        Relearn(row);
+    }
+
+    void NeighborTable::RecordLoad(size_t row, uint8_t load, uint8_t credits)
+    {
+        LinkStats& link = links[row];
+        if (link.load == load && link.credits == credits) {
+            return;
+        }
+        // The score only moves with the load or a change between zero and some credits
+        bool rescore = link.load != load || (link.credits == 0) != (credits == 0);
+        link.load = load;
+        link.credits = credits;
+        if (rescore) {
+            Relearn(row);
+        }
+    }
+
+    void NeighborTable::SpendCredits(size_t row, size_t frames)
+    {
+        LinkStats& link = links[row];
+        if (link.credits == LINK_CREDITS_UNLIMITED || link.credits == 0 || frames == 0) {
+            return;
+        }
+        link.credits = static_cast<uint8_t>(frames >= link.credits ? 0 : link.credits - frames);
+        if (link.credits == 0) {
+            Relearn(row);
+        }
+    }
+
+    long NeighborTable::Find(uint32_t nodeId) const
+    {
+        size_t slot = SlotOf(nodeId);
+        return slots[slot];
+    }
+
+    bool NeighborTable::Get(uint32_t nodeId, NeighborInfo& outInfo) const
+    {
+        long row = Find(nodeId);
+        if (row < 0) {
+            return false;
+        }
+        outInfo.lastSeen = lastSeen[row];
+        outInfo.rssi = rssi[row];
+        outInfo.hasInternetDirect = (flags[row] & NEIGHBOR_INTERNET_DIRECT) != 0;
+        outInfo.hasInternetIndirect = (flags[row] & NEIGHBOR_INTERNET_INDIRECT) != 0;
+        outInfo.isVisited = (flags[row] & NEIGHBOR_VISITED) != 0;
+        outInfo.link = links[row];
+        return true;
+    }
+
+    void NeighborTable::SetFlag(size_t row, uint8_t flag, bool value)
+    {
+        if (value) {
+            flags[row] |= flag;
+        } else {
+            flags[row] &= static_cast<uint8_t>(~flag);
+        }
+        Rescore(row);
+    }
+
+    void NeighborTable::RemoveAt(size_t row)
+    {
+        // 1. Backward-shift delete from the index (no tombstones)
+        size_t hole = SlotOf(ids[row]);
+        size_t next = hole;
+        while (true) {
+            next = (next + 1) & mask;
+            if (slots[next] == -1) {
+                break;
+            }
+            size_t home = HashId(ids[slots[next]]) & mask;
+            // Move the entry back if its home slot is not inside (hole, next]
+            bool homeBetween = (hole <= next) ? (home > hole && home <= next)
+                                              : (home > hole || home <= next);
+            if (!homeBetween) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = -1;
+
+        // 2. Take the row out of the heap, refill its position with the heap tail
+        size_t pos = heapPos[row];
+        uint32_t tail = heap.back();
+        heap.pop_back();
+        if (pos < heap.size()) {
+            HeapSet(pos, tail);
+            SiftDown(pos);
+            SiftUp(heapPos[tail]);
+        }
+
+        // 3. Fill the row with the last one so the columns stay dense
+        size_t last = ids.size() - 1;
+        if (row != last) {
+            ids[row] = ids[last];
+            rssi[row] = rssi[last];
+            lastSeen[row] = lastSeen[last];
+            flags[row] = flags[last];
+            scores[row] = scores[last];
+            throughput[row] = throughput[last];
+            learned[row] = learned[last];
+            links[row] = links[last];
+            expiryTick[row] = expiryTick[last];
+            HeapSet(heapPos[last], static_cast<uint32_t>(row));
+            slots[SlotOf(ids[row])] = static_cast<int32_t>(row);
+        }
+        ids.pop_back();
+        rssi.pop_back();
+        lastSeen.pop_back();
+        flags.pop_back();
+        scores.pop_back();
+        throughput.pop_back();
+        learned.pop_back();
+        links.pop_back();
+        expiryTick.pop_back();
+        heapPos.pop_back();
+    }
+
+    void NeighborTable::TopRows(size_t k, int minScore, std::vector<uint32_t>& outRows) const
+    {
+        // Best-first walk of the heap: the next best row is always a child of one
+        // already taken, so only the frontier has to be compared.
+        outRows.clear();
+        frontier.clear();
+        if (!heap.empty()) {
+            frontier.push_back(0);
+        }
+        while (outRows.size() < k && !frontier.empty()) {
+            size_t pick = 0;
+            for (size_t i = 1; i < frontier.size(); ++i) {
+                if (Better(heap[frontier[i]], heap[frontier[pick]])) {
+                    pick = i;
+                }
+            }
+            size_t pos = frontier[pick];
+            frontier[pick] = frontier.back();
+            frontier.pop_back();
+
+            uint32_t row = heap[pos];
+            if (scores[row] <= minScore) {
+                break; // Everything left scores lower
+            }
+            outRows.push_back(row);
+            if (2 * pos + 1 < heap.size()) frontier.push_back(2 * pos + 1);
+            if (2 * pos + 2 < heap.size()) frontier.push_back(2 * pos + 2);
+        }
+    }
+
+    void NeighborTable::Clear()
+    {
+        ids.clear();
+        rssi.clear();
+        lastSeen.clear();
+        flags.clear();
+        scores.clear();
+        throughput.clear();
+        learned.clear();
+        links.clear();
+        expiryTick.clear();
+        heapPos.clear();
+        for (std::vector<WheelEntry>& bucket : wheel) {
+            bucket.clear();
+        }
+        heap.clear();
+        slots.assign(INITIAL_SLOTS, -1);
+        mask = INITIAL_SLOTS - 1;
+    }
@@ -0,0 +1,151 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "RoutingPolicy.h"
+
+// What the table learned about one link, as fixed-point EWMAs. Every statistic
+// decays toward "no history" with a half-life, so old experience fades out.
+struct LinkStats {
+    uint16_t delivery;      // Delivery success, 0..65535 = 0..100 % (LINK_DELIVERY_NEUTRAL = no history)
+    uint16_t ackLatencyMs;  // Frame handed to the link -> ACK from the neighbor, saturated. 0 = no sample
+    int16_t  rssiTrend;     // RSSI change per HELLO in 1/8 dB, > 0 = getting closer
+    uint16_t samples;       // Outcomes recorded since the link was last forgotten, saturated
+    uint8_t  load;          // Queue occupancy the neighbor advertised, 0..255 = empty..full (not decayed)
+    uint8_t  credits;       // Frames it still takes from us until it advertises again, LINK_CREDITS_UNLIMITED = no limit
+    uint64_t decayedAt;     // Decay is applied in whole half-lives from here
+    uint64_t pendingSince;  // Oldest frame sent over the link and not acknowledged yet
+};
+const uint16_t LINK_DELIVERY_NEUTRAL = 32768;
+const uint64_t LINK_NOT_PENDING = UINT64_MAX;
+const uint8_t LINK_CREDITS_UNLIMITED = 255;  // Also what nodes that do not advertise load get
+
+struct NeighborInfo {
+    uint64_t lastSeen;        // Monotonic ms, to expire old neighbors
+    int    rssi;              // Signal strength
+    bool hasInternetDirect;   // Priority 1 (Bit 7 of Header)
+    bool hasInternetIndirect; // Priority 2 (Bit 5 of Header)
+    bool isVisited;           // Priority 3 (Bit 6 of Header) - Avoid if true
+    LinkStats link;           // Learned link quality, folded into the score
+};
+
+// Routing score of one neighbor from its packed flags and RSSI.
+// 'policy' is the table's runtime policy, compile-time scorers ignore it.
+typedef int (*NeighborScorer)(const RoutingPolicy& policy, uint8_t flags, int rssi);
+
+// Flat structure-of-arrays neighbor store.
+// Entries live in dense parallel arrays (scans touch contiguous memory only) and
+// an open-addressing index (linear probing, backward-shift delete) maps id -> row.
+// Removing a row moves the last row into its place, so row order is not id order.
+// Every write rescores the row and fixes an indexed max-heap, so the best neighbor
+// (highest score, lowest id on ties) is always at the top.
+// Expiry uses a hashed timer wheel: each neighbor has one entry, in the bucket of
+// the tick at which it would have timed out when scheduled. HELLOs do not touch it;
+// Expire only visits buckets that are due and moves entries heard from since on.
+// A row's score is the policy score plus a learned bonus from its LinkStats. The
+// bonus is recomputed only when that row's statistics change. Decay is applied
+// lazily whenever the row is touched, which happens at least once per HELLO.
+class NeighborTable
+{
+public:
+    // linkDecayMs: half-life of the learned link statistics, 0 = never forget
+    NeighborTable(NeighborScorer scorer, uint64_t timeoutMs, uint64_t linkDecayMs = 0);
+
+    // Replaces the scoring function (and the policy handed to it) and rescores every row.
+    void SetScorer(NeighborScorer scorer, const RoutingPolicy& policy = RoutingPolicy());
+    // Same, for a scorer known to compute ScoreWithPolicy(policy, ...): the bulk
+    // rescore then runs on the vectorized kernel (ScoreKernel.h).
+    void SetPolicyScorer(NeighborScorer scorer, const RoutingPolicy& policy);
+    // Row with the highest score (lowest id on equal scores), or -1 if empty. O(1).
+    long Best() const { return heap.empty() ? -1 : static_cast<long>(heap[0]); }
+    // Up to k best rows with a score above minScore, best first. O(k^2), k is small.
+    void TopRows(size_t k, int minScore, std::vector<uint32_t>& outRows) const;
+
+    // Inserts or overwrites a neighbor heard at nowMs. O(1) amortized.
+    void Store(uint32_t nodeId, uint64_t nowMs, int rssi, uint8_t flags);
+    // Row of nodeId, or -1 if unknown.
+    long Find(uint32_t nodeId) const;
+    bool Get(uint32_t nodeId, NeighborInfo& outInfo) const;
+    void SetFlag(size_t row, uint8_t flag, bool value);
+    // Recent bytes/round accepted on the link (EWMA, 0 = no history yet)
+    float Throughput(size_t row) const { return throughput[row]; }
+    void SetThroughput(size_t row, float value) { throughput[row] = value; }
+    // Learned link quality. RecordAck and RecordOutcome rescore the row, O(log n).
+    // A frame went out over the link (starts the ACK latency clock if it is not running)
+    void RecordSent(size_t row, uint64_t nowMs);
+    // The neighbor answered: one latency sample if a frame was pending, counted as delivered
+    void RecordAck(size_t row, uint64_t nowMs);
+    // Delivery outcome reported by the radio or an end-to-end ACK
+    void RecordOutcome(size_t row, bool delivered, uint64_t nowMs);
+    // Congestion advertised by the neighbor (HELLO / ACK / CONTROL), replaces the last one
+    void RecordLoad(size_t row, uint8_t load, uint8_t credits);
+    // Frames handed to the neighbor since its advertisement. Rescores only when credits run out
+    void SpendCredits(size_t row, size_t frames);
+    const LinkStats& Link(size_t row) const { return links[row]; }
+    void RemoveAt(size_t row);
+    // Drops every neighbor not heard from for more than the timeout. Returns the count removed.
+    // Cost is proportional to the due buckets, not the table size.
+    size_t Expire(uint64_t nowMs);
+    uint64_t Timeout() const { return timeoutMs; }
+    void Clear();
+
+    size_t Size() const { return ids.size(); }
+    bool Empty() const { return ids.empty(); }
+
+    // Contiguous columns, indexed by row
+    const uint32_t* Ids() const { return ids.data(); }
+    const int8_t* Rssi() const { return rssi.data(); }
+    const uint64_t* LastSeen() const { return lastSeen.data(); }
+    const uint8_t* Flags() const { return flags.data(); }
+    const int* Scores() const { return scores.data(); }
+    const int* Learned() const { return learned.data(); }  // Part of Scores() that came from LinkStats
+
+private:
+    size_t SlotOf(uint32_t nodeId) const;
+    void Grow();
+    bool Better(uint32_t rowA, uint32_t rowB) const;
+    void HeapSet(size_t pos, uint32_t row);
+    void SiftUp(size_t pos);
+    void SiftDown(size_t pos);
+    void Rescore(size_t row);
+    void RescoreAll(bool vectorized);
+    void Schedule(size_t row);
+    uint64_t DueTick(size_t row) const { return (lastSeen[row] + timeoutMs) / tickMs + 1; }
+    bool Decay(size_t row, uint64_t nowMs);
+    int LinkBonus(const LinkStats& link) const;
+    void Relearn(size_t row);
+
+    std::vector<uint32_t> ids;
+    std::vector<int8_t>   rssi;       // Saturated to int8 (BLE RSSI is within -127..20 dBm)
+    std::vector<uint64_t> lastSeen;
+    std::vector<uint8_t>  flags;
+    std::vector<int>      scores;
+    std::vector<float>    throughput;
+    std::vector<int>      learned;    // LinkBonus of the row, already included in 'scores'
+    std::vector<LinkStats> links;     // Cold: only read when a row's statistics change
+    std::vector<uint32_t> heapPos;    // Position of the row inside 'heap'
+
+    NeighborScorer scorer;
+    RoutingPolicy policy;
+    std::vector<uint32_t> heap;       // Rows, best first
+    mutable std::vector<size_t> frontier; // TopRows scratch, kept so repeated calls do not allocate
+
+    std::vector<int32_t>  slots;      // Row index, -1 = empty. Size is a power of two.
+    size_t mask;
+
+    struct WheelEntry {
+        uint32_t nodeId;
+        uint64_t tick;                // Stale if the row has been rescheduled since
+    };
+    uint64_t timeoutMs;
+    uint64_t tickMs;                  // Wheel resolution
+    uint64_t lastTick;                // Last tick Expire processed
+    std::vector<uint64_t> expiryTick; // Per row: tick of its wheel entry, 0 = none
+    std::vector<std::vector<WheelEntry>> wheel;
+    uint64_t linkDecayMs;
+};
+
+#endif /* NEIGHBOR_TABLE_H */
@@ -0,0 +1,317 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "PacketQueue.h"
+#include "THOR.h"
+#include "WireCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const uint64_t QUEUE_RELEASED = UINT64_MAX;  // EntryInfo::arrival of a free slot
+    const uint64_t QUEUE_NO_DEADLINE = UINT64_MAX;
+}
+
+    PacketQueue::PacketQueue(size_t capacity, size_t byteLimit, size_t maxPayload, QueueOrder orderBy, QueueEviction eviction,
+                             const std::string& path, uint64_t lifetime, uint64_t nowMs)
+        : slab(capacity, maxPayload, path), info(capacity), position(capacity, 0), inFlight(0), bytes(0), maxBytes(byteLimit),
+          orderPolicy(orderBy), evictionPolicy(eviction), arrivals(0), lifetimeMs(lifetime), stats()
+    {
+        for (EntryInfo& entry : info) {
+            entry.arrival = QUEUE_RELEASED;
+        }
+        order.reserve(capacity);
+        scratch.reserve(capacity);
+        deadlines.reserve(capacity * 2 + 1);
+        parked.reserve(capacity);
+        Restore();
+        // The monotonic clock restarted with the process: recovered frames get a fresh lifetime
+        if (lifetimeMs != 0) {
+            for (uint32_t slot : order) {
+                AddDeadline(slot, nowMs + lifetimeMs);
+            }
+        }
+    }
+
+    void PacketQueue::Restore()
+    {
+        // Frames left in a persistent slab: rebuild the drain order in arrival order
+        std::vector<std::pair<uint64_t, uint32_t>> frames = slab.Recovered();
+        std::sort(frames.begin(), frames.end());
+        for (const auto& entry : frames) {
+            uint32_t slot = entry.second;
+            Header header;
+            DecodeHeader(slab.Frame(slot), header);
+            // Whatever the last drain routed it to is stale now
+            header.nextHopId = 0;
+            header.flagsAndTTL.visited = 0;
+            EncodeHeader(header, slab.Frame(slot));
+
+            EntryInfo& restored = info[slot];
+            restored.arrival = entry.first;
+            restored.originId = header.originId;
+            restored.ttl = header.flagsAndTTL.ttl;
+            restored.priority = 0;
+            restored.supersede = 0; // Not persisted
+            restored.sentFragments = 0;
+            size_t pos = order.size();
+            while (pos > 0 && Before(restored, info[order[pos - 1]])) {
+                --pos;
+            }
+            order.insert(order.begin() + static_cast<long>(pos), slot);
+            bytes += slab.FrameSize(slot);
+            arrivals = entry.first + 1;
+        }
+        Reindex(0);
+    }
+
+    void PacketQueue::SetOriginPriority(uint32_t originId, uint8_t priority)
+    {
+        originPriority[originId] = priority;
+    }
+
+    bool PacketQueue::Before(const EntryInfo& a, const EntryInfo& b) const
+    {
+        switch (orderPolicy) {
+            case QueueOrder::REMAINING_TTL:
+                if (a.ttl != b.ttl) return a.ttl > b.ttl;
+                break;
+            case QueueOrder::ORIGIN_PRIORITY:
+                if (a.priority != b.priority) return a.priority > b.priority;
+                break;
+            case QueueOrder::ARRIVAL:
+                break;
+        }
+        return a.arrival < b.arrival;
+    }
+
+    bool PacketQueue::Fits(size_t frameSize) const
+    {
+        if (slab.InUse() >= slab.Capacity()) {
+            return false;
+        }
+        return maxBytes == 0 || bytes + frameSize <= maxBytes;
+    }
+
+    long PacketQueue::PickVictim(const EntryInfo& incoming) const
+    {
+        // In-flight entries belong to the radio until committed
+        if (order.size() <= inFlight) {
+            return -1;
+        }
+        long victim = -1;
+
+        switch (evictionPolicy) {
+            case QueueEviction::REJECT_NEW:
+                return -1;
+
+            case QueueEviction::DROP_OLDEST:
+                for (size_t i = inFlight; i < order.size(); ++i) {
+                    if (victim < 0 || info[order[i]].arrival < info[order[victim]].arrival) {
+                        victim = static_cast<long>(i);
+                    }
+                }
+                return victim;
+
+            case QueueEviction::DROP_LOWEST_TTL:
+                for (size_t i = inFlight; i < order.size(); ++i) {
+                    const EntryInfo& entry = info[order[i]];
+                    if (victim < 0 || entry.ttl < info[order[victim]].ttl ||
+                        (entry.ttl == info[order[victim]].ttl && entry.arrival < info[order[victim]].arrival)) {
+                        victim = static_cast<long>(i);
+                    }
+                }
+                // The newcomer has the fewest hops left -> it is the one to go
+                return (incoming.ttl < info[order[victim]].ttl) ? -1 : victim;
+
+            case QueueEviction::FAIR_SHARE: {
+                // Group queued packets by origin (scratch is preallocated, no heap use)
+                scratch.clear();
+                for (size_t i = inFlight; i < order.size(); ++i) {
+                    scratch.emplace_back(info[order[i]].originId, i);
+                }
+                std::sort(scratch.begin(), scratch.end(), [this](const std::pair<uint32_t, size_t>& a, const std::pair<uint32_t, size_t>& b) {
+                    if (a.first != b.first) return a.first < b.first;
+                    return info[order[a.second]].arrival < info[order[b.second]].arrival;
+                });
+
+                // Heaviest origin (the newcomer counts for its own origin), oldest packet on ties
+                size_t bestCount = 0;
+                for (size_t begin = 0; begin < scratch.size();) {
+                    size_t end = begin;
+                    while (end < scratch.size() && scratch[end].first == scratch[begin].first) {
+                        ++end;
+                    }
+                    size_t count = (end - begin) + (scratch[begin].first == incoming.originId ? 1 : 0);
+                    size_t oldest = scratch[begin].second;
+                    if (count > bestCount || (count == bestCount && info[order[oldest]].arrival < info[order[victim]].arrival)) {
+                        bestCount = count;
+                        victim = static_cast<long>(oldest);
+                    }
+                    begin = end;
+                }
+                return victim;
+            }
+        }
+        return -1;
+    }
+
+    void PacketQueue::Release(uint32_t slot)
+    {
+        bytes -= slab.FrameSize(slot);
+        slab.Release(slot);
+        info[slot].arrival = QUEUE_RELEASED; // Its deadline, if any, is stale now
+    }
+
+    void PacketQueue::RemoveAt(size_t index)
+    {
+        uint32_t slot = order[index];
+        Release(slot);
+        order.erase(order.begin() + static_cast<long>(index));
+        Reindex(index);
+        if (index < inFlight) {
+            --inFlight;
+        }
+    }
+
+    void PacketQueue::Reindex(size_t from)
+    {
+        // Entries from 'from' on moved in 'order' (the insert or erase shifted them anyway)
+        for (size_t i = from; i < order.size(); ++i) {
+            position[order[i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    void PacketQueue::AddDeadline(uint32_t slot, uint64_t atMs)
+    {
+        if (deadlines.size() == deadlines.capacity()) {
+            // Mostly stale entries by now: keep the live ones (one per queued packet at most)
+            deadlines.erase(std::remove_if(deadlines.begin(), deadlines.end(), [this](const Deadline& d) {
+                return info[d.slot].arrival != d.arrival;
+            }), deadlines.end());
+            std::make_heap(deadlines.begin(), deadlines.end(), &DeadlineAfter);
+        }
+        deadlines.push_back({ atMs, info[slot].arrival, slot });
+        std::push_heap(deadlines.begin(), deadlines.end(), &DeadlineAfter);
+    }
+
+    size_t PacketQueue::Expire(uint64_t nowMs)
+    {
+        size_t expired = 0;
+        parked.clear();
+        while (!deadlines.empty() && deadlines.front().atMs <= nowMs) {
+            Deadline due = deadlines.front();
+            std::pop_heap(deadlines.begin(), deadlines.end(), &DeadlineAfter);
+            deadlines.pop_back();
+            if (info[due.slot].arrival != due.arrival) {
+                continue; // Left the queue some other way
+            }
+            size_t index = position[due.slot];
+            if (index < inFlight) {
+                parked.push_back(due); // The radio has it: expired by a later call unless committed first
+                continue;
+            }
+            RemoveAt(index);
+            ++expired;
+        }
+        for (const Deadline& due : parked) {
+            deadlines.push_back(due);
+            std::push_heap(deadlines.begin(), deadlines.end(), &DeadlineAfter);
+        }
+        stats.expired += expired;
+        return expired;
+    }
+
+    size_t PacketQueue::Supersede(uint32_t originId, uint8_t supersedeClass)
+    {
+        size_t removed = 0;
+        for (size_t i = order.size(); i-- > inFlight;) {
+            const EntryInfo& entry = info[order[i]];
+            if (entry.originId == originId && entry.supersede == supersedeClass) {
+                RemoveAt(i);
+                ++removed;
+            }
+        }
+        stats.superseded += removed;
+        return removed;
+    }
+
+    bool PacketQueue::Push(const Header& header, const uint8_t* payload, size_t payloadSize, uint64_t nowMs,
+                           const QueueOptions& options)
+    {
+        size_t frameSize = sizeof(Header) + payloadSize;
+        if (frameSize > slab.SlotSize() || (maxBytes != 0 && frameSize > maxBytes)) {
+            ++stats.oversize;
+            return false;
+        }
+        Expire(nowMs);
+        if (options.supersede != 0) {
+            Supersede(header.originId, options.supersede);
+        }
+
+        EntryInfo incoming = {};
+        incoming.arrival = arrivals;
+        incoming.originId = header.originId;
+        incoming.ttl = header.flagsAndTTL.ttl;
+        incoming.supersede = options.supersede;
+        auto prio = originPriority.find(incoming.originId);
+        incoming.priority = (prio != originPriority.end()) ? prio->second : 0;
+
+        // 1. Make room according to the eviction policy
+        while (!Fits(frameSize)) {
+            long victim = PickVictim(incoming);
+            if (victim < 0) {
+                ++stats.rejected;
+                return false;
+            }
+            RemoveAt(static_cast<size_t>(victim));
+            ++stats.evicted;
+        }
+
+        // 2. Serialize straight into a slab slot
+        uint32_t slot = static_cast<uint32_t>(slab.Acquire());
+        uint8_t* frame = slab.Frame(slot);
+        EncodeHeader(header, frame);
+        if (payloadSize > 0) {
+            std::memcpy(frame + sizeof(Header), payload, payloadSize);
+        }
+        slab.Commit(slot, frameSize, arrivals);
+        info[slot] = incoming;
+        ++arrivals;
+        uint64_t lifetime = (options.lifetimeMs != 0) ? options.lifetimeMs : lifetimeMs;
+        if (lifetime != 0) {
+            AddDeadline(slot, (lifetime > QUEUE_NO_DEADLINE - nowMs) ? QUEUE_NO_DEADLINE : nowMs + lifetime);
+        }
+
+        // 3. Insert in drain order (scan from the back: O(1) for FIFO)
+        size_t pos = order.size();
+        while (pos > inFlight && Before(incoming, info[order[pos - 1]])) {
+            --pos;
+        }
+        order.insert(order.begin() + static_cast<long>(pos), slot);
+        Reindex(pos);
+        bytes += frameSize;
+        ++stats.enqueued;
+        return true;
+    }
+
+    void PacketQueue::CommitInFlight(const std::vector<bool>& accepted)
+    {
+        for (size_t i = inFlight; i-- > 0;) {
+            if (i < accepted.size() && accepted[i]) {
+                RemoveAt(i);
+            }
+        }
+        inFlight = 0;
+    }
+
+    void PacketQueue::PopFront(size_t count)
+    {
+        count = std::min(count, order.size());
+        for (size_t i = 0; i < count; ++i) {
+            Release(order[i]);
+        }
+        order.erase(order.begin(), order.begin() + static_cast<long>(count));
+        Reindex(0);
+        inFlight = (inFlight > count) ? inFlight - count : 0;
+    }
@@ -0,0 +1,143 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef PACKET_QUEUE_H
+#define PACKET_QUEUE_H
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include "PacketSlab.h"
+
+struct Header;
+
+// Drain order of the store-and-forward queue
+enum class QueueOrder : uint8_t {
+    ARRIVAL         = 1, // FIFO
+    REMAINING_TTL   = 2, // Most hops left first, FIFO among equals
+    ORIGIN_PRIORITY = 3  // Highest SetOriginPriority first, FIFO among equals
+};
+
+// What to do with a new packet when the queue is full (slots or bytes)
+enum class QueueEviction : uint8_t {
+    REJECT_NEW      = 1, // Tail drop (original behaviour)
+    DROP_OLDEST     = 2, // Make room by dropping the oldest packet
+    DROP_LOWEST_TTL = 3, // Drop the packet with the fewest hops left (the new one if it is lowest)
+    FAIR_SHARE      = 4  // Drop the oldest packet of the origin holding the most slots
+};
+
+struct QueueStats {
+    uint64_t enqueued;  // Packets accepted
+    uint64_t rejected;  // New packets dropped because the queue was full
+    uint64_t evicted;   // Queued packets dropped to make room
+    uint64_t oversize;  // Packets larger than a slot or the byte budget
+    uint64_t expired;   // Dropped for age
+    uint64_t superseded; // Replaced by a newer packet of the same origin and class
+};
+
+// Per-packet queue settings (THOR::SendPacket with QueueOptions)
+struct QueueOptions {
+    uint64_t lifetimeMs = 0;  // Dropped this long after it was queued. 0 = the queue's default lifetime
+    uint8_t supersede = 0;    // Non-zero: replaces queued packets of the same origin and class (latest value wins)
+};
+
+// Store-and-forward queue on top of PacketSlab.
+// Frames are kept serialized in slab slots, 'order' lists the slots in drain order.
+// The first InFlight() entries have been handed to the radio and are waiting for a
+// commit: they are never evicted and new packets are never ordered in front of them.
+// With a file path the slab is persistent and frames found in it are queued again.
+// Packets with a lifetime also sit in a min-heap of deadlines. Entries that left the
+// queue some other way stay in the heap until they come due and are skipped then.
+// 'position' maps a slot to its index in 'order', so Expire finds a due packet
+// without searching; removing it costs the erase from 'order' like any other drop.
+class PacketQueue
+{
+public:
+    // lifetimeMs: default age limit (0 = none). Recovered frames get it from nowMs, since the
+    // monotonic clock restarts with the process, and lose their supersede class.
+    PacketQueue(size_t capacity, size_t maxBytes, size_t maxPayload, QueueOrder order, QueueEviction eviction,
+                const std::string& path = std::string(), uint64_t lifetimeMs = 0, uint64_t nowMs = 0);
+
+    // Copies the packet into a slot, evicting per policy if full. False if it was dropped.
+    // Expires due packets first, and drops those 'options' supersedes.
+    bool Push(const Header& header, const uint8_t* payload, size_t payloadSize, uint64_t nowMs = 0,
+              const QueueOptions& options = QueueOptions());
+    // Drops packets whose lifetime has passed. In-flight ones wait for the commit.
+    size_t Expire(uint64_t nowMs);
+    // Whether Push / Expire need the time at all (some lifetime is set or pending)
+    bool Timed(const QueueOptions& options) const { return lifetimeMs != 0 || options.lifetimeMs != 0 || !deadlines.empty(); }
+    // Drops queued packets of originId sent with this supersede class (not in flight)
+    size_t Supersede(uint32_t originId, uint8_t supersedeClass);
+    // Releases the first 'count' entries (in drain order).
+    void PopFront(size_t count);
+    void Clear() { PopFront(order.size()); }
+
+    // Pins the first 'count' entries as in flight (0 returns them to the queue).
+    void SetInFlight(size_t count) { inFlight = (count < order.size()) ? count : order.size(); }
+    size_t InFlight() const { return inFlight; }
+    // Releases the in-flight entries flagged in 'accepted', unpins the rest.
+    void CommitInFlight(const std::vector<bool>& accepted);
+
+    size_t Size() const { return order.size(); }
+    bool Empty() const { return order.empty(); }
+    size_t Bytes() const { return bytes; }
+
+    // Entry 'index' in drain order
+    uint8_t* Frame(size_t index) { return slab.Frame(order[index]); }
+    size_t FrameSize(size_t index) const { return slab.FrameSize(order[index]); }
+    // Fragments of entry 'index' the radio already took, so a message reordered
+    // behind another one resumes where it stopped (0 for a new or recovered entry)
+    uint32_t SentFragments(size_t index) const { return info[order[index]].sentFragments; }
+    void SetSentFragments(size_t index, uint32_t sent) { info[order[index]].sentFragments = sent; }
+
+    void SetOriginPriority(uint32_t originId, uint8_t priority);
+    const QueueStats& Stats() const { return stats; }
+
+    bool Persistent() const { return slab.Persistent(); }
+    void Sync() { slab.Sync(); }
+
+private:
+    struct EntryInfo {
+        uint64_t arrival;        // UINT64_MAX once the slot is free
+        uint32_t originId;
+        uint8_t  ttl;
+        uint8_t  priority;
+        uint8_t  supersede;
+        uint32_t sentFragments;
+    };
+    struct Deadline {
+        uint64_t atMs;
+        uint64_t arrival;        // Stale if info[slot].arrival no longer matches
+        uint32_t slot;
+    };
+
+    void Restore();
+    bool Fits(size_t frameSize) const;
+    // Index (in 'order') of the packet to drop for 'incoming', or -1 to reject the new one.
+    long PickVictim(const EntryInfo& incoming) const;
+    void RemoveAt(size_t index);
+    void Reindex(size_t from);
+    void Release(uint32_t slot);
+    void AddDeadline(uint32_t slot, uint64_t atMs);
+    static bool DeadlineAfter(const Deadline& a, const Deadline& b) { return a.atMs > b.atMs; } // Min-heap order
+    bool Before(const EntryInfo& a, const EntryInfo& b) const;
+
+    PacketSlab slab;
+    std::vector<EntryInfo> info;   // Indexed by slot
+    std::vector<uint32_t> order;   // Slots, drain order
+    std::vector<uint32_t> position; // Indexed by slot: its index in 'order' (queued slots only)
+    size_t inFlight;
+    size_t bytes;
+    size_t maxBytes;               // 0 = slots are the only limit
+    QueueOrder orderPolicy;
+    QueueEviction evictionPolicy;
+    uint64_t arrivals;
+    std::map<uint32_t, uint8_t> originPriority;
+    uint64_t lifetimeMs;
+    std::vector<Deadline> deadlines; // Min-heap on atMs, reserved to twice the capacity
+    std::vector<Deadline> parked;    // Expire: due deadlines of in-flight packets, pushed back after
+    QueueStats stats;
+    mutable std::vector<std::pair<uint32_t, size_t>> scratch; // FAIR_SHARE grouping, reserved to capacity
+};
+
+#endif /* PACKET_QUEUE_H */
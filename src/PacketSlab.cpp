@@ -0,0 +1,250 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "PacketSlab.h"
+#include "THOR.h"
+#include "WireCodec.h"
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define THOR_HAVE_MMAP 1
+#endif
+
+namespace {
+    const uint32_t FILE_MAGIC = 0x31514854; // "THQ1"
+    const uint32_t FILE_VERSION = 1;
+    const size_t FILE_HEADER_SIZE = 64; // magic, version, slot count, slot size (LE32 each), zero padding
+
+    // Slot record, every field little-endian like the wire format, so a queue file
+    // reads the same on every host
+    const size_t RECORD_SIZE = 16;
+    const size_t RECORD_SEQUENCE_AT = 0; // LE64
+    const size_t RECORD_SIZE_AT = 8;     // LE32, 0 = free
+    const size_t RECORD_CRC_AT = 12;     // LE32, over the frame, routing fields excluded (see FrameCrc)
+
+    struct CrcTable {
+        uint32_t entries[256];
+        CrcTable()
+        {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    };
+    const CrcTable CRC_TABLE;
+
+    uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            crc = CRC_TABLE.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    // CRC-32 of a frame and its sequence (LE64). The flag byte and nextHopId are left out:
+    // DrainQueue patches them in place, and recovery resets them anyway.
+    uint32_t FrameCrc(const uint8_t* frame, size_t size, uint64_t sequence)
+    {
+        const size_t flagsAt = WIRE_FLAGS_AT;
+        const size_t hopAt = WIRE_NEXT_HOP_AT;
+        uint8_t sequenceBytes[8];
+        StoreLE64(sequenceBytes, sequence);
+        uint32_t crc = Crc32(0xFFFFFFFFu, sequenceBytes, sizeof(sequenceBytes));
+        crc = Crc32(crc, frame, flagsAt);
+        crc = Crc32(crc, frame + flagsAt + 1, hopAt - flagsAt - 1);
+        crc = Crc32(crc, frame + hopAt + sizeof(uint32_t), size - hopAt - sizeof(uint32_t));
+        return ~crc;
+    }
+
+    size_t Align64(size_t value)
+    {
+        return (value + 63) & ~static_cast<size_t>(63);
+    }
+}
+
+    PacketSlab::PacketSlab(size_t slotCount, size_t maxPayload, const std::string& path)
+        : slotSize(sizeof(Header) + maxPayload), frames(nullptr),
+          frameSizes(slotCount, 0), mapping(nullptr), mappingSize(0), records(nullptr)
+    {
+        freeSlots.reserve(slotCount);
+        if (path.empty() || !Map(path)) {
+            storage.resize(slotCount * slotSize);
+            frames = storage.data();
+        }
+        // Hand out low slots first
+        for (size_t slot = slotCount; slot-- > 0;) {
+            if (frameSizes[slot] == 0) {
+                freeSlots.push_back(static_cast<uint32_t>(slot));
+            }
+        }
+    }
+
+    PacketSlab::~PacketSlab()
+    {
+        Unmap();
+    }
+
+    PacketSlab::PacketSlab(PacketSlab&& other) noexcept
+        : slotSize(other.slotSize), frames(other.frames), storage(std::move(other.storage)),
+          frameSizes(std::move(other.frameSizes)), freeSlots(std::move(other.freeSlots)),
+          mapping(other.mapping), mappingSize(other.mappingSize), records(other.records),
+          recovered(std::move(other.recovered))
+    {
+        // 'frames' points into the moved storage or the mapping, both are ours now
+        other.frames = nullptr;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+        other.records = nullptr;
+        other.frameSizes.clear();
+        other.freeSlots.clear();
+    }
+
+    PacketSlab& PacketSlab::operator=(PacketSlab&& other) noexcept
+    {
+        if (this != &other) {
+            Unmap();
+            slotSize = other.slotSize;
+            frames = other.frames;
+            storage = std::move(other.storage);
+            frameSizes = std::move(other.frameSizes);
+            freeSlots = std::move(other.freeSlots);
+            mapping = other.mapping;
+            mappingSize = other.mappingSize;
+            records = other.records;
+            recovered = std::move(other.recovered);
+            other.frames = nullptr;
+            other.mapping = nullptr;
+            other.mappingSize = 0;
+            other.records = nullptr;
+            other.frameSizes.clear();
+            other.freeSlots.clear();
+        }
+        return *this;
+    }
+
+    void PacketSlab::Unmap()
+    {
+#ifdef THOR_HAVE_MMAP
+        if (mapping != nullptr) {
+            munmap(mapping, mappingSize); // Dirty pages are still written back by the OS
+        }
+#endif
+        mapping = nullptr;
+        mappingSize = 0;
+        records = nullptr;
+    }
+
+    bool PacketSlab::Map(const std::string& path)
+    {
+#ifdef THOR_HAVE_MMAP
+        size_t slotCount = frameSizes.size();
+        size_t recordBytes = Align64(slotCount * RECORD_SIZE);
+        size_t total = FILE_HEADER_SIZE + recordBytes + slotCount * slotSize;
+
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        bool sameSize = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == total;
+        if (!sameSize && ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd); // The mapping keeps the file open
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        mapping = static_cast<uint8_t*>(base);
+        mappingSize = total;
+        records = mapping + FILE_HEADER_SIZE;
+        frames = mapping + FILE_HEADER_SIZE + recordBytes;
+
+        if (sameSize && LoadLE32(mapping) == FILE_MAGIC && LoadLE32(mapping + 4) == FILE_VERSION &&
+            LoadLE32(mapping + 8) == slotCount && LoadLE32(mapping + 12) == slotSize) {
+            Recover();
+        } else {
+            // New file or another geometry: start empty
+            std::memset(mapping, 0, FILE_HEADER_SIZE + recordBytes);
+            StoreLE32(mapping, FILE_MAGIC);
+            StoreLE32(mapping + 4, FILE_VERSION);
+            StoreLE32(mapping + 8, static_cast<uint32_t>(slotCount));
+            StoreLE32(mapping + 12, static_cast<uint32_t>(slotSize));
+        }
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    void PacketSlab::Recover()
+    {
+        for (size_t slot = 0; slot < frameSizes.size(); ++slot) {
+            uint8_t* record = records + slot * RECORD_SIZE;
+            uint32_t size = LoadLE32(record + RECORD_SIZE_AT);
+            if (size == 0) {
+                continue;
+            }
+            uint64_t sequence = LoadLE64(record + RECORD_SEQUENCE_AT);
+            bool intact = size >= sizeof(Header) && size <= slotSize &&
+                          FrameCrc(Frame(slot), size, sequence) == LoadLE32(record + RECORD_CRC_AT);
+            if (!intact) {
+                StoreLE32(record + RECORD_SIZE_AT, 0); // Torn write: the slot is free again
+                continue;
+            }
+            frameSizes[slot] = size;
+            recovered.emplace_back(sequence, static_cast<uint32_t>(slot));
+        }
+    }
+
+    long PacketSlab::Acquire()
+    {
+        if (freeSlots.empty()) {
+            return -1;
+        }
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    void PacketSlab::Release(size_t slot)
+    {
+        frameSizes[slot] = 0;
+        if (records != nullptr) {
+            StoreLE32(records + slot * RECORD_SIZE + RECORD_SIZE_AT, 0);
+        }
+        freeSlots.push_back(static_cast<uint32_t>(slot));
+    }
+
+    void PacketSlab::Commit(size_t slot, size_t size, uint64_t sequence)
+    {
+        frameSizes[slot] = static_cast<uint32_t>(size);
+        if (records != nullptr) {
+            // Size last: a frame cut short by a crash stays free (or fails the CRC)
+            uint8_t* record = records + slot * RECORD_SIZE;
+            StoreLE64(record + RECORD_SEQUENCE_AT, sequence);
+            StoreLE32(record + RECORD_CRC_AT, FrameCrc(Frame(slot), size, sequence));
+            StoreLE32(record + RECORD_SIZE_AT, static_cast<uint32_t>(size));
+        }
+    }
+
+    void PacketSlab::Sync()
+    {
+#ifdef THOR_HAVE_MMAP
+        if (mapping != nullptr) {
+            msync(mapping, mappingSize, MS_ASYNC);
+        }
+#endif
+    }
@@ -0,0 +1,109 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "Reassembly.h"
+#include <cstring>
+
+    ReassemblyPool::ReassemblyPool(size_t slotCount, size_t maxMessageSize, uint64_t timeout)
+        : slots(slotCount), buffers(slotCount * maxMessageSize), maxMessage(maxMessageSize), timeoutMs(timeout), stats()
+    {
+    }
+
+    size_t ReassemblyPool::Pending() const
+    {
+        size_t pending = 0;
+        for (const Slot& slot : slots) {
+            pending += (slot.count != 0) ? 1 : 0;
+        }
+        return pending;
+    }
+
+    long ReassemblyPool::Find(uint32_t originId, uint32_t sequence) const
+    {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].count != 0 && slots[i].originId == originId && slots[i].sequence == sequence) {
+                return static_cast<long>(i);
+            }
+        }
+        return -1;
+    }
+
+    void ReassemblyPool::Expire(uint64_t nowMs)
+    {
+        for (Slot& slot : slots) {
+            if (slot.count != 0 && nowMs - slot.startMs > timeoutMs) {
+                slot.count = 0;
+                ++stats.expired;
+            }
+        }
+    }
+
+    size_t ReassemblyPool::Claim(uint64_t nowMs)
+    {
+        // A free slot, otherwise the message that has waited longest
+        size_t victim = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].count == 0) {
+                victim = i;
+                break;
+            }
+            if (slots[i].startMs < slots[victim].startMs) {
+                victim = i;
+            }
+        }
+        if (slots[victim].count != 0) {
+            ++stats.evicted;
+        }
+        slots[victim] = Slot();
+        slots[victim].startMs = nowMs;
+        return victim;
+    }
+
+    bool ReassemblyPool::Add(uint32_t originId, uint32_t sequence, const FragmentHeader& fragment, const uint8_t* data, size_t size,
+                             uint64_t nowMs, const uint8_t*& outData, size_t& outSize)
+    {
+        Expire(nowMs);
+        if (slots.empty() || fragment.count == 0 || fragment.index >= fragment.count ||
+            static_cast<size_t>(fragment.offset) + size > maxMessage) {
+            ++stats.rejected;
+            return false;
+        }
+
+        long found = Find(originId, sequence);
+        size_t index = (found >= 0) ? static_cast<size_t>(found) : Claim(nowMs);
+        Slot& slot = slots[index];
+        if (found < 0) {
+            slot.originId = originId;
+            slot.sequence = sequence;
+            slot.count = fragment.count;
+        } else if (slot.count != fragment.count) {
+            ++stats.rejected;
+            return false;
+        }
+
+        uint64_t bit = 1ull << (fragment.index & 63);
+        uint64_t& word = slot.have[fragment.index >> 6];
+        if (word & bit) {
+            return false; // Already have this piece
+        }
+        word |= bit;
+        ++slot.received;
+
+        uint8_t* buffer = buffers.data() + index * maxMessage;
+        if (size > 0) {
+            std::memcpy(buffer + fragment.offset, data, size);
+        }
+        if (fragment.index == fragment.count - 1) {
+            slot.size = static_cast<uint32_t>(fragment.offset + size);
+        }
+        if (slot.received < slot.count) {
+            return false;
+        }
+
+        // Complete: the slot is free again, its bytes stay until the next Add
+        slot.count = 0;
+        ++stats.completed;
+        outData = buffer;
+        outSize = slot.size;
+        return true;
+    }
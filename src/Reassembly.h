@@ -0,0 +1,64 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef REASSEMBLY_H
+#define REASSEMBLY_H
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// First bytes of a FRAGMENT payload. The frame header is the message's own
+// (originId and sequence identify the message), the rest is the piece at 'offset'.
+struct FragmentHeader {
+    uint8_t  index;   // 0 .. count - 1
+    uint8_t  count;   // Fragments in the message
+    uint16_t offset;  // Byte offset of this piece in the message payload
+};
+const size_t FRAGMENT_HEADER_SIZE = 4;
+const size_t FRAGMENT_MAX = 255;
+static_assert(sizeof(FragmentHeader) == FRAGMENT_HEADER_SIZE, "FragmentHeader matches its wire size");
+
+struct ReassemblyStats {
+    uint64_t completed;  // Messages handed out whole
+    uint64_t expired;    // Incomplete messages dropped after the timeout
+    uint64_t evicted;    // Incomplete messages dropped to make room for a new one
+    uint64_t rejected;   // Fragments that did not fit a slot or disagree with earlier ones
+};
+
+// Fixed pool of reassembly buffers, one message each, allocated at construction.
+// Only the destination reassembles: relays forward fragments as they come.
+class ReassemblyPool
+{
+public:
+    ReassemblyPool(size_t slotCount, size_t maxMessage, uint64_t timeoutMs);
+
+    // Stores one fragment. True once every fragment of (originId, sequence) is in:
+    // outData/outSize then hold the message until the next Add.
+    bool Add(uint32_t originId, uint32_t sequence, const FragmentHeader& fragment, const uint8_t* data, size_t size,
+             uint64_t nowMs, const uint8_t*& outData, size_t& outSize);
+
+    size_t Pending() const;
+    const ReassemblyStats& Stats() const { return stats; }
+
+private:
+    struct Slot {
+        uint32_t originId;
+        uint32_t sequence;
+        uint64_t startMs;    // First fragment seen
+        uint32_t size;       // Message size, known once the last fragment is in
+        uint16_t received;
+        uint8_t  count;      // 0 = free
+        uint64_t have[4];    // Bit per fragment index
+    };
+
+    long Find(uint32_t originId, uint32_t sequence) const;
+    size_t Claim(uint64_t nowMs);
+    void Expire(uint64_t nowMs);
+
+    std::vector<Slot> slots;
+    std::vector<uint8_t> buffers;  // slots.size() x maxMessage
+    size_t maxMessage;
+    uint64_t timeoutMs;
+    ReassemblyStats stats;
+};
+
+#endif /* REASSEMBLY_H */
@@ -0,0 +1,94 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "RouteCache.h"
+
+    RouteCache::RouteCache(size_t routeCapacity, uint64_t maxAge)
+        : capacity(routeCapacity), maxAgeMs(maxAge), stats()
+    {
+        destinations.reserve(capacity);
+        nextHops.reserve(capacity);
+        learnedAt.reserve(capacity);
+    }
+
+    long RouteCache::Find(uint32_t destinationId) const
+    {
+        for (size_t i = 0; i < destinations.size(); ++i) {
+            if (destinations[i] == destinationId) {
+                return static_cast<long>(i);
+            }
+        }
+        return -1;
+    }
+
+    void RouteCache::RemoveAt(size_t index)
+    {
+        // Order does not matter: move the last entry into the gap
+        destinations[index] = destinations.back();
+        nextHops[index] = nextHops.back();
+        learnedAt[index] = learnedAt.back();
+        destinations.pop_back();
+        nextHops.pop_back();
+        learnedAt.pop_back();
+    }
+
+    void RouteCache::Learn(uint32_t destinationId, uint32_t nextHopId, uint64_t nowMs)
+    {
+        if (capacity == 0 || nextHopId == 0) {
+            return;
+        }
+        ++stats.learned;
+        long found = Find(destinationId);
+        if (found >= 0) {
+            // The latest ACK wins: it came over a path that works right now
+            nextHops[found] = nextHopId;
+            learnedAt[found] = nowMs;
+            return;
+        }
+        if (destinations.size() == capacity) {
+            size_t stalest = 0;
+            for (size_t i = 1; i < learnedAt.size(); ++i) {
+                if (learnedAt[i] < learnedAt[stalest]) {
+                    stalest = i;
+                }
+            }
+            RemoveAt(stalest);
+        }
+        destinations.push_back(destinationId);
+        nextHops.push_back(nextHopId);
+        learnedAt.push_back(nowMs);
+    }
+
+    uint32_t RouteCache::Lookup(uint32_t destinationId, uint64_t nowMs)
+    {
+        long found = Find(destinationId);
+        if (found >= 0 && nowMs - learnedAt[found] > maxAgeMs) {
+            RemoveAt(static_cast<size_t>(found));
+            found = -1;
+        }
+        if (found < 0) {
+            ++stats.misses;
+            return 0;
+        }
+        ++stats.hits;
+        return nextHops[found];
+    }
+
+    void RouteCache::Forget(uint32_t nextHopId)
+    {
+        size_t i = 0;
+        while (i < nextHops.size()) {
+            if (nextHops[i] == nextHopId) {
+                RemoveAt(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void RouteCache::Clear()
+    {
+        destinations.clear();
+        nextHops.clear();
+        learnedAt.clear();
+    }
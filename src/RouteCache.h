@@ -0,0 +1,46 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct RouteStats {
+    uint64_t learned;  // Routes added or refreshed
+    uint64_t hits;     // Lookups answered with a fresh route
+    uint64_t misses;   // Lookups that fell back to the gravity heuristic
+};
+
+// Small destination -> next hop map learned from ACKs: an ACK that originId sent
+// and senderId relayed to us says originId is reachable through senderId.
+// Fixed capacity, linear scan over a dense id column (a few dozen entries fit in
+// a couple of cache lines). When full, the stalest route is replaced.
+class RouteCache
+{
+public:
+    RouteCache(size_t capacity, uint64_t maxAgeMs);
+
+    void Learn(uint32_t destinationId, uint32_t nextHopId, uint64_t nowMs);
+    // Next hop toward destinationId learned at most maxAgeMs ago, 0 if none.
+    uint32_t Lookup(uint32_t destinationId, uint64_t nowMs);
+    // Drops every route through nextHopId (the neighbor is gone or unusable)
+    void Forget(uint32_t nextHopId);
+    void Clear();
+
+    size_t Size() const { return destinations.size(); }
+    const RouteStats& Stats() const { return stats; }
+
+private:
+    long Find(uint32_t destinationId) const;
+    void RemoveAt(size_t index);
+
+    std::vector<uint32_t> destinations;  // Scanned on every lookup
+    std::vector<uint32_t> nextHops;
+    std::vector<uint64_t> learnedAt;
+    size_t capacity;
+    uint64_t maxAgeMs;
+    RouteStats stats;
+};
+
+#endif /* ROUTE_CACHE_H */
@@ -0,0 +1,134 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef ROUTING_POLICY_H
+#define ROUTING_POLICY_H
+#include <cstdint>
+
+// Bits of the packed per-neighbor flag byte
+const uint8_t NEIGHBOR_INTERNET_DIRECT   = 1 << 0; // Priority 1
+const uint8_t NEIGHBOR_INTERNET_INDIRECT = 1 << 1; // Priority 2
+const uint8_t NEIGHBOR_VISITED           = 1 << 2; // Priority 3 - Avoid if set
+
+// Scoring constants of GetBestNextHop, adjustable at runtime (experiments, field tuning).
+// A neighbor gets the value of its tier, picked from its flags, plus the adjustment of
+// its RSSI band, plus what the table learned about the link and minus the congestion
+// the neighbor advertised (NeighborTable.h). Only scores above -1 are eligible.
+struct RoutingPolicy {
+    int directInternet   = 300;
+    int indirectInternet = 200;
+    int explore          = 100;  // Unvisited, no internet known
+    int visited          = 10;   // Already used in this transaction
+    int nearRssi         = -50;  // Above this: too close, probably the same group
+    int farRssi          = -80;  // Below this: link likely to fail
+    int nearAdjust       = -50;
+    int goodAdjust       = 50;   // farRssi..nearRssi, the "Goldilocks zone"
+    int farAdjust        = -20;
+    int deliveryWeight   = 100;  // Learned bonus at 100 % delivery, minus this at 0 %
+    int latencyStepMs    = 50;   // One point off per this much ACK latency...
+    int latencyMaxPenalty = 40;  // ...up to this many
+    int rssiTrendWeight  = 4;    // Points per dB/HELLO of RSSI trend (closing in is positive)
+    int rssiTrendMax     = 20;
+    int congestionWeight = 100;  // Points off for a neighbor advertising a full queue, scaled by occupancy
+    int noCreditPenalty  = 1000; // Neighbor out of credits: pushes it below -1 until it advertises again
+};
+
+// Compile-time policies: the same names as static constexpr members. Installed with
+// THOR::SetRoutingPolicy<Policy>(), the constants are folded into the scorer.
+struct DefaultRoutingPolicy {
+    static constexpr int directInternet   = 300;
+    static constexpr int indirectInternet = 200;
+    static constexpr int explore          = 100;
+    static constexpr int visited          = 10;
+    static constexpr int nearRssi         = -50;
+    static constexpr int farRssi          = -80;
+    static constexpr int nearAdjust       = -50;
+    static constexpr int goodAdjust       = 50;
+    static constexpr int farAdjust        = -20;
+    static constexpr int deliveryWeight   = 100;
+    static constexpr int latencyStepMs    = 50;
+    static constexpr int latencyMaxPenalty = 40;
+    static constexpr int rssiTrendWeight  = 4;
+    static constexpr int rssiTrendMax     = 20;
+    static constexpr int congestionWeight = 100;
+    static constexpr int noCreditPenalty  = 1000;
+};
+
+// Indoor shelters: walls eat 10-20 dB, so a strong signal is rarely "too close" and
+// weak links are worth less. Starting point, tune with the simulator.
+struct ShelterRoutingPolicy : DefaultRoutingPolicy {
+    static constexpr int nearRssi  = -40;
+    static constexpr int farRssi   = -85;
+    static constexpr int farAdjust = -40;
+};
+
+// Open field: line of sight, long weak links still deliver, so prefer range.
+struct OpenFieldRoutingPolicy : DefaultRoutingPolicy {
+    static constexpr int nearRssi   = -60;
+    static constexpr int farRssi    = -90;
+    static constexpr int nearAdjust = -30;
+    static constexpr int farAdjust  = 0;
+};
+
+// Score of one neighbor. Policy is RoutingPolicy or a compile-time policy struct.
+template <typename Policy>
+inline int ScoreWithPolicy(const Policy& policy, uint8_t flags, int rssi)
+{
+    int score = 0;
+    if (flags & NEIGHBOR_INTERNET_DIRECT) {
+        score = policy.directInternet;
+    } else if (flags & NEIGHBOR_INTERNET_INDIRECT) {
+        score = policy.indirectInternet;
+    } else if (flags & NEIGHBOR_VISITED) {
+        score = policy.visited;
+    } else {
+        score = policy.explore;
+    }
+
+    if (rssi > policy.nearRssi) {
+        score += policy.nearAdjust;
+    } else if (rssi >= policy.farRssi) {
+        score += policy.goodAdjust;
+    } else {
+        score += policy.farAdjust;
+    }
+    return score;
+}
+
+// NeighborScorer implementations (see NeighborTable.h). The static one ignores the
+// table's runtime policy, everything it needs is in Policy.
+template <typename Policy>
+int StaticPolicyScorer(const RoutingPolicy&, uint8_t flags, int rssi)
+{
+    return ScoreWithPolicy(Policy(), flags, rssi);
+}
+
+inline int RuntimePolicyScorer(const RoutingPolicy& policy, uint8_t flags, int rssi)
+{
+    return ScoreWithPolicy(policy, flags, rssi);
+}
+
+// Values of a compile-time policy as a runtime one
+template <typename Policy>
+inline RoutingPolicy MakeRoutingPolicy()
+{
+    RoutingPolicy policy;
+    policy.directInternet   = Policy::directInternet;
+    policy.indirectInternet = Policy::indirectInternet;
+    policy.explore          = Policy::explore;
+    policy.visited          = Policy::visited;
+    policy.nearRssi         = Policy::nearRssi;
+    policy.farRssi          = Policy::farRssi;
+    policy.nearAdjust       = Policy::nearAdjust;
+    policy.goodAdjust       = Policy::goodAdjust;
+    policy.farAdjust        = Policy::farAdjust;
+    policy.deliveryWeight   = Policy::deliveryWeight;
+    policy.latencyStepMs    = Policy::latencyStepMs;
+    policy.latencyMaxPenalty = Policy::latencyMaxPenalty;
+    policy.rssiTrendWeight  = Policy::rssiTrendWeight;
+    policy.rssiTrendMax     = Policy::rssiTrendMax;
+    policy.congestionWeight = Policy::congestionWeight;
+    policy.noCreditPenalty  = Policy::noCreditPenalty;
+    return policy;
+}
+
+#endif /* ROUTING_POLICY_H */
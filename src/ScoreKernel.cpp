@@ -0,0 +1,220 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "ScoreKernel.h"
+
+#if defined(THOR_NO_SIMD)
+// Scalar loop only
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define THOR_SCORE_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define THOR_SCORE_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define THOR_SCORE_NEON 1
+#endif
+
+namespace {
+    const int LANE_MIN = -16384; // Any two values in this range add up without int16 overflow
+    const int LANE_MAX = 16383;
+
+    inline bool InLane(int value)
+    {
+        return value >= LANE_MIN && value <= LANE_MAX;
+    }
+
+    void ScoreScalar(const RoutingPolicy& policy, const uint8_t* flags, const int8_t* rssi,
+                     size_t begin, size_t count, int* outScores)
+    {
+        for (size_t i = begin; i < count; ++i) {
+            outScores[i] = ScoreWithPolicy(policy, flags[i], rssi[i]);
+        }
+    }
+
+#if defined(THOR_SCORE_AVX2)
+    struct Lanes {
+        __m256i bitDirect, bitIndirect, bitVisited;
+        __m256i direct, indirect, explore, visited;
+        __m256i near, farMinus1, nearAdjust, goodAdjust, farAdjust;
+    };
+
+    inline __m256i Select(__m256i mask, __m256i a, __m256i b)
+    {
+        return _mm256_blendv_epi8(b, a, mask);
+    }
+
+    inline __m256i Has(__m256i f, __m256i bit)
+    {
+        return _mm256_cmpeq_epi16(_mm256_and_si256(f, bit), bit);
+    }
+
+    // 16 rows: the tier picked from the flags (direct > indirect > visited > explore),
+    // plus the adjustment of the RSSI band
+    inline __m256i Score16(const Lanes& k, __m256i f, __m256i r)
+    {
+        __m256i tier = Select(Has(f, k.bitVisited), k.visited, k.explore);
+        tier = Select(Has(f, k.bitIndirect), k.indirect, tier);
+        tier = Select(Has(f, k.bitDirect), k.direct, tier);
+        __m256i adjust = Select(_mm256_cmpgt_epi16(r, k.farMinus1), k.goodAdjust, k.farAdjust);
+        adjust = Select(_mm256_cmpgt_epi16(r, k.near), k.nearAdjust, adjust);
+        return _mm256_add_epi16(tier, adjust);
+    }
+
+    size_t ScoreVector(const RoutingPolicy& p, const uint8_t* flags, const int8_t* rssi, size_t count, int* out)
+    {
+        const Lanes k = {
+            _mm256_set1_epi16(NEIGHBOR_INTERNET_DIRECT), _mm256_set1_epi16(NEIGHBOR_INTERNET_INDIRECT),
+            _mm256_set1_epi16(NEIGHBOR_VISITED),
+            _mm256_set1_epi16(static_cast<short>(p.directInternet)), _mm256_set1_epi16(static_cast<short>(p.indirectInternet)),
+            _mm256_set1_epi16(static_cast<short>(p.explore)), _mm256_set1_epi16(static_cast<short>(p.visited)),
+            _mm256_set1_epi16(static_cast<short>(p.nearRssi)), _mm256_set1_epi16(static_cast<short>(p.farRssi - 1)),
+            _mm256_set1_epi16(static_cast<short>(p.nearAdjust)), _mm256_set1_epi16(static_cast<short>(p.goodAdjust)),
+            _mm256_set1_epi16(static_cast<short>(p.farAdjust))
+        };
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i f = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i)));
+            __m256i r = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rssi + i)));
+            __m256i s = Score16(k, f, r);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 8), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1)));
+        }
+        return i;
+    }
+#elif defined(THOR_SCORE_SSE2)
+    struct Lanes {
+        __m128i bitDirect, bitIndirect, bitVisited;
+        __m128i direct, indirect, explore, visited;
+        __m128i near, farMinus1, nearAdjust, goodAdjust, farAdjust;
+    };
+
+    inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    inline __m128i Has(__m128i f, __m128i bit)
+    {
+        return _mm_cmpeq_epi16(_mm_and_si128(f, bit), bit);
+    }
+
+    // 8 rows: the tier picked from the flags (direct > indirect > visited > explore),
+    // plus the adjustment of the RSSI band
+    inline __m128i Score8(const Lanes& k, __m128i f, __m128i r)
+    {
+        __m128i tier = Select(Has(f, k.bitVisited), k.visited, k.explore);
+        tier = Select(Has(f, k.bitIndirect), k.indirect, tier);
+        tier = Select(Has(f, k.bitDirect), k.direct, tier);
+        __m128i adjust = Select(_mm_cmpgt_epi16(r, k.farMinus1), k.goodAdjust, k.farAdjust);
+        adjust = Select(_mm_cmpgt_epi16(r, k.near), k.nearAdjust, adjust);
+        return _mm_add_epi16(tier, adjust);
+    }
+
+    inline void Store8(int* out, __m128i s)
+    {
+        // Sign-extend int16 -> int32 (SSE2 has no cvtepi16)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+    }
+
+    size_t ScoreVector(const RoutingPolicy& p, const uint8_t* flags, const int8_t* rssi, size_t count, int* out)
+    {
+        const Lanes k = {
+            _mm_set1_epi16(NEIGHBOR_INTERNET_DIRECT), _mm_set1_epi16(NEIGHBOR_INTERNET_INDIRECT),
+            _mm_set1_epi16(NEIGHBOR_VISITED),
+            _mm_set1_epi16(static_cast<short>(p.directInternet)), _mm_set1_epi16(static_cast<short>(p.indirectInternet)),
+            _mm_set1_epi16(static_cast<short>(p.explore)), _mm_set1_epi16(static_cast<short>(p.visited)),
+            _mm_set1_epi16(static_cast<short>(p.nearRssi)), _mm_set1_epi16(static_cast<short>(p.farRssi - 1)),
+            _mm_set1_epi16(static_cast<short>(p.nearAdjust)), _mm_set1_epi16(static_cast<short>(p.goodAdjust)),
+            _mm_set1_epi16(static_cast<short>(p.farAdjust))
+        };
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i));
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rssi + i));
+            // Widen bytes to int16: zero-extend the flags, sign-extend the RSSI
+            Store8(out + i, Score8(k, _mm_unpacklo_epi8(f, zero), _mm_srai_epi16(_mm_unpacklo_epi8(r, r), 8)));
+            Store8(out + i + 8, Score8(k, _mm_unpackhi_epi8(f, zero), _mm_srai_epi16(_mm_unpackhi_epi8(r, r), 8)));
+        }
+        return i;
+    }
+#elif defined(THOR_SCORE_NEON)
+    struct Lanes {
+        int16x8_t bitDirect, bitIndirect, bitVisited;
+        int16x8_t direct, indirect, explore, visited;
+        int16x8_t near, farMinus1, nearAdjust, goodAdjust, farAdjust;
+    };
+
+    // 8 rows: the tier picked from the flags (direct > indirect > visited > explore),
+    // plus the adjustment of the RSSI band
+    inline int16x8_t Score8(const Lanes& k, int16x8_t f, int16x8_t r)
+    {
+        int16x8_t tier = vbslq_s16(vtstq_s16(f, k.bitVisited), k.visited, k.explore);
+        tier = vbslq_s16(vtstq_s16(f, k.bitIndirect), k.indirect, tier);
+        tier = vbslq_s16(vtstq_s16(f, k.bitDirect), k.direct, tier);
+        int16x8_t adjust = vbslq_s16(vcgtq_s16(r, k.farMinus1), k.goodAdjust, k.farAdjust);
+        adjust = vbslq_s16(vcgtq_s16(r, k.near), k.nearAdjust, adjust);
+        return vaddq_s16(tier, adjust);
+    }
+
+    inline void Store8(int* out, int16x8_t s)
+    {
+        vst1q_s32(out, vmovl_s16(vget_low_s16(s)));
+        vst1q_s32(out + 4, vmovl_s16(vget_high_s16(s)));
+    }
+
+    size_t ScoreVector(const RoutingPolicy& p, const uint8_t* flags, const int8_t* rssi, size_t count, int* out)
+    {
+        const Lanes k = {
+            vdupq_n_s16(NEIGHBOR_INTERNET_DIRECT), vdupq_n_s16(NEIGHBOR_INTERNET_INDIRECT),
+            vdupq_n_s16(NEIGHBOR_VISITED),
+            vdupq_n_s16(static_cast<int16_t>(p.directInternet)), vdupq_n_s16(static_cast<int16_t>(p.indirectInternet)),
+            vdupq_n_s16(static_cast<int16_t>(p.explore)), vdupq_n_s16(static_cast<int16_t>(p.visited)),
+            vdupq_n_s16(static_cast<int16_t>(p.nearRssi)), vdupq_n_s16(static_cast<int16_t>(p.farRssi - 1)),
+            vdupq_n_s16(static_cast<int16_t>(p.nearAdjust)), vdupq_n_s16(static_cast<int16_t>(p.goodAdjust)),
+            vdupq_n_s16(static_cast<int16_t>(p.farAdjust))
+        };
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            uint8x16_t f = vld1q_u8(flags + i);
+            int8x16_t r = vld1q_s8(rssi + i);
+            Store8(out + i, Score8(k, vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(f))), vmovl_s8(vget_low_s8(r))));
+            Store8(out + i + 8, Score8(k, vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(f))), vmovl_s8(vget_high_s8(r))));
+        }
+        return i;
+    }
+#else
+    size_t ScoreVector(const RoutingPolicy&, const uint8_t*, const int8_t*, size_t, int*) { return 0; }
+#endif
+}
+
+    bool PolicyFitsKernel(const RoutingPolicy& policy)
+    {
+        return InLane(policy.directInternet) && InLane(policy.indirectInternet) &&
+               InLane(policy.explore) && InLane(policy.visited) &&
+               InLane(policy.nearRssi) && InLane(policy.farRssi) &&
+               InLane(policy.nearAdjust) && InLane(policy.goodAdjust) && InLane(policy.farAdjust);
+    }
+
+    void ScoreNeighborsBatch(const RoutingPolicy& policy, const uint8_t* flags, const int8_t* rssi,
+                             size_t count, int* outScores)
+    {
+        size_t done = PolicyFitsKernel(policy) ? ScoreVector(policy, flags, rssi, count, outScores) : 0;
+        ScoreScalar(policy, flags, rssi, done, count, outScores);
+    }
+
+    const char* ScoreKernelName()
+    {
+#if defined(THOR_SCORE_AVX2)
+        return "avx2";
+#elif defined(THOR_SCORE_SSE2)
+        return "sse2";
+#elif defined(THOR_SCORE_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
@@ -0,0 +1,28 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef SCORE_KERNEL_H
+#define SCORE_KERNEL_H
+#include <cstdint>
+#include <cstddef>
+#include "RoutingPolicy.h"
+
+// Batch neighbor scoring over the NeighborTable columns, for rescoring the whole
+// table when the policy changes. Best-neighbor picks come from the heap instead.
+// The ISA is picked at compile time: AVX2 (-mavx2) scores 16 rows per step, SSE2
+// (every x86-64 build) and NEON (AArch64) 16 rows as two 8-lane halves; anything
+// else, or a build with -DTHOR_NO_SIMD, uses the scalar loop. All paths give
+// exactly ScoreWithPolicy's results (tests/score_kernel.cpp checks each one).
+
+// outScores[i] = ScoreWithPolicy(policy, flags[i], rssi[i]) for i < count.
+// Vector lanes are 16 bits wide: a policy whose values do not fit (see
+// PolicyFitsKernel) silently takes the scalar path.
+void ScoreNeighborsBatch(const RoutingPolicy& policy, const uint8_t* flags, const int8_t* rssi,
+                         size_t count, int* outScores);
+
+// True when every tier + adjustment sum and threshold fits the 16-bit lanes
+bool PolicyFitsKernel(const RoutingPolicy& policy);
+
+// "avx2", "sse2", "neon" or "scalar"
+const char* ScoreKernelName();
+
+#endif /* SCORE_KERNEL_H */
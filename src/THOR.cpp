@@ -2,57 +2,1003 @@
 // Licensed under the Apache License, Version 2.0
 
 # include "THOR.h"
+#include "CompactHeader.h"
+#include "WireCodec.h"
+#include "TraceReplay.h"
+#include <algorithm>
 #include <cstring>
+#include <chrono>
 
-    std::vector<uint8_t> THOR::Serialize(const Packet& packet) 
+namespace {
+    const size_t NO_TX_OFFSET = SIZE_MAX; // Frame handed out straight from the slab
+    const size_t FRAGMENT_ROUTES = 8;    // Messages a relay keeps a fragment hop for
+
+    uint64_t SteadyClockMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    BeaconConfig ResolveBeacon(const THORConfig& config)
+    {
+        // Neighbors drop us after neighborTimeoutMs of silence: beacon at least 3 times per timeout
+        BeaconConfig beacon = config.beacon;
+        if (beacon.maxIntervalMs == 0) {
+            beacon.maxIntervalMs = config.neighborTimeoutMs / 3;
+        }
+        return beacon;
+    }
+
+    // Frames a drain may hand to a link before its advertised credits are gone
+    inline uint32_t LinkCredits(const LinkStats& link)
+    {
+        return (link.credits == LINK_CREDITS_UNLIMITED) ? UINT32_MAX : link.credits;
+    }
+}
+
+    THOR::THOR()
+        : THOR(THORConfig())
+    {
+    }
+
+    THOR::THOR(const THORConfig& config)
+        : clock(config.clock ? config.clock : std::function<uint64_t()>(&SteadyClockMs)),
+          neighborTable(&StaticPolicyScorer<DefaultRoutingPolicy>, config.neighborTimeoutMs, config.linkDecayMs),
+          duplicateCache(config.duplicateCapacity, config.duplicateMaxAgeMs),
+          packetQueue(config.queueCapacity, config.queueBytes, config.maxPayload, config.queueOrder, config.queueEviction,
+                      config.queueFile, config.queueLifetimeMs, clock()),
+          beaconScheduler(ResolveBeacon(config)),
+          spreadNeighbors(config.spreadNeighbors == 0 ? 1 : config.spreadNeighbors),
+          spreadWeight(config.spreadWeight),
+          advertiseLoad(config.advertiseLoad), queueCapacity(config.queueCapacity),
+          advertisedCredits(LINK_CREDITS_UNLIMITED), heardLoad(),
+          compactHeaders(config.compactHeaders),
+          fragmentSize(config.fragmentSize),
+          headPartial(false),
+          fragmentRoutes(FRAGMENT_ROUTES, FragmentRoute()),
+          nextFragmentRoute(0),
+          reassembly(config.reassemblySlots, config.maxPayload, config.reassemblyTimeoutMs),
+          routeCache(config.routeCacheSize, config.routeTimeoutMs),
+          sinkMaxFrames(0), sinkMaxBytes(0), sinkFrame(sizeof(Header) + config.maxPayload), // The encoded header is never longer
+          energy(config.energy), routedHop(0),
+          tracer(config.traceBytes, config.traceFile)
+    {
+        // Per drain link: the spread set plus one destination hop outside it (DestinationLink).
+        // More such hops in one drain grow the columns once, clear() keeps the capacity.
+        spreadHops.reserve(spreadNeighbors + 1);
+        spreadWeights.reserve(spreadNeighbors + 1);
+        linkOutcomes.reserve(spreadNeighbors + 1);
+        spreadCredits.reserve(spreadNeighbors + 1);
+        linkFrames.reserve(spreadNeighbors + 1);
+        spreadCurrent.reserve(spreadNeighbors + 1);
+        spreadRssi.reserve(spreadNeighbors + 1);
+        scratchRows.reserve(std::max(spreadNeighbors, energy.Candidates()));
+        energyRows.reserve(energy.Candidates());
+        pendingAcks.reserve(CONTROL_MAX_ACKS);
+        inFlightLinks.reserve(config.queueCapacity);
+        entryFrames.reserve(config.queueCapacity);
+        entryAccepted.reserve(config.queueCapacity);
+        if (tracer.Enabled()) {
+            uint8_t body[TRACE_CONFIG_SIZE];
+            tracer.Start(body, EncodeTraceConfig(config, body, sizeof(body)), clock());
+        }
+    }
+
+    void THOR::SetClock(std::function<uint64_t()> newClock)
+    {
+        clock = newClock ? newClock : std::function<uint64_t()>(&SteadyClockMs);
+    }
+
+    void THOR::SetOriginPriority(uint32_t originId, uint8_t priority)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::PRIORITY);
+            tracer.Put32(originId);
+            tracer.Put8(priority);
+            tracer.End();
+        }
+        packetQueue.SetOriginPriority(originId, priority);
+    }
+
+    std::vector<uint8_t> THOR::Serialize(const Packet& packet)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header) + packet.payload.size());
+        buffer.resize(Serialize(packet, buffer.data(), buffer.size()));
+
+        return buffer;
+    }
+
+    std::vector<uint8_t> THOR::SerializeHeader(const Header& header)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header));
+        buffer.resize(SerializeHeader(header, buffer.data(), buffer.size()));
+
+        return buffer;
+    }
+
+    bool THOR::Deserialize(const std::vector<uint8_t>& data, Packet& outPacket)
+    {
+        PacketView view;
+        if (!Deserialize(data.data(), data.size(), view)) {
+            return false; // Error: Data too short to be a valid packet
+        }
+        outPacket.header = view.header;
+        outPacket.payload.assign(view.payload, view.payload + view.payloadSize);
+
+        return true;
+    }
+
+    bool THOR::DeserializeHeader(const std::vector<uint8_t>& data, Header& outheader)
+    {
+        return DeserializeHeader(data.data(), data.size(), outheader);
+    }
+
+    std::vector<uint8_t> THOR::CreateHello(uint32_t DestId ,uint32_t SenderId, uint32_t OriginId, uint32_t Sequence)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header) + LOAD_ADVERT_SIZE);
+        buffer.resize(CreateHello(DestId, SenderId, OriginId, Sequence, buffer.data(), buffer.size()));
+        return buffer;
+    }
+
+    std::vector<uint8_t> THOR::CreateACK(uint32_t DestId, uint32_t SenderId,uint32_t OriginId,uint32_t NextHopId,uint32_t Sequence, bool myinternet, bool intneighbour)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header) + LOAD_ADVERT_SIZE);
+        buffer.resize(CreateACK(DestId, SenderId, OriginId, NextHopId, Sequence, myinternet, intneighbour, buffer.data(), buffer.size()));
+        return buffer;
+    }
+
+    bool THOR::HandleHello(const std::vector<uint8_t>& data, Header& outheader)
+    {
+        return HandleHello(data.data(), data.size(), outheader);
+    }
+
+    bool THOR::HandleAck(const std::vector<uint8_t>& data, Header& outheader)
+    {
+        return HandleAck(data.data(), data.size(), outheader);
+    }
+
+    std::vector<uint8_t> THOR::CreateControl(uint32_t SenderId, uint32_t Sequence, bool myinternet, bool intneighbour)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header) + CONTROL_BODY_SIZE + pendingAcks.size() * CONTROL_ACK_SIZE + LOAD_ADVERT_SIZE);
+        buffer.resize(CreateControl(SenderId, Sequence, myinternet, intneighbour, buffer.data(), buffer.size()));
+        return buffer;
+    }
+
+    std::vector<uint8_t> THOR::SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const std::vector<uint8_t>& payload)
+    {
+        std::vector<uint8_t> buffer(sizeof(Header) + payload.size());
+        size_t written = SendPacket(DestId, SenderId, OriginId, Sequence, payload.data(), payload.size(), buffer.data(), buffer.size());
+        if (written == 0) {
+            return {}; // Return empty -> Stored for later.
+        }
+        buffer.resize(written);
+        return buffer;
+    }
+
+    // Returns a Packet if we need to forward it, or an empty vector if dropped/queued/delivered.
+    std::vector<uint8_t> THOR::HandleData(const std::vector<uint8_t>& data, Packet& outPacket, uint32_t MyNodeId)
+    {
+        // Room for a compact frame re-encoded with the full header
+        std::vector<uint8_t> buffer(data.size() + sizeof(Header));
+        PacketView view = {};
+        size_t written = HandleData(data.data(), data.size(), view, MyNodeId, buffer.data(), buffer.size());
+
+        if (view.payload != nullptr) {
+            outPacket.header = view.header;
+            outPacket.payload.assign(view.payload, view.payload + view.payloadSize);
+        } else {
+            outPacket.payload.clear(); // Malformed: no payload from an earlier call is left behind
+        }
+        if (written == 0) {
+            return {};
+        }
+        buffer.resize(written);
+        return buffer;
+    }
+
+    void THOR::NeighborStore(uint32_t nodeId, int rssi, bool hasInternetDirect, bool hasInternetIndirect, bool isVisited)
+    {
+        uint8_t flags = 0;
+        if (hasInternetDirect)   flags |= NEIGHBOR_INTERNET_DIRECT;
+        if (hasInternetIndirect) flags |= NEIGHBOR_INTERNET_INDIRECT;
+        if (isVisited)           flags |= NEIGHBOR_VISITED;
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::NEIGHBOR);
+            tracer.Put32(nodeId);
+            tracer.Put32(static_cast<uint32_t>(rssi));
+            tracer.Put8(flags);
+            tracer.End();
+        }
+
+        // A new neighbor or a change of internet reachability is churn for the beacon scheduler
+        const uint8_t internet = NEIGHBOR_INTERNET_DIRECT | NEIGHBOR_INTERNET_INDIRECT;
+        long row = neighborTable.Find(nodeId);
+        if (row < 0 || (neighborTable.Flags()[row] & internet) != (flags & internet)) {
+            beaconScheduler.Churn();
+        }
+        neighborTable.Store(nodeId, Now(), rssi, flags);
+        if (heardLoad.nodeId == nodeId && nodeId != 0) {
+            // Advertised in the ACK / HELLO that introduced this neighbor
+            neighborTable.RecordLoad(static_cast<size_t>(neighborTable.Find(nodeId)), heardLoad.advert.load, heardLoad.advert.credits);
+            heardLoad = HeardLoad();
+        }
+        if (transmitSink) {
+            Flush(); // Maybe the route the queue was waiting for
+        }
+    }
+
+    void THOR::RemoveOld()
+    {
+        // Remove neighbors we haven't heard from in neighborTimeoutMs (30 s by default).
+        // The timer wheel only visits buckets that came due since the last call.
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::REMOVE_OLD);
+            tracer.End();
+        }
+        uint64_t now = Now();
+        size_t removed = neighborTable.Expire(now);
+        packetQueue.Expire(now); // Stale traffic stops counting as queued (and making beacons urgent)
+        THOR_METRIC(metrics.Count(MetricCounter::NEIGHBOR_EXPIRED, removed));
+        beaconScheduler.Churn(removed);
+        if (transmitSink) {
+            Flush(); // Periodic retry of frames the radio refused earlier
+        }
+    }
+
+    bool THOR::NeedsRoute() const
+    {
+        if (packetQueue.Empty()) {
+            return false;
+        }
+        long best = neighborTable.Best();
+        return best < 0 || neighborTable.Scores()[best] <= -1;
+    }
+
+    uint64_t THOR::NextHelloAt() const
+    {
+        return beaconScheduler.NextAt(neighborTable.Size(), BeaconUrgent());
+    }
+
+    bool THOR::BeaconUrgent() const
+    {
+        // Neighbors stopped sending to us when we ran out of credits: tell them soon that we have room again
+        return NeedsRoute() || (advertiseLoad && advertisedCredits == 0 && GetLoad().credits > 0);
+    }
+
+    long THOR::MarkVisited(uint32_t nodeId, size_t frames)
+    {
+        long row = neighborTable.Find(nodeId);
+        if (row >= 0) {
+            neighborTable.SetFlag(static_cast<size_t>(row), NEIGHBOR_VISITED, true);
+            neighborTable.SpendCredits(static_cast<size_t>(row), frames);
+            // Every send path marks its hop. Only the first unacknowledged frame needs the clock
+            if (neighborTable.Link(static_cast<size_t>(row)).pendingSince == LINK_NOT_PENDING) {
+                neighborTable.RecordSent(static_cast<size_t>(row), Now());
+            }
+        }
+        return row;
+    }
+
+    void THOR::SpendRoute(size_t written)
+    {
+        energy.Sent(written, 1, RowRssi(MarkVisited(routedHop, 1)));
+    }
+
+    void THOR::RecordDelivery(uint32_t nodeId, bool delivered)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::DELIVERY);
+            tracer.Put32(nodeId);
+            tracer.Put8(delivered ? 1 : 0);
+            tracer.End();
+        }
+        long row = neighborTable.Find(nodeId);
+        if (row >= 0) {
+            neighborTable.RecordOutcome(static_cast<size_t>(row), delivered, Now());
+        }
+    }
+
+    uint32_t THOR::GetBestNextHop()
+    {
+#ifdef THOR_ENABLE_METRICS
+        bool timed = metrics.CountBestHopCall();
+        std::chrono::steady_clock::time_point start;
+        if (timed) {
+            start = std::chrono::steady_clock::now();
+        }
+#endif
+        uint32_t hop = 0;
+
+        // Scores are kept up to date on every table write, the best row is the heap top.
+        // Equal scores go to the lowest id (same winner as the old id-ordered map walk).
+        long best = neighborTable.Best();
+
+        // Only scores above -1 are usable, like the original maxScore = -1 scan.
+        if (best >= 0 && neighborTable.Scores()[best] > -1) {
+            hop = neighborTable.Ids()[best];
+        }
+        // Budgeted, battery partly gone: a runner-up on a cleaner link may cost less per frame
+        if (hop != 0 && energy.Pressure() != 0) {
+            hop = EnergyHop();
+        }
+#ifdef THOR_ENABLE_METRICS
+        if (timed) {
+            metrics.RecordBestHopLatency(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+        }
+#endif
+        return hop;
+    }
+
+    uint32_t THOR::GetBestNextHop(uint32_t destinationId)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::BEST_HOP);
+            tracer.Put32(destinationId);
+            tracer.End();
+        }
+        uint32_t hop = NextHop(destinationId);
+        if (trace.Top()) {
+            uint8_t bytes[4];
+            StoreLE32(bytes, hop);
+            tracer.Output(TraceKind::NEXT_HOP, bytes, sizeof(bytes));
+        }
+        return hop;
+    }
+
+    uint32_t THOR::NextHop(uint32_t destinationId)
+    {
+        uint32_t hop = DestinationHop(destinationId);
+        return (hop != 0) ? hop : GetBestNextHop();
+    }
+
+    int64_t THOR::EnergyValue(uint32_t row) const
+    {
+        // x65536: weight (points per retransmission) x pressure / 256 x extra attempts / 256
+        int64_t extra = static_cast<int64_t>(energy.Attempts(neighborTable.Rssi()[row])) - 256;
+        return static_cast<int64_t>(neighborTable.Scores()[row]) * 65536 - energy.Weight() * static_cast<int64_t>(energy.Pressure()) * extra;
+    }
+
+    void THOR::RankByEnergy(std::vector<uint32_t>& rows, size_t keep)
+    {
+        // Insertion sort: a handful of rows, and equal values keep their order (best score first)
+        for (size_t i = 1; i < rows.size(); ++i) {
+            uint32_t row = rows[i];
+            int64_t value = EnergyValue(row);
+            size_t j = i;
+            for (; j > 0 && EnergyValue(rows[j - 1]) < value; --j) {
+                rows[j] = rows[j - 1];
+            }
+            rows[j] = row;
+        }
+        if (rows.size() > keep) {
+            rows.resize(keep);
+        }
+    }
+
+    uint32_t THOR::EnergyHop()
+    {
+        neighborTable.TopRows(energy.Candidates(), -1, energyRows);
+        RankByEnergy(energyRows, 1);
+        return energyRows.empty() ? 0 : neighborTable.Ids()[energyRows[0]];
+    }
+
+    bool THOR::WorthRelaying(uint32_t hop, uint32_t destinationId) const
+    {
+        if (hop == destinationId) {
+            return true;
+        }
+        long row = neighborTable.Find(hop);
+        return row >= 0 && (neighborTable.Flags()[row] & (NEIGHBOR_INTERNET_DIRECT | NEIGHBOR_INTERNET_INDIRECT)) != 0;
+    }
+
+    void THOR::SetEnergyBudget(uint64_t remainingNj, uint64_t fullNj)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::ENERGY_BUDGET);
+            tracer.Put64(remainingNj);
+            tracer.Put64(fullNj);
+            tracer.End();
+        }
+        energy.SetBudget(remainingNj, fullNj);
+        if (transmitSink) {
+            Flush(); // A charged battery releases what a low one held back
+        }
+    }
+
+    uint64_t THOR::EstimateTxNj(size_t frameSize, uint32_t nextHopId) const
+    {
+        long row = neighborTable.Find(nextHopId);
+        return row < 0 ? 0 : energy.LinkNj(frameSize, 1, neighborTable.Rssi()[row]);
+    }
+
+    bool THOR::Usable(uint32_t nodeId) const
+    {
+        long row = neighborTable.Find(nodeId);
+        return row >= 0 && neighborTable.Scores()[row] > -1;
+    }
+
+    uint32_t THOR::DestinationHop(uint32_t destinationId)
+    {
+        // 1. The destination is a neighbor: deliver peer-to-peer, no gateway involved
+        if (destinationId == BROADCAST_ID || destinationId == 0) {
+            return 0;
+        }
+        if (Usable(destinationId)) {
+            return destinationId;
+        }
+        // 2. A fresh route learned from the destination's ACKs, while its hop is usable
+        if (routeCache.Size() == 0) {
+            return 0;
+        }
+        uint32_t hop = routeCache.Lookup(destinationId, Now());
+        if (hop != 0 && !Usable(hop)) {
+            routeCache.Forget(hop);
+            hop = 0;
+        }
+        return hop; // 0: the caller falls back to internet gravity
+    }
+
+    // Returns a list of serialized packets ready to be sent via Bluetooth
+    std::vector<std::vector<uint8_t>> THOR::ProcessQueue() //Android Wrapper Endpoint function
+    {
+        std::vector<FrameView> frames;
+        ProcessQueue(frames);
+
+        std::vector<std::vector<uint8_t>> batchToSend;
+        batchToSend.reserve(frames.size());
+        for (const FrameView& frame : frames) {
+            batchToSend.emplace_back(frame.data, frame.data + frame.size);
+        }
+        return batchToSend;
+    }
+
+    size_t THOR::ProcessQueue(std::vector<FrameView>& outFrames)
+    {
+        // Whole queue in one shot, handed off to the wrapper immediately.
+        // Released slots keep their bytes until the next enqueue reuses them.
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::PROCESS_QUEUE);
+            tracer.End();
+        }
+        size_t count = DrainQueue(0, 0, outFrames);
+        CommitQueue(count);
+        return count;
+    }
+
+    size_t THOR::DrainQueue(size_t maxFrames, size_t maxBytes, std::vector<FrameView>& outFrames)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::DRAIN);
+            tracer.Put64(maxFrames);
+            tracer.Put64(maxBytes);
+            tracer.End();
+        }
+        outFrames.clear();
+        ClearDrain();
+        txFrames.clear();
+        txOffsets.clear();
+        packetQueue.SetInFlight(0); // Anything not committed goes out again
+        if (packetQueue.Timed(QueueOptions())) {
+            packetQueue.Expire(Now()); // Nothing is in flight now, every due packet goes
+        }
+
+        // 1. If queue is empty, nothing to do.
+        if (packetQueue.Empty()) {
+            return 0;
+        }
+
+        // 2. Check if we have valid targets NOW (the best hop, plus up to
+        // spreadNeighbors - 1 runners-up when load spreading is on)
+        size_t hopCount = SelectSpreadHops();
+
+        // 3. If still no neighbors, keep waiting.
+        if (hopCount == 0) {
+            return 0;
+        }
+
+        // 4. We have a target! Prepare the batch.
+        size_t bytes = 0;
+        uint64_t drainNj = 0;
+        size_t entries = 0;
+        bool afterFragment = false;
+        Header previous = {};
+        for (; entries < packetQueue.Size(); ++entries) {
+            uint8_t* frame = packetQueue.Frame(entries);
+            size_t payloadSize = packetQueue.FrameSize(entries) - sizeof(Header);
+            Header header;
+            DecodeHeader(frame, header);
+
+            // Fragments of one message queued by a relay stay on one link. A destination
+            // that is a neighbor, or has a learned route, skips the spreading.
+            bool sameMessage = afterFragment && header.type == THORPacketType::FRAGMENT &&
+                               header.originId == previous.originId && header.sequence == previous.sequence;
+            long routedLink = sameMessage ? -1 : DestinationLink(header.destinationId);
+            bool spread = !sameMessage && routedLink < 0;
+            size_t link = sameMessage ? inFlightLinks.back() : (spread ? NextSpreadLink(hopCount) : static_cast<size_t>(routedLink));
+
+            // Update the routing info
+            header.nextHopId = spreadHops[link];
+
+            // Mark as visited so we don't loop back immediately
+            header.flagsAndTTL.visited = 1;
+
+            // A message split into fragments goes out whole, except at the head of the
+            // queue: there it may take several drains. Either way it resumes where the
+            // radio stopped, even if other packets were ordered in front of it since.
+            size_t perFragment = FragmentPayload(header, payloadSize);
+            size_t total = (perFragment == 0) ? 1 : (payloadSize + perFragment - 1) / perFragment;
+            size_t sent = packetQueue.SentFragments(entries);
+            size_t first = (perFragment != 0 && sent < total) ? sent : 0;
+            size_t count = total - first;
+            size_t frameBudget = (maxFrames == 0) ? SIZE_MAX : maxFrames - outFrames.size();
+            // A link that runs out of credits ends the drain like the budget does (its
+            // score only drops once the commit spends them)
+            frameBudget = std::min<size_t>(frameBudget, spreadCredits[link]);
+            size_t wireBytes = WireBytes(header, payloadSize, perFragment, first, count);
+            while (count > 0 && (count > frameBudget || (maxBytes != 0 && bytes + wireBytes > maxBytes))) {
+                if (entries != 0 || perFragment == 0) {
+                    count = 0;
+                } else {
+                    --count;
+                    wireBytes = WireBytes(header, payloadSize, perFragment, first, count);
+                }
+            }
+            // Budgeted, battery low: the drain stops before it would cost more than is left
+            if (count > 0 && energy.Low()) {
+                uint64_t cost = energy.LinkNj(wireBytes, count, spreadRssi[link]);
+                count = (drainNj + cost > energy.Remaining()) ? 0 : count;
+                drainNj += cost;
+            }
+            if (count == 0) {
+                if (spread) {
+                    UndoSpreadLink(link, hopCount);
+                }
+                break; // Budget used up, the rest waits for the next call
+            }
+            headPartial = headPartial || (entries == 0 && first + count < total);
+
+            // Patch the header in place, the payload never moves
+            EncodeHeader(header, frame);
+            EmitFrames(header, frame, payloadSize, perFragment, first, count, outFrames);
+            inFlightLinks.push_back(static_cast<uint32_t>(link));
+            entryFrames.push_back(static_cast<uint32_t>(count));
+            if (spreadCredits[link] != UINT32_MAX) {
+                spreadCredits[link] -= static_cast<uint32_t>(count);
+            }
+            bytes += wireBytes;
+            afterFragment = header.type == THORPacketType::FRAGMENT;
+            previous = header;
+            if (first + count < total) {
+                ++entries;
+                break; // Head message only partly handed out
+            }
+        }
+
+        // txFrames no longer grows: views into it are stable now
+        for (size_t i = 0; i < outFrames.size() && !txFrames.empty(); ++i) {
+            if (txOffsets[i] != NO_TX_OFFSET) {
+                outFrames[i].data = txFrames.data() + txOffsets[i];
+            }
+        }
+
+        // 5. Mark the neighbors that got frames as "busy" for this transaction
+        for (size_t j = 0; j < spreadHops.size(); ++j) {
+            bool used = false;
+            for (size_t i = 0; i < inFlightLinks.size() && !used; ++i) {
+                used = (inFlightLinks[i] == j);
+            }
+            if (used) {
+                MarkVisited(spreadHops[j], 0); // Credits are spent on what CommitQueue confirms
+            }
+        }
+
+        // 6. Pin what we handed out until the radio confirms it
+        packetQueue.SetInFlight(entries);
+        if (tracer.InCall()) {
+            for (const FrameView& frame : outFrames) {
+                tracer.Output(TraceKind::FRAME_OUT, frame.data, frame.size);
+            }
+        }
+        return outFrames.size();
+    }
+
+    long THOR::DestinationLink(uint32_t destinationId)
+    {
+        uint32_t hop = DestinationHop(destinationId);
+        if (hop == 0 || (energy.Low() && !WorthRelaying(hop, destinationId))) {
+            return -1;
+        }
+        for (size_t j = 0; j < spreadHops.size(); ++j) {
+            if (spreadHops[j] == hop) {
+                return static_cast<long>(j);
+            }
+        }
+        // A link outside the spread set: appended after it, round-robin never picks it
+        spreadHops.push_back(hop);
+        spreadWeights.push_back(0);
+        spreadCurrent.push_back(0);
+        long row = neighborTable.Find(hop);
+        spreadCredits.push_back(LinkCredits(neighborTable.Link(static_cast<size_t>(row))));
+        spreadRssi.push_back(static_cast<int8_t>(RowRssi(row)));
+        return static_cast<long>(spreadHops.size() - 1);
+    }
+
+    size_t THOR::NextSpreadLink(size_t hopCount)
+    {
+        // Smooth weighted round-robin: deterministic, proportional to the weights
+        size_t link = 0;
+        if (hopCount > 1) {
+            int64_t total = 0;
+            for (size_t j = 0; j < hopCount; ++j) {
+                spreadCurrent[j] += spreadWeights[j];
+                total += spreadWeights[j];
+                if (spreadCurrent[j] > spreadCurrent[link]) {
+                    link = j;
+                }
+            }
+            spreadCurrent[link] -= total;
+        }
+        return link;
+    }
+
+    void THOR::UndoSpreadLink(size_t link, size_t hopCount)
+    {
+        if (hopCount > 1) {
+            int64_t total = 0;
+            for (size_t j = 0; j < hopCount; ++j) {
+                spreadCurrent[j] -= spreadWeights[j];
+                total += spreadWeights[j];
+            }
+            spreadCurrent[link] += total;
+        }
+    }
+
+    size_t THOR::FragmentPayload(const Header& header, size_t payloadSize) const
+    {
+        if (fragmentSize == 0 || header.type != THORPacketType::DATA || WireHeaderSize(header) + payloadSize <= fragmentSize) {
+            return 0;
+        }
+        Header piece = header;
+        piece.type = THORPacketType::FRAGMENT;
+        size_t overhead = WireHeaderSize(piece) + FRAGMENT_HEADER_SIZE;
+        if (fragmentSize <= overhead) {
+            return 0; // No room for a piece: send it whole
+        }
+        size_t perFragment = fragmentSize - overhead;
+        size_t count = (payloadSize + perFragment - 1) / perFragment;
+        return (count <= FRAGMENT_MAX && payloadSize <= UINT16_MAX) ? perFragment : 0;
+    }
+
+    size_t THOR::WireBytes(const Header& header, size_t payloadSize, size_t perFragment, size_t first, size_t count) const
+    {
+        if (perFragment == 0) {
+            return WireHeaderSize(header) + payloadSize;
+        }
+        Header piece = header;
+        piece.type = THORPacketType::FRAGMENT;
+        size_t end = std::min(payloadSize, (first + count) * perFragment);
+        return count * (WireHeaderSize(piece) + FRAGMENT_HEADER_SIZE) + (end - first * perFragment);
+    }
+
+    void THOR::EmitFrames(const Header& header, uint8_t* frame, size_t payloadSize, size_t perFragment, size_t first, size_t count,
+                          std::vector<FrameView>& outFrames)
+    {
+        // Views into txFrames get their pointer once the drain is done (it may still grow)
+        const uint8_t* payload = frame + sizeof(Header);
+        if (perFragment == 0) {
+            size_t headerSize = WireHeaderSize(header);
+            if (headerSize == sizeof(Header)) {
+                outFrames.push_back({ frame, sizeof(Header) + payloadSize });
+                txOffsets.push_back(NO_TX_OFFSET);
+                return;
+            }
+            size_t at = txFrames.size();
+            txFrames.resize(at + headerSize + payloadSize);
+            WriteHeader(header, txFrames.data() + at, headerSize);
+            std::memcpy(txFrames.data() + at + headerSize, payload, payloadSize);
+            outFrames.push_back({ nullptr, headerSize + payloadSize });
+            txOffsets.push_back(at);
+            return;
+        }
+
+        Header piece = header;
+        piece.type = THORPacketType::FRAGMENT;
+        size_t headerSize = WireHeaderSize(piece);
+        FragmentHeader fragment;
+        fragment.count = static_cast<uint8_t>((payloadSize + perFragment - 1) / perFragment);
+        for (size_t index = first; index < first + count; ++index) {
+            size_t offset = index * perFragment;
+            size_t size = std::min(perFragment, payloadSize - offset);
+            fragment.index = static_cast<uint8_t>(index);
+            fragment.offset = static_cast<uint16_t>(offset);
+
+            size_t at = txFrames.size();
+            txFrames.resize(at + headerSize + FRAGMENT_HEADER_SIZE + size);
+            uint8_t* out = txFrames.data() + at;
+            WriteHeader(piece, out, headerSize);
+            EncodeFragmentHeader(fragment, out + headerSize);
+            std::memcpy(out + headerSize + FRAGMENT_HEADER_SIZE, payload + offset, size);
+            outFrames.push_back({ nullptr, headerSize + FRAGMENT_HEADER_SIZE + size });
+            txOffsets.push_back(at);
+        }
+    }
+
+    size_t THOR::SelectSpreadHops()
+    {
+        spreadHops.clear();
+        spreadWeights.clear();
+        spreadCurrent.clear();
+        spreadCredits.clear();
+        spreadRssi.clear();
+
+        // Same eligibility as GetBestNextHop: best first, only scores above -1
+        if (!energy.Steering()) {
+            neighborTable.TopRows(spreadNeighbors, -1, scratchRows);
+        } else {
+            // Budgeted: the cheapest of a few more candidates, only hops toward the internet on a low battery
+            neighborTable.TopRows(std::max(spreadNeighbors, energy.Candidates()), -1, scratchRows);
+            if (energy.Low()) {
+                const uint8_t* flags = neighborTable.Flags();
+                scratchRows.erase(std::remove_if(scratchRows.begin(), scratchRows.end(), [flags](uint32_t row) {
+                    return (flags[row] & (NEIGHBOR_INTERNET_DIRECT | NEIGHBOR_INTERNET_INDIRECT)) == 0;
+                }), scratchRows.end());
+            }
+            RankByEnergy(scratchRows, spreadNeighbors);
+        }
+
+        // Links without history are weighted like the average known link so they get tried
+        float knownSum = 0.0f;
+        size_t known = 0;
+        for (uint32_t row : scratchRows) {
+            if (neighborTable.Throughput(row) > 0.0f) {
+                knownSum += neighborTable.Throughput(row);
+                ++known;
+            }
+        }
+        float unknownWeight = (known > 0) ? knownSum / known : 1.0f;
+
+        for (uint32_t row : scratchRows) {
+            int64_t weight = 1;
+            if (spreadWeight == SpreadWeight::THROUGHPUT) {
+                float throughput = neighborTable.Throughput(row);
+                weight = static_cast<int64_t>(throughput > 0.0f ? throughput : unknownWeight);
+            } else {
+                weight = neighborTable.Scores()[row];
+            }
+            spreadHops.push_back(neighborTable.Ids()[row]);
+            spreadWeights.push_back(weight < 1 ? 1 : weight);
+            spreadCurrent.push_back(0);
+            spreadCredits.push_back(LinkCredits(neighborTable.Link(row)));
+            spreadRssi.push_back(neighborTable.Rssi()[row]);
+        }
+        return spreadHops.size();
+    }
+
+    void THOR::RecordLinkThroughput(const std::vector<bool>* accepted, size_t acceptedPrefix)
+    {
+        // Bytes each link of the last drain actually took (spreadCurrent is free to reuse now),
+        // and whether it took everything it was given (-1 = link got nothing)
+        spreadCurrent.assign(spreadHops.size(), 0);
+        linkOutcomes.assign(spreadHops.size(), -1);
+        linkFrames.assign(spreadHops.size(), 0);
+        for (size_t i = 0; i < packetQueue.InFlight() && i < inFlightLinks.size(); ++i) {
+            bool ok = accepted ? (i < accepted->size() && (*accepted)[i]) : (i < acceptedPrefix);
+            if (ok) {
+                spreadCurrent[inFlightLinks[i]] += static_cast<int64_t>(packetQueue.FrameSize(i));
+                linkFrames[inFlightLinks[i]] += (i < entryFrames.size()) ? entryFrames[i] : 1;
+            }
+            int8_t& outcome = linkOutcomes[inFlightLinks[i]];
+            outcome = (outcome == 0 || !ok) ? 0 : 1;
+        }
+        // EWMA per link, alpha = 1/4
+        for (size_t j = 0; j < spreadHops.size(); ++j) {
+            if (linkFrames[j] != 0) {
+                energy.Sent(static_cast<size_t>(spreadCurrent[j]), linkFrames[j], spreadRssi[j]);
+            }
+            long row = neighborTable.Find(spreadHops[j]);
+            if (row < 0) {
+                continue;
+            }
+            float sample = static_cast<float>(spreadCurrent[j]);
+            float previous = neighborTable.Throughput(static_cast<size_t>(row));
+            neighborTable.SetThroughput(static_cast<size_t>(row), previous > 0.0f ? 0.75f * previous + 0.25f * sample : sample);
+            // One delivery sample per link and drain: did the radio take all it was given
+            if (linkOutcomes[j] >= 0) {
+                neighborTable.RecordOutcome(static_cast<size_t>(row), linkOutcomes[j] == 1, Now());
+            }
+            neighborTable.SpendCredits(static_cast<size_t>(row), linkFrames[j]);
+        }
+    }
+
+    void THOR::ClearDrain()
     {
-        std::vector<uint8_t> buffer;
-        buffer.reserve(sizeof(Header) + packet.payload.size());
-        const uint8_t* headerPtr    = reinterpret_cast<const uint8_t*>(&packet.header);
-        buffer.insert(buffer.end(), headerPtr, headerPtr + sizeof(Header));
-        buffer.insert(buffer.end(), packet.payload.begin(), packet.payload.end());
+        spreadHops.clear();
+        inFlightLinks.clear();
+        entryFrames.clear();
+        headPartial = false;
+    }
 
-        return buffer;
+    void THOR::AdvanceFragments(size_t entry, size_t acceptedFrames)
+    {
+        // An entry that stays queued remembers how far the radio got into it. Only
+        // fragmented messages hand out more than one frame, so nothing else moves.
+        if (acceptedFrames != 0 && entry < entryFrames.size() && entry < packetQueue.InFlight()) {
+            packetQueue.SetSentFragments(entry, packetQueue.SentFragments(entry) + static_cast<uint32_t>(acceptedFrames));
+        }
     }
-    
-    std::vector<uint8_t> THOR::SerializeHeader(const Header& header) 
+
+    void THOR::CommitQueue(size_t accepted)
     {
-        std::vector<uint8_t> buffer;
-        buffer.reserve(sizeof(Header));
-        const uint8_t* headerPtr = reinterpret_cast<const uint8_t*>(&header);
-        buffer.insert(buffer.end(), headerPtr, headerPtr + sizeof(Header));
-        
-        return buffer;
+        // Accepted frames leave the queue, the others return to its head. An entry
+        // leaves once every frame it was split into got through.
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::COMMIT);
+            tracer.Put64(accepted);
+            tracer.End();
+        }
+        if (packetQueue.InFlight() == 0) {
+            ClearDrain(); // Nothing handed out, or committed already
+            return;
+        }
+        size_t count = 0;
+        size_t frames = accepted;
+        while (count < entryFrames.size() && count < packetQueue.InFlight() && frames >= entryFrames[count] &&
+               (count != 0 || !headPartial)) {
+            frames -= entryFrames[count];
+            ++count;
+        }
+        if (count < entryFrames.size()) {
+            AdvanceFragments(count, std::min<size_t>(frames, entryFrames[count]));
+        }
+        THOR_METRIC(metrics.Count(MetricEvent::FORWARDED, static_cast<uint8_t>(THORPacketType::DATA), count));
+        RecordLinkThroughput(nullptr, count);
+        packetQueue.PopFront(count);
+        packetQueue.SetInFlight(0);
+        ClearDrain();
     }
-    
-    bool THOR::Deserialize(const std::vector<uint8_t>& data, Packet& outPacket) 
+
+    void THOR::CommitQueue(const std::vector<bool>& accepted)
     {
-        if (data.size() < sizeof(Header)) {
-            return false; // Error: Data too short to be a valid packet
+        // Per entry: accepted if all its frames were, and the head message is complete
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::COMMIT_FRAMES);
+            tracer.Put32(static_cast<uint32_t>(accepted.size()));
+            for (bool frameAccepted : accepted) {
+                tracer.Put8(frameAccepted ? 1 : 0);
+            }
+            tracer.End();
         }
-        std::memcpy(&outPacket.header, data.data(), sizeof(Header));
-        size_t payloadSize = data.size() - sizeof(Header);
-        if (payloadSize > 0) {
-            outPacket.payload.resize(payloadSize);
-            std::memcpy(outPacket.payload.data(), data.data() + sizeof(Header), payloadSize);
-        } else {
-            outPacket.payload.clear();
+        if (packetQueue.InFlight() == 0) {
+            ClearDrain();
+            return;
         }
+        entryAccepted.assign(entryFrames.size(), false);
+        size_t frame = 0;
+        for (size_t i = 0; i < entryFrames.size(); ++i) {
+            bool all = true;
+            size_t prefix = 0;
+            for (uint32_t k = 0; k < entryFrames[i]; ++k, ++frame) {
+                all = all && frame < accepted.size() && accepted[frame];
+                prefix += all ? 1 : 0;
+            }
+            entryAccepted[i] = all && (i != 0 || !headPartial);
+            if (!entryAccepted[i]) {
+                AdvanceFragments(i, prefix);
+            }
+        }
+#ifdef THOR_ENABLE_METRICS
+        size_t count = 0;
+        for (size_t i = 0; i < packetQueue.InFlight() && i < entryAccepted.size(); ++i) {
+            count += entryAccepted[i] ? 1 : 0;
+        }
+        metrics.Count(MetricEvent::FORWARDED, static_cast<uint8_t>(THORPacketType::DATA), count);
+#endif
+        RecordLinkThroughput(&entryAccepted, 0);
+        packetQueue.CommitInFlight(entryAccepted);
+        ClearDrain();
+    }
 
-        return true;
+    // ---------------------------------------------------------------
+    // Zero-copy API: caller owns every buffer, nothing here allocates.
+    // Queued packets go to the preallocated slab.
+    // ---------------------------------------------------------------
+
+    size_t THOR::Serialize(const Header& header, const uint8_t* payload, size_t payloadSize, uint8_t* out, size_t outSize)
+    {
+        size_t headerSize = WireHeaderSize(header);
+        size_t frameSize = headerSize + payloadSize;
+        if (out == nullptr || outSize < frameSize) {
+            return 0; // Error: Caller buffer too small
+        }
+        // Payload first: when 'out' is the received frame, the header may grow or shrink
+        if (payloadSize > 0 && out + headerSize != payload) {
+            std::memmove(out + headerSize, payload, payloadSize);
+        }
+        WriteHeader(header, out, headerSize);
+        return frameSize;
     }
-    
-    bool THOR::DeserializeHeader(const std::vector<uint8_t>& data, Header& outheader) 
+
+    size_t THOR::Serialize(const Packet& packet, uint8_t* out, size_t outSize)
     {
-        if (data.size() < sizeof(Header)) {
-            return false; // Error: Data too short to be a valid packet
+        return Serialize(packet.header, packet.payload.data(), packet.payload.size(), out, outSize);
+    }
+
+    size_t THOR::SerializeHeader(const Header& header, uint8_t* out, size_t outSize)
+    {
+        return Serialize(header, nullptr, 0, out, outSize);
+    }
+
+    bool THOR::Deserialize(const uint8_t* data, size_t size, PacketView& outView)
+    {
+        size_t headerSize = ReadHeader(data, size, outView.header);
+        if (headerSize == 0) {
+            return false;
         }
-        std::memcpy(&outheader , data.data(), sizeof(Header));
+        outView.payload = data + headerSize;
+        outView.payloadSize = size - headerSize;
         return true;
     }
-    
-    std::vector<uint8_t> THOR::CreateHello(uint32_t DestId ,uint32_t SenderId, uint32_t OriginId, uint32_t Sequence)
+
+    bool THOR::DeserializeHeader(const uint8_t* data, size_t size, Header& outheader)
+    {
+        return ReadHeader(data, size, outheader) != 0;
+    }
+
+    size_t THOR::ReadHeader(const uint8_t* data, size_t size, Header& outheader) const
+    {
+        if (IsCompactFrame(data, size)) {
+            return DecodeCompactHeader(data, size, outheader);
+        }
+        if (data == nullptr || size < sizeof(Header)) {
+            return 0; // Error: Data too short to be a valid packet
+        }
+        DecodeHeader(data, outheader);
+        return sizeof(Header);
+    }
+
+    size_t THOR::WireHeaderSize(const Header& header) const
+    {
+        if (compactHeaders) {
+            size_t compact = CompactHeaderSize(header);
+            if (compact < sizeof(Header)) {
+                return compact;
+            }
+        }
+        return sizeof(Header);
+    }
+
+    void THOR::WriteHeader(const Header& header, uint8_t* out, size_t headerSize) const
+    {
+        if (headerSize == sizeof(Header)) {
+            EncodeHeader(header, out);
+        } else {
+            EncodeCompactHeader(header, out, headerSize);
+        }
+    }
+
+    size_t THOR::CreateHello(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, uint8_t* out, size_t outSize)
     {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::CREATE_HELLO);
+            tracer.Put32(DestId);
+            tracer.Put32(SenderId);
+            tracer.Put32(OriginId);
+            tracer.Put32(Sequence);
+            tracer.Put32(static_cast<uint32_t>(outSize));
+            tracer.End();
+        }
         Header header = {};
 
         header.senderId = SenderId;
@@ -65,11 +1011,34 @@
         header.flagsAndTTL.visited = 0;
         header.flagsAndTTL.myInternet = 0;
         header.flagsAndTTL.intneighbour = 0;
-        return SerializeHeader(header);
+        beaconScheduler.Sent(Now(), SenderId, BeaconUrgent());
+        THOR_METRIC(metrics.Count(MetricEvent::SENT, static_cast<uint8_t>(THORPacketType::HELLO)));
+        size_t written = SerializeHeader(header, out, outSize);
+        written = (written == 0) ? 0 : written + AppendLoad(out + written, outSize - written);
+        if (written != 0) {
+            energy.Broadcast(written);
+        }
+        if (trace.Top()) {
+            tracer.Output(TraceKind::FRAME_OUT, out, written);
+        }
+        return written;
     }
-    
-    std::vector<uint8_t> THOR::CreateACK(uint32_t DestId, uint32_t SenderId,uint32_t OriginId,uint32_t NextHopId,uint32_t Sequence, bool myinternet, bool intneighbour)
+
+    size_t THOR::CreateACK(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t NextHopId, uint32_t Sequence, bool myinternet, bool intneighbour, uint8_t* out, size_t outSize)
     {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::CREATE_ACK);
+            tracer.Put32(DestId);
+            tracer.Put32(SenderId);
+            tracer.Put32(OriginId);
+            tracer.Put32(NextHopId);
+            tracer.Put32(Sequence);
+            tracer.Put8(myinternet ? 1 : 0);
+            tracer.Put8(intneighbour ? 1 : 0);
+            tracer.Put32(static_cast<uint32_t>(outSize));
+            tracer.End();
+        }
         Header header = {};
         header.senderId = SenderId;//My ID
         header.destinationId = DestId;
@@ -81,24 +1050,259 @@
         header.type = THORPacketType::ACK;
         header.flagsAndTTL.intneighbour = intneighbour ? 1 : 0;
         header.flagsAndTTL.myInternet = myinternet ? 1 : 0;
-        return SerializeHeader(header); 
+        THOR_METRIC(metrics.Count(MetricEvent::SENT, static_cast<uint8_t>(THORPacketType::ACK)));
+        size_t written = SerializeHeader(header, out, outSize);
+        written = (written == 0) ? 0 : written + AppendLoad(out + written, outSize - written);
+        if (written != 0) {
+            energy.Broadcast(written);
+        }
+        if (trace.Top()) {
+            tracer.Output(TraceKind::FRAME_OUT, out, written);
+        }
+        return written;
     }
-    
-    bool THOR::HandleHello(const std::vector<uint8_t>& data, Header& outheader)
+
+    size_t THOR::CreateControl(uint32_t SenderId, uint32_t Sequence, bool myinternet, bool intneighbour, uint8_t* out, size_t outSize)
     {
-        return DeserializeHeader(data, outheader);
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::CREATE_CONTROL);
+            tracer.Put32(SenderId);
+            tracer.Put32(Sequence);
+            tracer.Put8(myinternet ? 1 : 0);
+            tracer.Put8(intneighbour ? 1 : 0);
+            tracer.Put32(static_cast<uint32_t>(outSize));
+            tracer.End();
+        }
+        Header header = {};
+        header.senderId = SenderId;
+        header.destinationId = BROADCAST_ID;
+        header.originId = SenderId;
+        header.nextHopId = BROADCAST_ID;
+        header.sequence = Sequence;
+        header.type = THORPacketType::CONTROL;
+        header.flagsAndTTL.ttl = 1;
+        header.flagsAndTTL.visited = 0;
+        header.flagsAndTTL.myInternet = myinternet ? 1 : 0;
+        header.flagsAndTTL.intneighbour = intneighbour ? 1 : 0;
+
+        size_t headerSize = WireHeaderSize(header);
+        if (out == nullptr || outSize < headerSize + CONTROL_BODY_SIZE) {
+            return 0;
+        }
+        // The load trailer goes last; it takes the room of an ACK entry only when the buffer is that tight
+        size_t room = outSize - headerSize - CONTROL_BODY_SIZE;
+        size_t ackCount = std::min(pendingAcks.size(), room / CONTROL_ACK_SIZE);
+        if (advertiseLoad && ackCount > 0 && room - ackCount * CONTROL_ACK_SIZE < LOAD_ADVERT_SIZE) {
+            --ackCount;
+        }
+        uint64_t bitmap = 0;
+        const uint32_t* ids = neighborTable.Ids();
+        for (size_t row = 0; row < neighborTable.Size(); ++row) {
+            bitmap |= NeighborSummaryBit(ids[row]);
+        }
+
+        uint8_t* body = out + headerSize;
+        WriteHeader(header, out, headerSize);
+        body[0] = static_cast<uint8_t>(ackCount);
+        body[1] = static_cast<uint8_t>(std::min<size_t>(neighborTable.Size(), 255));
+        StoreLE64(body + 2, bitmap);
+        if (ackCount > 0) {
+            for (size_t i = 0; i < ackCount; ++i) {
+                EncodeControlAck(pendingAcks[i], body + CONTROL_BODY_SIZE + i * CONTROL_ACK_SIZE);
+            }
+            pendingAcks.erase(pendingAcks.begin(), pendingAcks.begin() + static_cast<long>(ackCount));
+        }
+
+        size_t written = headerSize + CONTROL_BODY_SIZE + ackCount * CONTROL_ACK_SIZE;
+        written += AppendLoad(out + written, outSize - written);
+        beaconScheduler.Sent(Now(), SenderId, BeaconUrgent());
+        energy.Broadcast(written);
+        THOR_METRIC(metrics.Count(MetricEvent::SENT, static_cast<uint8_t>(THORPacketType::CONTROL)));
+        if (trace.Top()) {
+            tracer.Output(TraceKind::FRAME_OUT, out, written);
+        }
+        return written;
     }
-    
-    bool THOR::HandleAck(const std::vector<uint8_t>& data, Header& outheader)
+
+    void THOR::QueueAck(uint32_t originId, uint32_t sequence)
     {
-        return DeserializeHeader(data,outheader);
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::QUEUE_ACK);
+            tracer.Put32(originId);
+            tracer.Put32(sequence);
+            tracer.End();
+        }
+        for (ControlAck& ack : pendingAcks) {
+            if (ack.originId == originId) {
+                ack.sequence = sequence; // Only the latest HELLO of a node matters
+                return;
+            }
+        }
+        if (pendingAcks.size() < CONTROL_MAX_ACKS) {
+            pendingAcks.push_back({ originId, sequence });
+        }
     }
-    
-    std::vector<uint8_t> THOR::SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const std::vector<uint8_t>& payload)
+
+    bool THOR::HandleHello(const uint8_t* data, size_t size, Header& outheader)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::HELLO_IN);
+            tracer.PutBytes(data, size);
+            tracer.End();
+        }
+        energy.Received(size);
+        size_t headerSize = ReadHeader(data, size, outheader);
+        bool ok = headerSize != 0;
+        if (ok) {
+            QueueAck(outheader.originId, outheader.sequence);
+            ReadLoad(outheader.senderId, data + headerSize, size - headerSize);
+        }
+        THOR_METRIC(metrics.Count(MetricEvent::RECEIVED, static_cast<uint8_t>(THORPacketType::HELLO)));
+        THOR_METRIC(if (!ok) metrics.Count(MetricEvent::DROPPED, static_cast<uint8_t>(THORPacketType::HELLO)));
+        return ok;
+    }
+
+    bool THOR::HandleAck(const uint8_t* data, size_t size, Header& outheader)
+    {
+        ControlView control;
+        return HandleAck(data, size, outheader, control);
+    }
+
+    bool THOR::HandleAck(const uint8_t* data, size_t size, Header& outheader, ControlView& outControl)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::ACK_IN);
+            tracer.PutBytes(data, size);
+            tracer.End();
+        }
+        outControl = ControlView();
+        energy.Received(size);
+        size_t headerSize = ReadHeader(data, size, outheader);
+        bool ok = headerSize != 0;
+        uint8_t type = static_cast<uint8_t>(THORPacketType::ACK);
+        long row = ok ? neighborTable.Find(outheader.senderId) : -1;
+        if (row >= 0) {
+            neighborTable.RecordAck(static_cast<size_t>(row), Now()); // Latency sample if we sent it something
+        }
+        bool answers = outheader.type == THORPacketType::ACK || outheader.type == THORPacketType::DATA;
+        if (ok && answers && outheader.originId != outheader.senderId) {
+            routeCache.Learn(outheader.originId, outheader.senderId, Now()); // Relayed: the responder is behind the sender
+        }
+
+        if (ok && outheader.type == THORPacketType::CONTROL) {
+            type = static_cast<uint8_t>(THORPacketType::CONTROL);
+            const uint8_t* body = data + headerSize;
+            size_t bodySize = size - headerSize;
+            ok = bodySize >= CONTROL_BODY_SIZE && bodySize >= CONTROL_BODY_SIZE + body[0] * CONTROL_ACK_SIZE;
+            if (ok) {
+                outControl.ackCount = body[0];
+                outControl.neighborCount = body[1];
+                outControl.neighborBitmap = LoadLE64(body + 2);
+                outControl.acks = body + CONTROL_BODY_SIZE;
+                size_t entries = CONTROL_BODY_SIZE + body[0] * CONTROL_ACK_SIZE;
+                ReadLoad(outheader.senderId, body + entries, bodySize - entries);
+            }
+        } else if (ok) {
+            ReadLoad(outheader.senderId, data + headerSize, size - headerSize);
+        }
+        THOR_METRIC(metrics.Count(MetricEvent::RECEIVED, type));
+        THOR_METRIC(if (!ok) metrics.Count(MetricEvent::DROPPED, type));
+        (void)type;
+        if (ok && transmitSink) {
+            Flush(); // A fresh neighbor, or a route learned from this ACK
+        }
+        return ok;
+    }
+
+    LoadAdvert THOR::GetLoad() const
+    {
+        LoadAdvert advert = {};
+        size_t used = std::min(packetQueue.Size(), queueCapacity);
+        size_t free = queueCapacity - used;
+        advert.load = static_cast<uint8_t>(queueCapacity == 0 ? 255 : (used * 255 + queueCapacity - 1) / queueCapacity);
+        // Free slots shared out over the neighbors, every one of which may send to us.
+        // 254 at most: 255 means "no limit" on the receiving side.
+        size_t share = free / std::max<size_t>(neighborTable.Size(), 1);
+        if (share == 0 && free > 0) {
+            share = 1;
+        }
+        advert.credits = static_cast<uint8_t>(std::min<size_t>(share, LINK_CREDITS_UNLIMITED - 1));
+        return advert;
+    }
+
+    size_t THOR::AppendLoad(uint8_t* out, size_t outSize)
+    {
+        if (!advertiseLoad || outSize < LOAD_ADVERT_SIZE) {
+            return 0;
+        }
+        LoadAdvert advert = GetLoad();
+        EncodeLoadAdvert(advert, out);
+        advertisedCredits = advert.credits;
+        return LOAD_ADVERT_SIZE;
+    }
+
+    void THOR::ReadLoad(uint32_t nodeId, const uint8_t* trailer, size_t size)
+    {
+        if (size < LOAD_ADVERT_SIZE) {
+            return; // Sender does not advertise, or ran out of room
+        }
+        LoadAdvert advert = DecodeLoadAdvert(trailer);
+        long row = neighborTable.Find(nodeId);
+        if (row >= 0) {
+            neighborTable.RecordLoad(static_cast<size_t>(row), advert.load, advert.credits);
+        } else {
+            heardLoad = { nodeId, advert };
+        }
+    }
+
+    ControlAck ControlView::Ack(size_t index) const
+    {
+        return DecodeControlAck(acks + index * CONTROL_ACK_SIZE);
+    }
+
+    bool ControlView::Acknowledges(uint32_t originId, uint32_t sequence) const
+    {
+        for (size_t i = 0; i < ackCount; ++i) {
+            ControlAck ack = Ack(i);
+            if (ack.originId == originId && ack.sequence == sequence) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t THOR::SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize, uint8_t* out, size_t outSize)
+    {
+        return SendPacket(DestId, SenderId, OriginId, Sequence, payload, payloadSize, QueueOptions(), out, outSize);
+    }
+
+    size_t THOR::SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                            const QueueOptions& options, uint8_t* out, size_t outSize)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            TraceSend(false, DestId, SenderId, OriginId, Sequence, payload, payloadSize, options, outSize);
+        }
+        THORVerdict verdict;
+        size_t written = SendData(DestId, SenderId, OriginId, Sequence, payload, payloadSize, options, out, outSize, verdict);
+        if (written != 0) {
+            SpendRoute(written);
+        }
+        if (trace.Top()) {
+            tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(verdict));
+        }
+        return written;
+    }
+
+    size_t THOR::SendData(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                          const QueueOptions& options, uint8_t* out, size_t outSize, THORVerdict& outVerdict)
     {
         Header header = {};
-        Packet packet = {};
-        
+
         // 1. Setup Basic Info
         header.senderId = SenderId;
         header.destinationId = DestId;
@@ -108,180 +1312,412 @@
         header.type = THORPacketType::DATA;
         header.nextHopId = 0; // Default to 0
         header.flagsAndTTL.visited = 0;
-    
-        // 2. Routing Decision
-        uint32_t bestHop = GetBestNextHop(); //
-    
-        if (bestHop != 0) {
-            // --- PATH FOUND ---
-            neighborTable[bestHop].isVisited = true;
-            
+        duplicateCache.Record(OriginId, Sequence); // Our own packet looping back is dropped by CheckData (no clock read)
+
+        // 2. Routing Decision (only if the frame fits, otherwise keep it for later).
+        // Too long for one frame: the queue sends it as fragments on one link.
+        Header routed = header;
+        routed.nextHopId = NextHop(DestId);
+        routed.flagsAndTTL.visited = 1;
+        size_t frameSize = WireHeaderSize(routed) + payloadSize;
+
+        if (routed.nextHopId != 0 && outSize >= frameSize && (fragmentSize == 0 || frameSize <= fragmentSize)) {
+            // --- PATH FOUND --- (the caller marks the hop once the frame is handed off)
+            routedHop = routed.nextHopId;
+
             // Update the HEADER with the route
-            header.nextHopId = bestHop; 
-            header.flagsAndTTL.visited = 1;
-            packet.header = header; 
-            packet.payload = payload;
-            
-            return Serialize(packet); // Send immediately
-        } 
-        else {
-            // --- NO PATH (Store and Forward) ---
-            packet.header = header;
-            packet.payload = payload;
-    
-            if (packetQueue.size() < 50) {
-                packetQueue.push_back(packet);
+            header = routed;
+            if (options.supersede != 0) {
+                packetQueue.Supersede(OriginId, options.supersede); // This copy is newer than anything still queued
             }
-            return {}; // Return empty -> Stored for later.
+
+            THOR_METRIC(metrics.Count(MetricEvent::SENT, static_cast<uint8_t>(THORPacketType::DATA)));
+            outVerdict = THORVerdict::FORWARD;
+            size_t written = Serialize(header, payload, payloadSize, out, outSize); // Send immediately
+            tracer.Output(TraceKind::FRAME_OUT, out, written);
+            return written;
         }
+        // --- NO PATH (Store and Forward) ---
+        bool queued = Enqueue(header, payload, payloadSize, options);
+        THOR_METRIC(metrics.Count(queued ? MetricEvent::QUEUED : MetricEvent::DROPPED, static_cast<uint8_t>(THORPacketType::DATA)));
+        outVerdict = queued ? THORVerdict::QUEUE : THORVerdict::DROP;
+        return 0; // Nothing written -> Stored for later.
     }
-    
-    // Returns a Packet if we need to forward it, or an empty vector if dropped/queued/delivered.
-    std::vector<uint8_t> THOR::HandleData(const std::vector<uint8_t>& data, Packet& outPacket, uint32_t MyNodeId)
+
+    // Writes the frame to forward into 'out'. Returns 0 if dropped/queued/delivered.
+    size_t THOR::HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize)
     {
-        if (!Deserialize(data, outPacket)) return {};
+        THORVerdict verdict;
+        return HandleData(data, size, outView, MyNodeId, out, outSize, verdict);
+    }
 
-        if (outPacket.header.flagsAndTTL.ttl <= 1) {
-            return {};
+    size_t THOR::HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize, THORVerdict& outVerdict)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            TraceData(false, data, size, MyNodeId, outSize);
         }
-
-        // 3. Am I the destination?
-        if(outPacket.header.destinationId == MyNodeId)
-        {
-            return {};
+        size_t written = ReceiveData(data, size, outView, MyNodeId, out, outSize, outVerdict);
+        if (written != 0) {
+            SpendRoute(written);
         }
-        // 4. Decrement TTL
-        outPacket.header.flagsAndTTL.ttl -= 1;
+        THOR_METRIC(CountVerdict(outVerdict));
+        if (trace.Top()) {
+            tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(outVerdict));
+        }
+        return written;
+    }
 
-        // 5. Select Best Hop (Internet -> Indirect -> Explore)
-        uint32_t bestHop = GetBestNextHop();
+    void THOR::TraceSend(bool sink, uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload,
+                         size_t payloadSize, const QueueOptions& options, size_t outSize)
+    {
+        tracer.Begin(TraceKind::SEND);
+        tracer.Put8(sink ? 1 : 0);
+        tracer.Put32(DestId);
+        tracer.Put32(SenderId);
+        tracer.Put32(OriginId);
+        tracer.Put32(Sequence);
+        tracer.Put64(options.lifetimeMs);
+        tracer.Put8(options.supersede);
+        tracer.Put32(static_cast<uint32_t>(outSize));
+        tracer.PutBytes(payload, payloadSize);
+        tracer.End();
+    }
 
-        if (bestHop != 0) {
-            neighborTable[bestHop].isVisited = true;
-            // 6. Forward Accordingly
-            outPacket.header.nextHopId = bestHop;
-            outPacket.header.flagsAndTTL.visited = 1; // Mark path as used
-            return Serialize(outPacket); // Return bytes to send immediately
-        } 
-        else {
-            // 7. No neighbors -> Fail Gracefully (Store in Queue)
-            // Check if queue is full to prevent memory leaks
-            if (packetQueue.size() < 50) {
-                packetQueue.push_back(outPacket);
+    void THOR::TraceData(bool sink, const uint8_t* data, size_t size, uint32_t MyNodeId, size_t outSize)
+    {
+        tracer.Begin(TraceKind::DATA_IN);
+        tracer.Put8(sink ? 1 : 0);
+        tracer.Put32(MyNodeId);
+        tracer.Put32(static_cast<uint32_t>(outSize));
+        tracer.PutBytes(data, size);
+        tracer.End();
+    }
+
+    // ---------------------------------------------------------------
+    // Transmit sink: frames leave through the callback as soon as they
+    // have a route, straight from the slab or the scratch frame.
+    // ---------------------------------------------------------------
+
+    void THOR::SetTransmitSink(TransmitSink sink, size_t maxFrames, size_t maxBytes)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::SET_SINK);
+            tracer.Put8(sink ? 1 : 0);
+            tracer.Put64(maxFrames);
+            tracer.Put64(maxBytes);
+            tracer.End();
+        }
+        transmitSink = std::move(sink);
+        sinkMaxFrames = maxFrames;
+        sinkMaxBytes = maxBytes;
+    }
+
+    size_t THOR::Flush()
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::FLUSH);
+            tracer.End();
+        }
+        if (!transmitSink || packetQueue.Empty() || packetQueue.InFlight() != 0) {
+            return 0; // A manual drain is out: its commit decides what stays queued
+        }
+        size_t count = DrainQueue(sinkMaxFrames, sinkMaxBytes, sinkFrames);
+        if (count == 0) {
+            return 0; // No route yet
+        }
+        sinkAccepted.assign(count, false);
+        size_t taken = 0;
+        size_t frame = 0;
+        for (size_t entry = 0; entry < entryFrames.size() && taken == frame; ++entry) {
+            uint32_t hop = spreadHops[inFlightLinks[entry]];
+            for (uint32_t k = 0; k < entryFrames[entry] && taken == frame; ++k, ++frame) {
+                // The first refusal ends the flush: the radio is full, the rest waits
+                bool took = transmitSink(sinkFrames[frame], hop);
+                tracer.Output(TraceKind::SINK_ANSWER, static_cast<uint8_t>(took ? 1 : 0));
+                if (took) {
+                    sinkAccepted[frame] = true;
+                    ++taken;
+                }
             }
-            return {}; // Return empty -> Stored for later.
         }
+        CommitQueue(sinkAccepted);
+        return taken;
     }
-    
-    void THOR::NeighborStore(uint32_t nodeId, int rssi, bool hasInternetDirect, bool hasInternetIndirect, bool isVisited)
+
+    THORVerdict THOR::Transmit(size_t size, const QueueOptions& options)
     {
-        NeighborInfo& info = neighborTable[nodeId];
-        info.lastSeen = std::time(nullptr);
-        info.rssi = rssi;
-        info.hasInternetDirect = hasInternetDirect;
-        info.hasInternetIndirect = hasInternetIndirect;
-        info.isVisited = isVisited;
+        // sinkFrame holds a routed frame; if the radio is busy it waits in the queue
+        Header header;
+        size_t headerSize = ReadHeader(sinkFrame.data(), size, header);
+        bool took = transmitSink(FrameView{ sinkFrame.data(), size }, header.nextHopId);
+        tracer.Output(TraceKind::SINK_ANSWER, static_cast<uint8_t>(took ? 1 : 0));
+        if (took) {
+            SpendRoute(size);
+            return THORVerdict::FORWARD;
+        }
+        // Refused: the hop is neither marked nor charged, the frame waits for a drain
+        return Enqueue(header, sinkFrame.data() + headerSize, size - headerSize, options) ? THORVerdict::QUEUE : THORVerdict::DROP;
     }
-    
-    void THOR::RemoveOld()
+
+    THORVerdict THOR::SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                                 const QueueOptions& options)
+    {
+        // Without a sink there is nowhere to write: everything is queued
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            TraceSend(true, DestId, SenderId, OriginId, Sequence, payload, payloadSize, options, 0);
+        }
+        THORVerdict verdict;
+        size_t written = SendData(DestId, SenderId, OriginId, Sequence, payload, payloadSize, options, sinkFrame.data(),
+                                  transmitSink ? sinkFrame.size() : 0, verdict);
+        if (written != 0) {
+            verdict = Transmit(written, options);
+        } else if (verdict == THORVerdict::QUEUE) {
+            Flush(); // Fragmented messages leave through the queue
+        }
+        if (trace.Top()) {
+            tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(verdict));
+        }
+        return verdict;
+    }
+
+    THORVerdict THOR::HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            TraceData(true, data, size, MyNodeId, 0);
+        }
+        THORVerdict verdict;
+        size_t written = ReceiveData(data, size, outView, MyNodeId, sinkFrame.data(), transmitSink ? sinkFrame.size() : 0, verdict);
+        if (written != 0) {
+            verdict = Transmit(written, QueueOptions());
+        }
+        THOR_METRIC(CountVerdict(verdict));
+        if (trace.Top()) {
+            tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(verdict));
+        }
+        return verdict;
+    }
+
+    size_t THOR::ReceiveData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize, THORVerdict& outVerdict)
     {
-        // Remove neighbors we haven't heard from in 30 seconds
-        time_t now = std::time(nullptr);
-        auto it = neighborTable.begin();
+        outVerdict = THORVerdict::DROP;
+        energy.Received(size);
+        if (!Deserialize(data, size, outView)) return 0;
 
-        while (it != neighborTable.end()) {
-            NeighborInfo& info = it->second; // Standard syntax (No warnings)
+        outVerdict = CheckData(outView, MyNodeId);
+        if (outVerdict == THORVerdict::DELIVER && outView.header.type == THORPacketType::FRAGMENT) {
+            outVerdict = Reassemble(outView);
+        }
+        if (outVerdict != THORVerdict::FORWARD) {
+            return 0;
+        }
 
-            if (std::difftime(now, info.lastSeen) > 30.0) {
-                it = neighborTable.erase(it);
-            } else {
-                ++it;
-            }
+        // 5. Select Best Hop (Internet -> Indirect -> Explore)
+        Header forward = outView.header;
+        forward.nextHopId = (forward.type == THORPacketType::FRAGMENT) ? RouteFragment(forward) : NextHop(forward.destinationId);
+        forward.flagsAndTTL.visited = 1; // Mark path as used
+        if (forward.nextHopId != 0 && energy.Low() && !WorthRelaying(forward.nextHopId, forward.destinationId)) {
+            energy.Held(); // Battery low: only relays toward the internet or the destination go now
+            forward.nextHopId = 0;
         }
+
+        // The frame must fit 'out' in this node's encoding, otherwise keep it for later
+        if (forward.nextHopId != 0 && outSize >= WireHeaderSize(forward) + outView.payloadSize) {
+            routedHop = forward.nextHopId;
+            // 6. Forward Accordingly
+            outView.header = forward;
+            size_t written = Serialize(outView.header, outView.payload, outView.payloadSize, out, outSize);
+            outView.payload = out + written - outView.payloadSize; // Moved if 'out' aliases 'data'
+            tracer.Output(TraceKind::FRAME_OUT, out, written);
+            return written;
+        }
+        // 7. No neighbors -> Fail Gracefully (Store in Queue)
+        outVerdict = Enqueue(outView.header, outView.payload, outView.payloadSize) ? THORVerdict::QUEUE : THORVerdict::DROP;
+        return 0; // Nothing written -> Stored for later.
     }
-    
-    uint32_t THOR::GetBestNextHop() 
+
+    // Duplicate, TTL and destination checks shared by HandleData and HandleDataBatch.
+    // FORWARD means the packet still needs a next hop (TTL already decremented).
+    THORVerdict THOR::CheckData(PacketView& view, uint32_t MyNodeId)
     {
-        uint32_t bestNodeId = 0;
-        int maxScore = -1; 
-        if (neighborTable.empty()) return 0;
-        for (auto const& entry : neighborTable) {
-            
-            uint32_t id = entry.first;
-            const NeighborInfo& info = entry.second;
+        // 1. Same packet already reached us over another path? Fragments are told apart by
+        // index + 1 (up to 256), 0 is the whole packet.
+        uint16_t part = 0;
+        if (view.header.type == THORPacketType::FRAGMENT) {
+            if (view.payloadSize < FRAGMENT_HEADER_SIZE) {
+                return THORVerdict::DROP;
+            }
+            part = static_cast<uint16_t>(view.payload[0] + 1);
+        }
+        if (duplicateCache.CheckAndInsert(view.header.originId, view.header.sequence, Now(), part)) {
+            THOR_METRIC(metrics.Count(MetricCounter::DUPLICATE));
+            return THORVerdict::DROP;
+        }
+
+        // 2. TTL expired?
+        if (view.header.flagsAndTTL.ttl <= 1) {
+            THOR_METRIC(metrics.Count(MetricCounter::TTL_EXPIRED));
+            return THORVerdict::DROP;
+        }
+
+        // 3. Am I the destination?
+        if (view.header.destinationId == MyNodeId)
+        {
+            return THORVerdict::DELIVER;
+        }
+        // 4. Decrement TTL
+        view.header.flagsAndTTL.ttl -= 1;
+        return THORVerdict::FORWARD;
+    }
 
-            int currentScore = 0;
+    std::vector<std::vector<uint8_t>> THOR::HandleDataBatch(const std::vector<std::vector<uint8_t>>& frames, std::vector<Packet>& outPackets, std::vector<THORVerdict>& outVerdicts, uint32_t MyNodeId)
+    {
+        TraceScope trace(tracer, clock);
+        if (trace.Top()) {
+            tracer.Begin(TraceKind::DATA_BATCH);
+            tracer.Put32(MyNodeId);
+            tracer.Put32(static_cast<uint32_t>(frames.size()));
+            for (const std::vector<uint8_t>& frame : frames) {
+                tracer.Put32(static_cast<uint32_t>(frame.size()));
+                tracer.PutBytes(frame.data(), frame.size());
+            }
+            tracer.End();
+        }
+        std::vector<std::vector<uint8_t>> batchToSend;
+        outPackets.assign(frames.size(), Packet{});
+        outVerdicts.assign(frames.size(), THORVerdict::DROP);
 
-            // --- PRIORITY 1: DIRECT INTERNET  ---
-            if (info.hasInternetDirect) {
-                currentScore = 300; 
+        for (size_t i = 0; i < frames.size(); ++i) {
+            PacketView view;
+            energy.Received(frames[i].size());
+            if (!Deserialize(frames[i].data(), frames[i].size(), view)) {
+                THOR_METRIC(CountVerdict(THORVerdict::DROP));
+                tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(THORVerdict::DROP));
+                continue; // DROP
             }
-            // --- PRIORITY 2: INDIRECT INTERNET  ---
-            else if (info.hasInternetIndirect) {
-                currentScore = 200; 
+            THORVerdict verdict = CheckData(view, MyNodeId);
+            if (verdict == THORVerdict::DELIVER && view.header.type == THORPacketType::FRAGMENT) {
+                verdict = Reassemble(view);
             }
-            // --- PRIORITY 3: EXPLORATION  ---
-            else {
-                if (info.isVisited) {
-                    currentScore = 10;
+
+            if (verdict == THORVerdict::FORWARD) {
+                // The best-hop index makes this O(1) per frame (plus the route cache scan), the visited mark
+                // below re-sorts only the neighbor that changed.
+                uint32_t bestHop = (view.header.type == THORPacketType::FRAGMENT) ? RouteFragment(view.header) : NextHop(view.header.destinationId);
+                if (bestHop != 0 && energy.Low() && !WorthRelaying(bestHop, view.header.destinationId)) {
+                    energy.Held();
+                    bestHop = 0;
+                }
+
+                if (bestHop != 0) {
+                    int rssi = RowRssi(MarkVisited(bestHop, 1));
+                    view.header.nextHopId = bestHop;
+                    view.header.flagsAndTTL.visited = 1;
+                    std::vector<uint8_t> frame(sizeof(Header) + view.payloadSize);
+                    frame.resize(Serialize(view.header, view.payload, view.payloadSize, frame.data(), frame.size()));
+                    energy.Sent(frame.size(), 1, rssi);
+                    tracer.Output(TraceKind::FRAME_OUT, frame.data(), frame.size());
+                    batchToSend.push_back(std::move(frame));
                 } else {
-                    currentScore = 100;
+                    verdict = Enqueue(view.header, view.payload, view.payloadSize) ? THORVerdict::QUEUE : THORVerdict::DROP;
                 }
             }
-            
-            if (info.rssi > -50) {
-                currentScore -= 50;
-            }
+            outVerdicts[i] = verdict;
+            THOR_METRIC(CountVerdict(verdict));
+            tracer.Output(TraceKind::VERDICT, static_cast<uint8_t>(verdict));
+            outPackets[i].header = view.header;
+            outPackets[i].payload.assign(view.payload, view.payload + view.payloadSize);
+        }
+        return batchToSend;
+    }
 
-            else if (info.rssi <= -50 && info.rssi >= -80) {
-                currentScore += 50;
-            }
-            else {
-                 currentScore -= 20;
+    uint32_t THOR::RouteFragment(const Header& header)
+    {
+        // Forwarding fragment 0 marked its hop visited, so GetBestNextHop would now send
+        // the next one elsewhere. Follow the first fragment while that hop is around.
+        FragmentRoute* route = nullptr;
+        for (FragmentRoute& candidate : fragmentRoutes) {
+            if (candidate.nextHopId != 0 && candidate.originId == header.originId && candidate.sequence == header.sequence) {
+                route = &candidate;
+                break;
             }
-            if (currentScore > maxScore) {
-                maxScore = currentScore;
-                bestNodeId = id;
+        }
+        if (route != nullptr && neighborTable.Find(route->nextHopId) >= 0) {
+            return route->nextHopId;
+        }
+        uint32_t bestHop = NextHop(header.destinationId);
+        if (bestHop != 0) {
+            if (route == nullptr) {
+                route = &fragmentRoutes[nextFragmentRoute];
+                nextFragmentRoute = (nextFragmentRoute + 1) % fragmentRoutes.size();
             }
+            *route = { header.originId, header.sequence, bestHop };
         }
-        return (maxScore == -1) ? 0 : bestNodeId;
+        return bestHop;
     }
-    
-    // Returns a list of serialized packets ready to be sent via Bluetooth
-    std::vector<std::vector<uint8_t>> THOR::ProcessQueue() //Android Wrapper Endpoint function
+
+    THORVerdict THOR::Reassemble(PacketView& view)
     {
-        // 1. If queue is empty, nothing to do.
-        if (packetQueue.empty()) {
-            return {}; 
+        FragmentHeader fragment = DecodeFragmentHeader(view.payload);
+        const uint8_t* message = nullptr;
+        size_t messageSize = 0;
+        uint64_t rejected = reassembly.Stats().rejected;
+        if (!reassembly.Add(view.header.originId, view.header.sequence, fragment, view.payload + FRAGMENT_HEADER_SIZE,
+                            view.payloadSize - FRAGMENT_HEADER_SIZE, Now(), message, messageSize)) {
+            return (reassembly.Stats().rejected != rejected) ? THORVerdict::DROP : THORVerdict::PARTIAL;
         }
+        view.header.type = THORPacketType::DATA;
+        view.payload = message;
+        view.payloadSize = messageSize;
+        return THORVerdict::DELIVER;
+    }
 
-        // 2. Check if we have a valid target NOW
-        uint32_t bestHop = GetBestNextHop();
+    bool THOR::Enqueue(const Header& header, const uint8_t* payload, size_t payloadSize, const QueueOptions& options)
+    {
+        THOR_METRIC(QueueStats before = packetQueue.Stats());
+        // Capacity, ordering, eviction and lifetimes are handled by the queue policy
+        bool queued = packetQueue.Push(header, payload, payloadSize, packetQueue.Timed(options) ? Now() : 0, options);
+        THOR_METRIC(metrics.Count(MetricCounter::QUEUE_FULL, (packetQueue.Stats().rejected - before.rejected) +
+                                                              (packetQueue.Stats().evicted - before.evicted)));
+        return queued;
+    }
 
-        // 3. If still no neighbors (result is 0), keep waiting.
-        if (bestHop == 0) {
-            return {};
+    void THOR::CountVerdict(THORVerdict verdict)
+    {
+#ifdef THOR_ENABLE_METRICS
+        const uint8_t type = static_cast<uint8_t>(THORPacketType::DATA);
+        metrics.Count(MetricEvent::RECEIVED, type);
+        switch (verdict) {
+        case THORVerdict::DELIVER: metrics.Count(MetricEvent::DELIVERED, type); break;
+        case THORVerdict::FORWARD: metrics.Count(MetricEvent::FORWARDED, type); break;
+        case THORVerdict::QUEUE:   metrics.Count(MetricEvent::QUEUED, type); break;
+        case THORVerdict::DROP:    metrics.Count(MetricEvent::DROPPED, type); break;
+        case THORVerdict::PARTIAL: break;
         }
+#else
+        (void)verdict;
+#endif
+    }
 
-        // 4. We have a target! Prepare the batch.
-        std::vector<std::vector<uint8_t>> batchToSend;
-
-        // Mark the neighbor as "busy" for this transaction
-        neighborTable[bestHop].isVisited = true;
-
-        for (auto& packet : packetQueue) {
-            // Update the routing info
-            packet.header.nextHopId = bestHop;
-
-            // Mark as visited so we don't loop back immediately
-            packet.header.flagsAndTTL.visited = 1;
-
-            // Serialize and add to batch
-            batchToSend.push_back(Serialize(packet));
-        }
+    void THOR::GetMetrics(THORMetricsSnapshot& outSnapshot) const
+    {
+        metrics.Read(outSnapshot);
+        outSnapshot.neighbors = neighborTable.Size();
+        outSnapshot.queued = packetQueue.Size();
+    }
 
-        // 5. Clear the internal queue since we are handing them off to the wrapper
-        packetQueue.clear();
+    size_t THOR::SnapshotMetrics(uint8_t* out, size_t outSize) const
+    {
+        THORMetricsSnapshot snapshot;
+        GetMetrics(snapshot);
+        return EncodeMetrics(snapshot, out, outSize);
+    }
 
-        return batchToSend;
+    void THOR::ResetMetrics()
+    {
+        metrics.Reset();
     }
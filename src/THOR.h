@@ -3,19 +3,42 @@
 #ifndef THOR_H
 #define THOR_H
 #include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <iostream>
-#include <map>
 #include <ctime>
+#include <functional>
+#include <string>
+#include "NeighborTable.h"
+#include "DuplicateCache.h"
+#include "PacketQueue.h"
+#include "THORMetrics.h"
+#include "Trace.h"
+#include "BeaconScheduler.h"
+#include "EnergyModel.h"
+#include "Reassembly.h"
+#include "RouteCache.h"
+#include "ControlFrame.h"
 
 const uint32_t BROADCAST_ID = 0xFFFFFFFF;
 
 #pragma pack(push, 1)
 
+// Outcome of HandleData for a single frame (reported by HandleDataBatch)
+enum class THORVerdict : uint8_t {
+    DELIVER = 1, // We are the destination
+    FORWARD = 2, // Frame rewritten for the next hop
+    QUEUE   = 3, // No route, stored for later
+    DROP    = 4, // Malformed, TTL expired or queue full
+    PARTIAL = 5  // Fragment for us, kept until the rest of the message arrives
+};
+
 enum class THORPacketType : uint8_t {
-    HELLO = 1,
-    ACK   = 2,
-    DATA  = 3
+    HELLO   = 1,
+    ACK     = 2,
+    DATA    = 3,
+    CONTROL = 4, // HELLO + aggregated ACKs + neighbor summary, see CreateControl
+    FRAGMENT = 5 // Piece of a DATA payload (FragmentHeader first), routed like DATA
 };
 
 struct flags{
@@ -25,6 +48,8 @@ struct flags{
     unsigned char myInternet : 1;//
 };
 
+// In-memory form. Frames are read and written through WireCodec.h, which fixes the
+// byte order and the flag bit positions regardless of the compiler.
 struct Header {
     THORPacketType type;   // 1 byte
 
@@ -41,36 +66,364 @@ struct Packet {
     Header header;
     std::vector<uint8_t> payload;
 };
-struct NeighborInfo {
-    time_t lastSeen;          // To expire old neighbors
-    int    rssi;              // Signal strength
-    bool hasInternetDirect;   // Priority 1 (Bit 7 of Header)
-    bool hasInternetIndirect; // Priority 2 (Bit 5 of Header)
-    bool isVisited;           // Priority 3 (Bit 6 of Header) - Avoid if true
+
+// Non-owning view of a frame sitting in a caller buffer (e.g. the BLE RX buffer).
+// The header is decoded into this struct, the payload stays where it is.
+struct PacketView {
+    Header header;
+    const uint8_t* payload;   // Points into the source buffer, valid as long as it is
+    size_t payloadSize;
 };
 static_assert(sizeof(Header) == 22, "Error: Header size must be exactly 22 bytes for BLE!");
 
+// Non-owning view of a whole serialized frame (header + payload)
+struct FrameView {
+    const uint8_t* data;
+    size_t size;
+};
+
+// Receives each frame ready for the radio, with the neighbor it is routed to. The frame
+// is only valid during the call. Return false if the radio cannot take it right now.
+typedef std::function<bool(const FrameView& frame, uint32_t nextHopId)> TransmitSink;
+
+// How DrainQueue splits a drain across several next hops
+enum class SpreadWeight : uint8_t {
+    SCORE      = 1, // Proportional to the GetBestNextHop score
+    THROUGHPUT = 2  // Proportional to recent bytes accepted per drain on that link
+};
+
+// Construction-time settings. Defaults match the original fixed limits.
+struct THORConfig {
+    // Store-and-forward queue (PacketQueue.h)
+    size_t queueCapacity = 50;                    // Slots
+    size_t queueBytes = 0;                        // Byte budget for queued frames, 0 = slots only
+    size_t maxPayload = 512;                      // Largest queued payload (max BLE attribute value)
+    QueueOrder queueOrder = QueueOrder::ARRIVAL;  // Drain order
+    QueueEviction queueEviction = QueueEviction::DROP_OLDEST; // Keep the newest distress messages
+    uint64_t queueLifetimeMs = 0;                 // Queued packets older than this are dropped, 0 = kept until sent or evicted
+    std::string queueFile;                        // Memory-mapped queue file, frames survive a restart. Empty = RAM only
+
+    // Neighbors and routing (NeighborTable.h, RouteCache.h)
+    uint64_t neighborTimeoutMs = 30000;           // Neighbors not heard from for longer are dropped by RemoveOld
+    uint64_t linkDecayMs = 60000;                 // Half-life of learned link quality (LinkStats), 0 = never forget
+    size_t routeCacheSize = 32;                   // Destinations with a route learned from relayed ACKs, 0 = gravity only
+    uint64_t routeTimeoutMs = 30000;              // Routes not refreshed by an ACK for longer are ignored
+    size_t spreadNeighbors = 1;                   // Queue drains are split across this many top neighbors
+    SpreadWeight spreadWeight = SpreadWeight::SCORE; // How a drain is split between them
+
+    // Beacons (BeaconScheduler.h)
+    BeaconConfig beacon;                          // Adaptive HELLO timing, see NextHelloAt
+    bool advertiseLoad = true;                    // Append LoadAdvert to HELLO / ACK / CONTROL when the buffer has room (+2 bytes)
+
+    // Frames on the air (CompactHeader.h, Reassembly.h)
+    bool compactHeaders = false;                  // Send the variable-length header when it is shorter. Both encodings
+                                                  // are always accepted; leave off while old nodes are around
+    size_t fragmentSize = 0;                      // Largest DATA frame on the air, header included. Longer messages leave
+                                                  // the queue as FRAGMENT frames. 0 = never split
+    size_t reassemblySlots = 4;                   // Messages reassembled at once (destination only), maxPayload bytes each
+    uint64_t reassemblyTimeoutMs = 30000;         // Incomplete messages are dropped after this
+
+    // Duplicate suppression (DuplicateCache.h)
+    size_t duplicateCapacity = DUPLICATE_CACHE_SIZE;   // (originId, sequence) pairs remembered, own sends included
+    uint64_t duplicateMaxAgeMs = DUPLICATE_MAX_AGE_MS; // Before a pair may be accepted again
+
+    // Energy (EnergyModel.h)
+    EnergyConfig energy;                          // Radio cost model and budgeted forwarding, see SetEnergyBudget
+
+    // Time and tracing (Trace.h)
+    std::function<uint64_t()> clock;              // Monotonic milliseconds. Empty = std::chrono::steady_clock
+    size_t traceBytes = 0;                        // I/O trace ring, 0 = tracing off
+    std::string traceFile;                        // The ring is written here whenever it fills. Empty = keep the newest in RAM
+};
+
 class THOR
 {
 public: 
+    THOR();
+    explicit THOR(const THORConfig& config);
+
+    // Time source for neighbor aging and duplicate expiry (monotonic ms).
+    // Simulations and tests inject a virtual clock here.
+    void SetClock(std::function<uint64_t()> clock);
+    // Inside a traced call, the time the trace records for it
+    uint64_t Now() const { return tracer.InCall() ? tracer.CallMs() : clock(); }
+
     std::vector<uint8_t> Serialize(const Packet& packet);
     bool Deserialize(const std::vector<uint8_t>& data, Packet& outPacket);
     bool DeserializeHeader(const std::vector<uint8_t>& data, Header& outheader);
     std::vector<uint8_t> SerializeHeader(const Header& header);
+    // HELLO and ACK frames are 24 bytes here: the header plus LoadAdvert (22 with advertiseLoad off).
+    // The pointer overloads below leave the trailer out of a header-sized buffer.
     std::vector<uint8_t> CreateHello(uint32_t DestId ,uint32_t SenderId, uint32_t OriginId, uint32_t Sequence);
     std::vector<uint8_t> CreateACK(uint32_t DestId, uint32_t SenderId,uint32_t OriginId,uint32_t NextHopId,uint32_t Sequence, bool myinternet, bool intneighbour);
     bool HandleHello(const std::vector<uint8_t>& data, Header& outheader);
     bool HandleAck(const std::vector<uint8_t>& data, Header& outheader);
+    std::vector<uint8_t> CreateControl(uint32_t SenderId, uint32_t Sequence, bool myinternet, bool intneighbour);
     std::vector<uint8_t> SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const std::vector<uint8_t>& payload);
+    // outPacket gets the decoded frame; its payload is cleared if the frame is malformed
     std::vector<uint8_t> HandleData(const std::vector<uint8_t>& data, Packet& outPacket, uint32_t MyNodeId); 
     void NeighborStore(uint32_t nodeId, int rssi, bool hasInternetDirect, bool hasInternetIndirect, bool isVisited);
     void RemoveOld();
     uint32_t GetBestNextHop();
+    // Next hop for one destination: the destination itself when it is a neighbor, then a
+    // route learned from its ACKs (HandleAck), then GetBestNextHop(). SendPacket, HandleData
+    // and the queue drain route through this.
+    uint32_t GetBestNextHop(uint32_t destinationId);
+    const RouteStats& GetRouteStats() const { return routeCache.Stats(); }
+    // Learned link quality (see NeighborTable.h). Sends, radio commits and ACKs feed it on
+    // their own; this reports an outcome learned elsewhere, such as an end-to-end ACK.
+    void RecordDelivery(uint32_t nodeId, bool delivered);
+    bool GetNeighbor(uint32_t nodeId, NeighborInfo& outInfo) const { return neighborTable.Get(nodeId, outInfo); }
+    // Read-only view of the table, e.g. to copy the best rows out (ConcurrentTHOR::Publish)
+    const NeighborTable& GetNeighborTable() const { return neighborTable; }
+
+    // Scoring used by GetBestNextHop and queue spreading (DefaultRoutingPolicy unless changed).
+    // Compile-time policy: a specialized scorer with every constant inlined.
+    // Switching rescores the whole table on the vectorized kernel.
+    template <typename Policy>
+    void SetRoutingPolicy() { neighborTable.SetPolicyScorer(&StaticPolicyScorer<Policy>, MakeRoutingPolicy<Policy>()); }
+    // Runtime policy, for experiments and field tuning.
+    void SetRoutingPolicy(const RoutingPolicy& policy) { neighborTable.SetPolicyScorer(&RuntimePolicyScorer, policy); }
     std::vector<std::vector<uint8_t>> ProcessQueue(); //Android Wrapper Endpoint Function
-    
+
+    // Zero-copy variants: frames are written into / read from caller buffers.
+    // Writers return the number of bytes written, 0 if nothing was written.
+    size_t Serialize(const Header& header, const uint8_t* payload, size_t payloadSize, uint8_t* out, size_t outSize);
+    size_t Serialize(const Packet& packet, uint8_t* out, size_t outSize);
+    size_t SerializeHeader(const Header& header, uint8_t* out, size_t outSize);
+    bool Deserialize(const uint8_t* data, size_t size, PacketView& outView);
+    bool DeserializeHeader(const uint8_t* data, size_t size, Header& outheader);
+    size_t CreateHello(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, uint8_t* out, size_t outSize);
+    size_t CreateACK(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t NextHopId, uint32_t Sequence, bool myinternet, bool intneighbour, uint8_t* out, size_t outSize);
+    bool HandleHello(const uint8_t* data, size_t size, Header& outheader);
+    // Accepts ACK and CONTROL frames. For CONTROL, outheader carries the sender's flags
+    // exactly like an ACK, so existing NeighborStore code works unchanged.
+    bool HandleAck(const uint8_t* data, size_t size, Header& outheader);
+    // Same, and decodes the control body (ackCount 0 for a plain ACK)
+    bool HandleAck(const uint8_t* data, size_t size, Header& outheader, ControlView& outControl);
+    // Broadcast control frame: announces this node (like a HELLO, it counts as a beacon),
+    // acknowledges the HELLOs queued by HandleHello (as many as fit, the rest stay pending)
+    // and summarizes the neighbor table in a 64-bit bitmap.
+    size_t CreateControl(uint32_t SenderId, uint32_t Sequence, bool myinternet, bool intneighbour, uint8_t* out, size_t outSize);
+    // HandleHello queues an ACK entry per HELLO (latest sequence per origin, CONTROL_MAX_ACKS at most)
+    void QueueAck(uint32_t originId, uint32_t sequence);
+    size_t PendingAcks() const { return pendingAcks.size(); }
+    // What this node advertises: its queue occupancy, and its free slots shared out over its
+    // neighbors as credits. A neighbor that used up its credits is skipped by routing until
+    // the next advertisement, so a full relay stops attracting traffic it would drop.
+    LoadAdvert GetLoad() const;
+    // A payload that does not fit one fragmentSize frame is queued whole (0 is returned) and
+    // leaves through DrainQueue / ProcessQueue as FRAGMENT frames, all on one link. A message
+    // larger than the drain budget resumes at the first fragment the radio did not take.
+    // Relays forward fragments without reassembling and keep each message on its first hop.
+    size_t SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize, uint8_t* out, size_t outSize);
+    // Same, with queue settings for this packet: its own lifetime, and a supersede class that
+    // drops queued packets of the same origin and class (whether this one is queued or sent).
+    // Relays queue what they forward with queueLifetimeMs; neither setting travels with the frame.
+    size_t SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                      const QueueOptions& options, uint8_t* out, size_t outSize);
+    // 'out' may alias 'data' to rewrite the frame in place. outView points into 'data', or into
+    // 'out' once the frame was forwarded (the header may change size when it is re-encoded).
+    size_t HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize);
+    // Same, and reports what happened to the frame (e.g. DELIVER vs. QUEUE, both write nothing).
+    // The last missing FRAGMENT of a message addressed to us is DELIVERed as the whole DATA
+    // message, outView pointing into the reassembly pool until the next HandleData.
+    size_t HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize, THORVerdict& outVerdict);
+
+    // Same decisions as calling HandleData once per frame, in one call.
+    // Returns the frames to forward, in input order.
+    std::vector<std::vector<uint8_t>> HandleDataBatch(const std::vector<std::vector<uint8_t>>& frames, std::vector<Packet>& outPackets, std::vector<THORVerdict>& outVerdicts, uint32_t MyNodeId);
+
+    // Zero-copy queue flush: views point into the queue's slab and stay valid until
+    // the next call that can enqueue (SendPacket, HandleData, HandleDataBatch).
+    // Re-encoded frames (compactHeaders, fragments) point into a drain buffer, valid until the next drain.
+    size_t ProcessQueue(std::vector<FrameView>& outFrames);
+
+    // Budgeted drain: hands out at most maxFrames frames / maxBytes bytes (0 = no limit)
+    // from the head of the queue, routed to the current best hop. They stay queued
+    // until CommitQueue reports how many the radio accepted; the rest are sent again
+    // by the next drain. A new DrainQueue call returns uncommitted frames first.
+    // A fragmented message takes several frames and leaves the queue once all are accepted.
+    size_t DrainQueue(size_t maxFrames, size_t maxBytes, std::vector<FrameView>& outFrames);
+    void CommitQueue(size_t accepted);
+    // Per-frame commit, for drains spread over several links (accepted[i] -> outFrames[i])
+    void CommitQueue(const std::vector<bool>& accepted);
+
+    // Push model, instead of polling ProcessQueue: with a sink set, NeighborStore, HandleAck
+    // and RemoveOld flush whatever became routable straight into it (at most maxFrames /
+    // maxBytes per flush, 0 = no limit). Frames it refuses stay queued for the next flush.
+    // The sink must not call back into this THOR. Nothing is flushed while frames from a
+    // DrainQueue are still waiting for their CommitQueue.
+    void SetTransmitSink(TransmitSink sink, size_t maxFrames = 0, size_t maxBytes = 0);
+    // One flush now, e.g. from the wrapper's radio-ready callback or a retry timer.
+    // Returns the frames the sink took.
+    size_t Flush();
+    // Sink variants of SendPacket / HandleData: a routed frame goes to the sink (FORWARD),
+    // anything else is queued (QUEUE) or dropped. Without a sink every frame is queued.
+    // A forwarded outView points into a scratch frame, valid until the next call.
+    THORVerdict SendPacket(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                           const QueueOptions& options = QueueOptions());
+    THORVerdict HandleData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId);
+
+    // Store-and-forward queue
+    void SetOriginPriority(uint32_t originId, uint8_t priority); // Used by QueueOrder::ORIGIN_PRIORITY
+    size_t QueueSize() const { return packetQueue.Size(); }
+    size_t NeighborCount() const { return neighborTable.Size(); }
+    const QueueStats& GetQueueStats() const { return packetQueue.Stats(); }
+    const ReassemblyStats& GetReassemblyStats() const { return reassembly.Stats(); }
+    // False if queueFile is empty or could not be mapped (the queue then lives in RAM)
+    bool QueuePersistent() const { return packetQueue.Persistent(); }
+    // Asks the OS to write the queue file back now, without waiting for it
+    void SyncQueue() { packetQueue.Sync(); }
+    // I/O trace for TraceReplay.h (THORConfig::traceBytes)
+    void FlushTrace() { tracer.Flush(); }
+    void SnapshotTrace(std::vector<uint8_t>& out) const { tracer.Snapshot(out); }
+    const TraceRecorder& GetTracer() const { return tracer; }
+
+    // Energy accounting (EnergyModel.h): every frame THOR builds or handles is costed by its
+    // size, unicast frames with the retransmissions their link's RSSI predicts, and spent from
+    // the budget the wrapper sets here from its battery gauge. With EnergyConfig::budgeted,
+    // GetBestNextHop and the queue drain weigh each hop's cost against how much battery is
+    // gone, and on a low battery relayed and queued frames only go toward the internet or
+    // straight to their destination; the rest waits in the queue. Own SendPackets always go.
+    void SetEnergyBudget(uint64_t remainingNj, uint64_t fullNj);
+    uint64_t EnergyRemaining() const { return energy.Remaining(); } // 0 without a budget
+    const EnergyStats& GetEnergyStats() const { return energy.Stats(); }
+    // Expected cost of one frame of this size to a neighbor, retransmissions included (0 if unknown)
+    uint64_t EstimateTxNj(size_t frameSize, uint32_t nextHopId) const;
+
+    // Adaptive HELLO beaconing: when to call CreateHello next (monotonic ms, <= Now() = now).
+    // Backs off while the neighborhood is stable, speeds up on neighbor churn and when
+    // DATA is queued with no route. Every CreateHello counts as a beacon sent.
+    uint64_t NextHelloAt() const;
+    bool HelloDue() const { return NextHelloAt() <= Now(); }
+    uint64_t HelloIntervalMs() const { return beaconScheduler.Interval(); }
+
+    // Duplicate suppression counters (DATA frames dropped as repeats / accepted as new)
+    uint64_t DuplicateHits() const { return duplicateCache.Hits(); }
+    uint64_t DuplicateMisses() const { return duplicateCache.Misses(); }
+
+    // Counters and GetBestNextHop latency (all zero unless built with -DTHOR_ENABLE_METRICS)
+    void GetMetrics(THORMetricsSnapshot& outSnapshot) const;
+    // Compact binary form for upload, see EncodeMetrics. METRICS_SNAPSHOT_MAX bytes always fit.
+    size_t SnapshotMetrics(uint8_t* out, size_t outSize) const;
+    void ResetMetrics();
+
 private:
-    std::map<uint32_t, NeighborInfo> neighborTable;
-    std::vector<Packet> packetQueue;
+    // Also spends 'frames' of the neighbor's credits. Returns its row, -1 if unknown
+    long MarkVisited(uint32_t nodeId, size_t frames);
+    void SpendRoute(size_t written); // The frame SendData / ReceiveData wrote left: mark its hop, count its energy
+    int RowRssi(long row) const { return row >= 0 ? neighborTable.Rssi()[row] : 0; }
+    // Budgeted: score less the expected retransmissions, weighed by how much battery is gone
+    int64_t EnergyValue(uint32_t row) const;
+    void RankByEnergy(std::vector<uint32_t>& rows, size_t keep);
+    uint32_t EnergyHop();
+    // Budgeted, low battery: whether a relayed frame may still go to this hop
+    bool WorthRelaying(uint32_t hop, uint32_t destinationId) const;
+    // Writes LoadAdvert at 'out' if enabled and it fits, returns the bytes written
+    size_t AppendLoad(uint8_t* out, size_t outSize);
+    // LoadAdvert trailing a frame from nodeId, if there is one
+    void ReadLoad(uint32_t nodeId, const uint8_t* trailer, size_t size);
+    bool BeaconUrgent() const;
+    bool Usable(uint32_t nodeId) const;
+    uint32_t DestinationHop(uint32_t destinationId);
+    uint32_t NextHop(uint32_t destinationId);  // GetBestNextHop(destinationId) without tracing it
+    THORVerdict CheckData(PacketView& view, uint32_t MyNodeId);
+    size_t SendData(uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload, size_t payloadSize,
+                    const QueueOptions& options, uint8_t* out, size_t outSize, THORVerdict& outVerdict);
+    THORVerdict Transmit(size_t size, const QueueOptions& options);  // Hands sinkFrame to the sink, queues it if refused
+    size_t ReceiveData(const uint8_t* data, size_t size, PacketView& outView, uint32_t MyNodeId, uint8_t* out, size_t outSize, THORVerdict& outVerdict);
+    void CountVerdict(THORVerdict verdict);
+    bool NeedsRoute() const;
+    bool Enqueue(const Header& header, const uint8_t* payload, size_t payloadSize, const QueueOptions& options = QueueOptions());
+    // Header encoding: legacy 22 bytes, or compact when enabled and shorter
+    size_t WireHeaderSize(const Header& header) const;
+    void WriteHeader(const Header& header, uint8_t* out, size_t headerSize) const;
+    // Decodes either encoding, returns the header length (0 = malformed)
+    size_t ReadHeader(const uint8_t* data, size_t size, Header& outheader) const;
+    // Payload bytes per FRAGMENT of this message, 0 if it goes out whole
+    size_t FragmentPayload(const Header& header, size_t payloadSize) const;
+    // On-air bytes / frames of fragments [first, first + count) (the whole frame if perFragment is 0)
+    size_t WireBytes(const Header& header, size_t payloadSize, size_t perFragment, size_t first, size_t count) const;
+    void EmitFrames(const Header& header, uint8_t* frame, size_t payloadSize, size_t perFragment, size_t first, size_t count,
+                    std::vector<FrameView>& outFrames);
+    // Drain link for a destination with its own hop (appended to spreadHops if needed), -1 = spread
+    long DestinationLink(uint32_t destinationId);
+    size_t NextSpreadLink(size_t hopCount);
+    void UndoSpreadLink(size_t link, size_t hopCount);
+    void AdvanceFragments(size_t entry, size_t acceptedFrames);
+    uint32_t RouteFragment(const Header& header);
+    THORVerdict Reassemble(PacketView& view);
+    size_t SelectSpreadHops();
+    void RecordLinkThroughput(const std::vector<bool>* accepted, size_t acceptedPrefix);
+    void ClearDrain(); // Forget the links and entries of the last drain (txFrames stays valid until the next one)
+    void TraceSend(bool sink, uint32_t DestId, uint32_t SenderId, uint32_t OriginId, uint32_t Sequence, const uint8_t* payload,
+                   size_t payloadSize, const QueueOptions& options, size_t outSize);
+    void TraceData(bool sink, const uint8_t* data, size_t size, uint32_t MyNodeId, size_t outSize);
+
+    std::function<uint64_t()> clock;
+    NeighborTable neighborTable;
+    DuplicateCache duplicateCache;
+    PacketQueue packetQueue;
+    THORMetrics metrics;
+    BeaconScheduler beaconScheduler;
+
+    // Load spreading state for the current drain (reserved at construction)
+    size_t spreadNeighbors;
+    SpreadWeight spreadWeight;
+    std::vector<uint32_t> spreadHops;     // Next hops of this drain, best first
+    std::vector<int64_t> spreadWeights;
+    std::vector<int64_t> spreadCurrent;   // Smooth weighted round-robin state
+    std::vector<uint32_t> inFlightLinks;  // Index into spreadHops per handed-out frame
+    std::vector<int8_t> linkOutcomes;     // Per spread link at commit: 1 took all, 0 refused some, -1 unused
+    std::vector<uint32_t> spreadCredits;  // Per spread link: frames it may still take in this drain
+    std::vector<uint32_t> linkFrames;     // Per spread link at commit: frames accepted
+    std::vector<int8_t> spreadRssi;       // Per spread link, for the energy of what it takes
+    std::vector<uint32_t> scratchRows;
+
+    std::vector<ControlAck> pendingAcks;  // For the next CreateControl
+
+    bool advertiseLoad;
+    size_t queueCapacity;
+    uint8_t advertisedCredits;            // In the last beacon we sent
+    struct HeardLoad {
+        uint32_t nodeId;                  // 0 = none
+        LoadAdvert advert;
+    };
+    HeardLoad heardLoad;                  // From a node not in the table yet, kept for its NeighborStore
+
+    bool compactHeaders;
+    size_t fragmentSize;
+    // DrainQueue output that is not a slab frame (compact headers, fragments)
+    std::vector<uint8_t> txFrames;
+    std::vector<size_t> txOffsets;        // Per handed-out frame: offset in txFrames, or NO_TX_OFFSET
+    std::vector<uint32_t> entryFrames;    // Per in-flight queue entry: frames handed out
+    std::vector<bool> entryAccepted;      // CommitQueue scratch
+    bool headPartial;                     // The head entry's last fragments wait for a later drain
+
+    // Relays keep the fragments of a message on the hop the first one took
+    struct FragmentRoute {
+        uint32_t originId;
+        uint32_t sequence;
+        uint32_t nextHopId;
+    };
+    std::vector<FragmentRoute> fragmentRoutes; // Ring
+    size_t nextFragmentRoute;
+    ReassemblyPool reassembly;
+    RouteCache routeCache;
+
+    TransmitSink transmitSink;
+    size_t sinkMaxFrames;
+    size_t sinkMaxBytes;
+    std::vector<uint8_t> sinkFrame;       // Frame routed by the sink variants of SendPacket / HandleData
+    std::vector<FrameView> sinkFrames;    // Flush's drain
+    std::vector<bool> sinkAccepted;
+
+    EnergyModel energy;
+    uint32_t routedHop;                   // Next hop of the frame SendData / ReceiveData just wrote
+    std::vector<uint32_t> energyRows;     // EnergyHop candidates
+
+    TraceRecorder tracer;
 };
 
 #endif /* THOR_H */
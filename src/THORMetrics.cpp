@@ -0,0 +1,134 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "THORMetrics.h"
+#include <cstring>
+
+namespace {
+    const uint8_t METRICS_VERSION = 2; // 2: CONTROL packet type added
+
+    // Snapshot values in wire order
+    template <typename Snapshot, typename Fn>
+    void ForEachValue(Snapshot& snapshot, Fn fn)
+    {
+        for (size_t e = 0; e < METRIC_EVENTS; ++e) {
+            for (size_t t = 0; t < METRIC_PACKET_TYPES; ++t) {
+                fn(snapshot.packets[e][t]);
+            }
+        }
+        for (size_t c = 0; c < METRIC_COUNTERS; ++c) fn(snapshot.counters[c]);
+        for (size_t b = 0; b < METRIC_LATENCY_BUCKETS; ++b) fn(snapshot.bestHopLatency[b]);
+        fn(snapshot.neighbors);
+        fn(snapshot.queued);
+    }
+}
+
+    void THORMetrics::Read(THORMetricsSnapshot& outSnapshot) const
+    {
+        std::memset(&outSnapshot, 0, sizeof(outSnapshot));
+#ifdef THOR_ENABLE_METRICS
+        outSnapshot.enabled = true;
+        for (size_t e = 0; e < METRIC_EVENTS; ++e) {
+            for (size_t t = 0; t < METRIC_PACKET_TYPES; ++t) {
+                outSnapshot.packets[e][t] = packets[e][t].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < METRIC_COUNTERS; ++c) {
+            outSnapshot.counters[c] = counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t b = 0; b < METRIC_LATENCY_BUCKETS; ++b) {
+            outSnapshot.bestHopLatency[b] = bestHopLatency[b].load(std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    void THORMetrics::Reset()
+    {
+#ifdef THOR_ENABLE_METRICS
+        for (size_t e = 0; e < METRIC_EVENTS; ++e) {
+            for (size_t t = 0; t < METRIC_PACKET_TYPES; ++t) {
+                packets[e][t].store(0, std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < METRIC_COUNTERS; ++c) {
+            counters[c].store(0, std::memory_order_relaxed);
+        }
+        for (size_t b = 0; b < METRIC_LATENCY_BUCKETS; ++b) {
+            bestHopLatency[b].store(0, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+#ifdef THOR_ENABLE_METRICS
+    void THORMetrics::Take(const THORMetrics& other)
+    {
+        for (size_t e = 0; e < METRIC_EVENTS; ++e) {
+            for (size_t t = 0; t < METRIC_PACKET_TYPES; ++t) {
+                packets[e][t].store(other.packets[e][t].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < METRIC_COUNTERS; ++c) {
+            counters[c].store(other.counters[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        for (size_t b = 0; b < METRIC_LATENCY_BUCKETS; ++b) {
+            bestHopLatency[b].store(other.bestHopLatency[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+#endif
+
+    size_t EncodeMetrics(const THORMetricsSnapshot& snapshot, uint8_t* out, size_t outSize)
+    {
+        if (out == nullptr || outSize < 4) {
+            return 0;
+        }
+        out[0] = 'T';
+        out[1] = 'M';
+        out[2] = METRICS_VERSION;
+        out[3] = snapshot.enabled ? 1 : 0;
+        size_t pos = 4;
+        bool fits = true;
+
+        ForEachValue(snapshot, [&](const uint64_t& value) {
+            uint64_t v = value;
+            do {
+                if (pos >= outSize) {
+                    fits = false;
+                    return;
+                }
+                uint8_t byte = static_cast<uint8_t>(v & 0x7F);
+                v >>= 7;
+                out[pos++] = byte | (v ? 0x80 : 0);
+            } while (v);
+        });
+        return fits ? pos : 0;
+    }
+
+    bool DecodeMetrics(const uint8_t* data, size_t size, THORMetricsSnapshot& outSnapshot)
+    {
+        if (data == nullptr || size < 4 || data[0] != 'T' || data[1] != 'M' || data[2] != METRICS_VERSION) {
+            return false;
+        }
+        std::memset(&outSnapshot, 0, sizeof(outSnapshot));
+        outSnapshot.enabled = (data[3] & 1) != 0;
+        size_t pos = 4;
+        bool ok = true;
+
+        ForEachValue(outSnapshot, [&](uint64_t& value) {
+            uint64_t v = 0;
+            unsigned shift = 0;
+            while (ok) {
+                if (pos >= size || shift > 63) {
+                    ok = false;
+                    break;
+                }
+                uint8_t byte = data[pos++];
+                v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                shift += 7;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+            value = v;
+        });
+        return ok;
+    }
@@ -0,0 +1,113 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef THOR_METRICS_H
+#define THOR_METRICS_H
+#include <cstdint>
+#include <cstddef>
+
+// Counters are compiled in only with -DTHOR_ENABLE_METRICS. Without it every
+// THOR_METRIC(...) statement disappears and THORMetrics is an empty class.
+#ifdef THOR_ENABLE_METRICS
+#include <atomic>
+#define THOR_METRIC(statement) statement
+#else
+#define THOR_METRIC(statement) do { } while (0)
+#endif
+
+// What happened to a packet, counted per packet type (HELLO, ACK, DATA, CONTROL)
+enum class MetricEvent : uint8_t {
+    RECEIVED  = 0, // Handed to HandleHello / HandleAck / HandleData
+    SENT      = 1, // Originated here (CreateHello, CreateACK, CreateControl, SendPacket routed at once)
+    FORWARDED = 2, // DATA sent on to a next hop, directly or committed from the queue
+    DELIVERED = 3, // DATA addressed to this node
+    QUEUED    = 4, // DATA stored for later
+    DROPPED   = 5  // Malformed, repeat, TTL expired or queue full
+};
+const size_t METRIC_EVENTS = 6;
+const size_t METRIC_PACKET_TYPES = 4;
+
+enum class MetricCounter : uint8_t {
+    TTL_EXPIRED      = 0, // DATA dropped in HandleData with ttl <= 1
+    QUEUE_FULL       = 1, // Packets lost to a full queue (rejected or evicted)
+    DUPLICATE        = 2, // DATA dropped by duplicate suppression
+    BEST_HOP_CALLS   = 3, // GetBestNextHop invocations
+    NEIGHBOR_EXPIRED = 4  // Neighbors removed by RemoveOld
+};
+const size_t METRIC_COUNTERS = 5;
+const size_t METRIC_LATENCY_BUCKETS = 16; // Bucket b counts calls taking [2^b, 2^(b+1)) ns
+const uint64_t METRIC_LATENCY_SAMPLING = 64; // One GetBestNextHop call in this many is timed
+
+// Plain copy of all metrics, plus gauges sampled when it was taken
+struct THORMetricsSnapshot {
+    bool enabled;                                               // Built with THOR_ENABLE_METRICS
+    uint64_t packets[METRIC_EVENTS][METRIC_PACKET_TYPES];       // [event][type - 1]
+    uint64_t counters[METRIC_COUNTERS];
+    uint64_t bestHopLatency[METRIC_LATENCY_BUCKETS];            // Sampled calls only
+    uint64_t neighbors;                                         // Neighbor table size
+    uint64_t queued;                                            // Store-and-forward queue size
+};
+
+// Compact wire form for upload: "TM", version, flags (bit 0 = enabled), then every
+// value of the snapshot as an unsigned LEB128 varint in declaration order.
+// Returns the bytes written, 0 if the buffer is too small (METRICS_SNAPSHOT_MAX always fits).
+const size_t METRICS_SNAPSHOT_MAX = 4 + 10 * (METRIC_EVENTS * METRIC_PACKET_TYPES + METRIC_COUNTERS + METRIC_LATENCY_BUCKETS + 2);
+size_t EncodeMetrics(const THORMetricsSnapshot& snapshot, uint8_t* out, size_t outSize);
+bool DecodeMetrics(const uint8_t* data, size_t size, THORMetricsSnapshot& outSnapshot);
+
+// Relaxed atomic counters: increments never order anything, and a reader on
+// another thread (e.g. the uploader) sees each value torn-free.
+class THORMetrics
+{
+public:
+#ifdef THOR_ENABLE_METRICS
+    THORMetrics() { Reset(); }
+    // Moving a node carries its counts along (the atomics themselves cannot move)
+    THORMetrics(THORMetrics&& other) noexcept { Take(other); }
+    THORMetrics& operator=(THORMetrics&& other) noexcept
+    {
+        Take(other);
+        return *this;
+    }
+
+    void Count(MetricEvent event, uint8_t packetType, uint64_t amount = 1)
+    {
+        if (packetType >= 1 && packetType <= METRIC_PACKET_TYPES) {
+            packets[static_cast<size_t>(event)][packetType - 1].fetch_add(amount, std::memory_order_relaxed);
+        }
+    }
+    void Count(MetricCounter counter, uint64_t amount = 1)
+    {
+        counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+    // Counts a GetBestNextHop call. True for one call in METRIC_LATENCY_SAMPLING, the ones to time
+    // (reading the clock costs more than the lookup itself).
+    bool CountBestHopCall()
+    {
+        uint64_t calls = counters[static_cast<size_t>(MetricCounter::BEST_HOP_CALLS)].fetch_add(1, std::memory_order_relaxed);
+        return calls % METRIC_LATENCY_SAMPLING == 0;
+    }
+    void RecordBestHopLatency(uint64_t ns)
+    {
+        size_t bucket = 0;
+        while (ns > 1 && bucket + 1 < METRIC_LATENCY_BUCKETS) {
+            ns >>= 1;
+            ++bucket;
+        }
+        bestHopLatency[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+    // Copies the counters (all zero when compiled out). Gauges are left to the caller.
+    void Read(THORMetricsSnapshot& outSnapshot) const;
+    void Reset();
+
+private:
+#ifdef THOR_ENABLE_METRICS
+    void Take(const THORMetrics& other);
+
+    std::atomic<uint64_t> packets[METRIC_EVENTS][METRIC_PACKET_TYPES];
+    std::atomic<uint64_t> counters[METRIC_COUNTERS];
+    std::atomic<uint64_t> bestHopLatency[METRIC_LATENCY_BUCKETS];
+#endif
+};
+
+#endif /* THOR_METRICS_H */
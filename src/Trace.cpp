@@ -0,0 +1,276 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "Trace.h"
+#include "WireCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+    const uint8_t TRACE_MAGIC[4] = { 'T', 'H', 'T', '1' };
+    const uint16_t TRACE_VERSION = 1;
+
+    void FileHeader(uint8_t* out)
+    {
+        std::memcpy(out, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        StoreLE16(out + 4, TRACE_VERSION);
+    }
+}
+
+    TraceRecorder::TraceRecorder(size_t capacity, const std::string& path)
+        : enabled(capacity != 0), ring(capacity), head(0), used(0), record(capacity != 0 ? TRACE_RECORD_HEADER + 512 : 0), recordSize(0),
+          file(nullptr), depth(0), callMs(0), records(0), dropped(0)
+    {
+        if (capacity != 0 && !path.empty()) {
+            file = std::fopen(path.c_str(), "wb");
+        }
+    }
+
+    TraceRecorder::~TraceRecorder()
+    {
+        Close();
+    }
+
+    TraceRecorder::TraceRecorder(TraceRecorder&& other) noexcept
+        : enabled(other.enabled), ring(std::move(other.ring)), head(other.head), used(other.used),
+          record(std::move(other.record)), recordSize(other.recordSize), config(std::move(other.config)),
+          file(other.file), depth(other.depth), callMs(other.callMs), records(other.records), dropped(other.dropped)
+    {
+        other.enabled = false;
+        other.file = nullptr;
+        other.head = 0;
+        other.used = 0;
+        other.recordSize = 0;
+        other.depth = 0;
+    }
+
+    TraceRecorder& TraceRecorder::operator=(TraceRecorder&& other) noexcept
+    {
+        if (this != &other) {
+            Close();
+            enabled = other.enabled;
+            ring = std::move(other.ring);
+            head = other.head;
+            used = other.used;
+            record = std::move(other.record);
+            recordSize = other.recordSize;
+            config = std::move(other.config);
+            file = other.file;
+            depth = other.depth;
+            callMs = other.callMs;
+            records = other.records;
+            dropped = other.dropped;
+            other.enabled = false;
+            other.file = nullptr;
+            other.head = 0;
+            other.used = 0;
+            other.recordSize = 0;
+            other.depth = 0;
+        }
+        return *this;
+    }
+
+    void TraceRecorder::Close()
+    {
+        if (file != nullptr) {
+            Flush();
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    void TraceRecorder::Start(const uint8_t* configBody, size_t size, uint64_t nowMs)
+    {
+        if (!enabled) {
+            return;
+        }
+        callMs = nowMs;
+        Begin(TraceKind::CONFIG);
+        PutBytes(configBody, size);
+        StoreLE32(record.data(), static_cast<uint32_t>(recordSize));
+        config.assign(record.data(), record.data() + recordSize);
+        recordSize = 0;
+        if (file != nullptr) {
+            uint8_t header[TRACE_FILE_HEADER];
+            FileHeader(header);
+            if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+                std::fwrite(config.data(), 1, config.size(), file) != config.size()) {
+                ++dropped;
+            }
+        }
+    }
+
+    void TraceRecorder::Begin(TraceKind kind)
+    {
+        // Size is patched in by End
+        recordSize = 0;
+        uint8_t* p = Grow(TRACE_RECORD_HEADER);
+        p[4] = static_cast<uint8_t>(kind);
+        StoreLE64(p + 5, callMs);
+    }
+
+    void TraceRecorder::Put32(uint32_t value)
+    {
+        StoreLE32(Grow(4), value);
+    }
+
+    void TraceRecorder::Put64(uint64_t value)
+    {
+        StoreLE64(Grow(8), value);
+    }
+
+    void TraceRecorder::PutBytes(const uint8_t* data, size_t size)
+    {
+        if (size > 0) {
+            std::memcpy(Grow(size), data, size);
+        }
+    }
+
+    void TraceRecorder::End()
+    {
+        size_t size = recordSize;
+        StoreLE32(record.data(), static_cast<uint32_t>(size));
+        ++records;
+        if (file != nullptr && used + size > ring.size()) {
+            Flush();
+            if (size > ring.size()) {
+                // Larger than the whole ring: straight to the file
+                if (std::fwrite(record.data(), 1, size, file) != size) {
+                    ++dropped;
+                }
+                return;
+            }
+        }
+        if (size > ring.size()) {
+            ++dropped;
+            return;
+        }
+        while (used + size > ring.size()) {
+            DropOldest();
+        }
+        Append(record.data(), size);
+    }
+
+    void TraceRecorder::Append(const uint8_t* data, size_t size)
+    {
+        // Records may wrap around the end of the ring
+        size_t tail = Wrap(head + used);
+        size_t first = std::min(size, ring.size() - tail);
+        std::memcpy(ring.data() + tail, data, first);
+        if (first < size) {
+            std::memcpy(ring.data(), data + first, size - first);
+        }
+        used += size;
+    }
+
+    void TraceRecorder::CopyOut(size_t from, uint8_t* out, size_t size) const
+    {
+        size_t start = Wrap(head + from);
+        size_t first = std::min(size, ring.size() - start);
+        std::memcpy(out, ring.data() + start, first);
+        if (first < size) {
+            std::memcpy(out + first, ring.data(), size - first);
+        }
+    }
+
+    void TraceRecorder::DropOldest()
+    {
+        uint8_t size[4];
+        const uint8_t* p = ring.data() + head;
+        if (ring.size() - head < sizeof(size)) {
+            CopyOut(0, size, sizeof(size)); // Size field split by the wrap
+            p = size;
+        }
+        size_t bytes = LoadLE32(p);
+        head = Wrap(head + bytes);
+        used -= bytes;
+        ++dropped;
+    }
+
+    void TraceRecorder::Flush()
+    {
+        if (file == nullptr || used == 0) {
+            return;
+        }
+        size_t first = std::min(used, ring.size() - head);
+        bool ok = std::fwrite(ring.data() + head, 1, first, file) == first;
+        ok = ok && std::fwrite(ring.data(), 1, used - first, file) == used - first;
+        ok = ok && std::fflush(file) == 0;
+        if (!ok) {
+            ++dropped;
+        }
+        head = 0;
+        used = 0;
+    }
+
+    void TraceRecorder::Snapshot(std::vector<uint8_t>& out) const
+    {
+        out.resize(TRACE_FILE_HEADER + config.size() + used);
+        FileHeader(out.data());
+        if (!config.empty()) {
+            std::memcpy(out.data() + TRACE_FILE_HEADER, config.data(), config.size());
+        }
+        if (used > 0) {
+            CopyOut(0, out.data() + TRACE_FILE_HEADER + config.size(), used);
+        }
+    }
+
+    bool TraceReader::Open(const uint8_t* trace, size_t traceSize)
+    {
+        data = trace;
+        size = traceSize;
+        offset = TRACE_FILE_HEADER;
+        truncated = false;
+        return trace != nullptr && traceSize >= TRACE_FILE_HEADER && std::memcmp(trace, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0 &&
+               LoadLE16(trace + 4) == TRACE_VERSION;
+    }
+
+    bool TraceReader::Next(TraceRecord& outRecord)
+    {
+        if (offset >= size) {
+            return false;
+        }
+        size_t recordSize = (size - offset >= TRACE_RECORD_HEADER) ? LoadLE32(data + offset) : 0;
+        if (recordSize < TRACE_RECORD_HEADER || recordSize > size - offset) {
+            truncated = true; // A file cut off mid-record, e.g. by a crash
+            return false;
+        }
+        const uint8_t* p = data + offset;
+        outRecord.kind = static_cast<TraceKind>(p[4]);
+        outRecord.timeMs = LoadLE64(p + 5);
+        outRecord.body = p + TRACE_RECORD_HEADER;
+        outRecord.bodySize = recordSize - TRACE_RECORD_HEADER;
+        offset += recordSize;
+        return true;
+    }
+
+    uint8_t TraceBody::Get8()
+    {
+        const uint8_t* p = GetBytes(1);
+        return p ? p[0] : 0;
+    }
+
+    uint32_t TraceBody::Get32()
+    {
+        const uint8_t* p = GetBytes(4);
+        return p ? LoadLE32(p) : 0;
+    }
+
+    uint64_t TraceBody::Get64()
+    {
+        const uint8_t* p = GetBytes(8);
+        return p ? LoadLE64(p) : 0;
+    }
+
+    const uint8_t* TraceBody::GetBytes(size_t count)
+    {
+        if (count > size - offset) {
+            overrun = true;
+            offset = size;
+            return nullptr;
+        }
+        const uint8_t* p = data + offset;
+        offset += count;
+        return p;
+    }
@@ -0,0 +1,209 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef TRACE_H
+#define TRACE_H
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Binary trace of one node's I/O, for replay on a workstation (TraceReplay.h).
+//
+//   file     "THT1", uint16 version, then records
+//   record   uint32 size (whole record), uint8 kind, uint64 timeMs, body
+//
+// All integers little-endian. The first record is always CONFIG. Inputs are the
+// public calls that change state, logged with their arguments when they enter
+// THOR (calls THOR makes to itself are not logged again). Outputs are what those
+// calls produced: frames for the radio, verdicts and sink answers. Output records
+// carry the time of the input they belong to. While tracing, every clock read
+// inside a call returns that time, so a replay on a virtual clock is exact.
+enum class TraceKind : uint8_t {
+    CONFIG        = 1,  // EncodeTraceConfig body
+    // Inputs
+    DATA_IN       = 2,  // uint8 sink, uint32 myNodeId, uint32 outSize, frame
+    DATA_BATCH    = 3,  // uint32 myNodeId, uint32 count, count x { uint32 size, frame }
+    HELLO_IN      = 4,  // frame
+    ACK_IN        = 5,  // frame
+    NEIGHBOR      = 6,  // uint32 nodeId, int32 rssi, uint8 NEIGHBOR_* flags
+    REMOVE_OLD    = 7,  // -
+    SEND          = 8,  // uint8 sink, uint32 dest, sender, origin, sequence, uint64 lifetimeMs, uint8 supersede, uint32 outSize, payload
+    CREATE_HELLO  = 9,  // uint32 dest, sender, origin, sequence, outSize
+    CREATE_ACK    = 10, // uint32 dest, sender, origin, nextHop, sequence, uint8 myInternet, intNeighbour, uint32 outSize
+    CREATE_CONTROL = 11, // uint32 sender, sequence, uint8 myInternet, intNeighbour, uint32 outSize
+    DRAIN         = 12, // uint64 maxFrames, maxBytes
+    COMMIT        = 13, // uint64 accepted
+    COMMIT_FRAMES = 14, // uint32 count, count x uint8 accepted
+    PROCESS_QUEUE = 15, // -
+    FLUSH         = 16, // -
+    SET_SINK      = 17, // uint8 set, uint64 maxFrames, maxBytes
+    DELIVERY      = 18, // uint32 nodeId, uint8 delivered
+    BEST_HOP      = 19, // uint32 destinationId (GetBestNextHop may forget a stale route)
+    QUEUE_ACK     = 20, // uint32 originId, sequence
+    PRIORITY      = 21, // uint32 originId, uint8 priority
+    ENERGY_BUDGET = 22, // uint64 remainingNj, fullNj
+    // Outputs
+    FRAME_OUT     = 32, // frame handed to the caller or the radio
+    VERDICT       = 33, // uint8 THORVerdict of a DATA frame or SendPacket
+    SINK_ANSWER   = 34, // uint8 what the transmit sink returned
+    NEXT_HOP      = 35  // uint32 GetBestNextHop result
+};
+const uint8_t TRACE_FIRST_OUTPUT = 32;
+const size_t TRACE_RECORD_HEADER = 13;
+const size_t TRACE_FILE_HEADER = 6;
+
+// Preallocated byte ring of records. With a file, a full ring is written out and
+// emptied; without one it keeps the newest records and drops the oldest.
+// Nothing allocates per record once the largest record has been seen.
+class TraceRecorder
+{
+public:
+    // capacity 0 = tracing off, every call is a no-op
+    TraceRecorder(size_t capacity, const std::string& path);
+    ~TraceRecorder();
+    // Move-only, the file has one writer. The source is left with tracing off.
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    TraceRecorder(TraceRecorder&& other) noexcept;
+    TraceRecorder& operator=(TraceRecorder&& other) noexcept;
+
+    bool Enabled() const { return enabled; }
+    // Header and CONFIG record: starts the file, and every Snapshot
+    void Start(const uint8_t* configBody, size_t size, uint64_t nowMs);
+
+    // Public entry point: true if it is the outermost one (its input gets logged).
+    // The clock is read once per outermost call, only while tracing.
+    bool Enter(const std::function<uint64_t()>& clock)
+    {
+        if (depth++ == 0) {
+            callMs = clock();
+            return true;
+        }
+        return false;
+    }
+    void Leave() { --depth; }
+    bool InCall() const { return depth != 0; }
+    uint64_t CallMs() const { return callMs; }
+
+    // Output record of the current call; one branch when tracing is off
+    void Output(TraceKind kind, const uint8_t* data, size_t size)
+    {
+        if (depth != 0) {
+            Begin(kind);
+            PutBytes(data, size);
+            End();
+        }
+    }
+    void Output(TraceKind kind, uint8_t value) { Output(kind, &value, 1); }
+
+    // One record: Begin, any number of Put calls, End
+    void Begin(TraceKind kind);
+    void Put8(uint8_t value) { *Grow(1) = value; }
+    void Put32(uint32_t value);
+    void Put64(uint64_t value);
+    void PutBytes(const uint8_t* data, size_t size);
+    void End();
+
+    // Writes what the ring holds to the file (no-op without one)
+    void Flush();
+    // The trace so far in file form: header, CONFIG, then the records still in the ring
+    void Snapshot(std::vector<uint8_t>& out) const;
+
+    uint64_t Records() const { return records; }
+    uint64_t Dropped() const { return dropped; }  // Overwritten (no file) or lost to a write error
+    bool FileOpen() const { return file != nullptr; }
+
+private:
+    uint8_t* Grow(size_t size)
+    {
+        if (recordSize + size > record.size()) {
+            record.resize(2 * (recordSize + size));
+        }
+        uint8_t* p = record.data() + recordSize;
+        recordSize += size;
+        return p;
+    }
+    // Offsets are below twice the ring size: no division on the hot path
+    size_t Wrap(size_t offset) const { return offset >= ring.size() ? offset - ring.size() : offset; }
+    void Append(const uint8_t* data, size_t size);
+    void CopyOut(size_t from, uint8_t* out, size_t size) const;
+    void Close();
+    void DropOldest();
+
+    bool enabled;
+    std::vector<uint8_t> ring;
+    size_t head;                 // Oldest byte
+    size_t used;
+    std::vector<uint8_t> record; // Record being built, grown to the largest one seen
+    size_t recordSize;
+    std::vector<uint8_t> config; // CONFIG record, repeated at the start of every snapshot
+    std::FILE* file;
+    unsigned depth;
+    uint64_t callMs;
+    uint64_t records;
+    uint64_t dropped;
+};
+
+// RAII Enter / Leave around a public call; one branch each way when tracing is off
+class TraceScope
+{
+public:
+    TraceScope(TraceRecorder& recorder, const std::function<uint64_t()>& clock)
+        : tracer(recorder), entered(recorder.Enabled()), top(entered && recorder.Enter(clock)) {}
+    ~TraceScope() { if (entered) tracer.Leave(); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+    // Log this call's input
+    bool Top() const { return top; }
+
+private:
+    TraceRecorder& tracer;
+    bool entered;
+    bool top;
+};
+
+// One decoded record; body points into the trace buffer
+struct TraceRecord {
+    TraceKind kind;
+    uint64_t timeMs;
+    const uint8_t* body;
+    size_t bodySize;
+};
+
+// Walks the records of a trace in memory (file or Snapshot form)
+class TraceReader
+{
+public:
+    // False if the header is missing or of another version
+    bool Open(const uint8_t* data, size_t size);
+    // False at the end, or at a truncated record (see Truncated)
+    bool Next(TraceRecord& outRecord);
+    bool Truncated() const { return truncated; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    bool truncated = false;
+};
+
+// Little-endian cursor over a record body. Reads past the end return 0 and set 'overrun'.
+struct TraceBody {
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+    bool overrun = false;
+
+    TraceBody(const uint8_t* body, size_t bodySize) : data(body), size(bodySize) {}
+    uint8_t  Get8();
+    uint32_t Get32();
+    uint64_t Get64();
+    // The next 'count' bytes, nullptr if there are not that many
+    const uint8_t* GetBytes(size_t count);
+    const uint8_t* Rest() const { return data + offset; }
+    size_t Remaining() const { return size - offset; }
+};
+
+#endif /* TRACE_H */
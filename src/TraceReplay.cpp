@@ -0,0 +1,398 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+
+#include "TraceReplay.h"
+#include "WireCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const size_t REPLAY_TRACE_SLACK = 64 * 1024; // Room for a replay that outputs more than the recording
+
+    struct ConfigWriter {
+        uint8_t* p;
+        void Put8(uint8_t value) { *p++ = value; }
+        void Put32(uint32_t value) { StoreLE32(p, value); p += 4; }
+        void Put64(uint64_t value) { StoreLE64(p, value); p += 8; }
+    };
+
+    inline bool IsOutput(TraceKind kind) { return static_cast<uint8_t>(kind) >= TRACE_FIRST_OUTPUT; }
+
+    // Output records of each input, in input order
+    void GroupOutputs(const std::vector<TraceRecord>& records, std::vector<std::vector<const TraceRecord*>>& outGroups)
+    {
+        outGroups.clear();
+        for (const TraceRecord& record : records) {
+            if (record.kind == TraceKind::CONFIG) {
+                continue;
+            }
+            if (!IsOutput(record.kind)) {
+                outGroups.emplace_back();
+            } else if (!outGroups.empty()) {
+                outGroups.back().push_back(&record);
+            }
+        }
+    }
+
+    bool SameRecord(const TraceRecord* a, const TraceRecord* b)
+    {
+        return a != nullptr && b != nullptr && a->kind == b->kind && a->timeMs == b->timeMs && a->bodySize == b->bodySize &&
+               (a->bodySize == 0 || std::memcmp(a->body, b->body, a->bodySize) == 0);
+    }
+
+    // CONFIG first, then every record after it
+    bool ReadRecords(const uint8_t* trace, size_t size, std::vector<TraceRecord>& outRecords, bool& outTruncated)
+    {
+        TraceReader reader;
+        outRecords.clear();
+        if (!reader.Open(trace, size)) {
+            return false;
+        }
+        TraceRecord record;
+        while (reader.Next(record)) {
+            outRecords.push_back(record);
+        }
+        outTruncated = reader.Truncated();
+        return !outRecords.empty() && outRecords[0].kind == TraceKind::CONFIG;
+    }
+}
+
+size_t EncodeTraceConfig(const THORConfig& config, uint8_t* out, size_t outSize)
+{
+    if (out == nullptr || outSize < TRACE_CONFIG_SIZE) {
+        return 0;
+    }
+    ConfigWriter w = { out };
+    w.Put64(config.queueCapacity);
+    w.Put64(config.queueBytes);
+    w.Put64(config.maxPayload);
+    w.Put8(static_cast<uint8_t>(config.queueOrder));
+    w.Put8(static_cast<uint8_t>(config.queueEviction));
+    w.Put64(config.spreadNeighbors);
+    w.Put8(static_cast<uint8_t>(config.spreadWeight));
+    w.Put64(config.neighborTimeoutMs);
+    w.Put64(config.linkDecayMs);
+    w.Put64(config.beacon.minIntervalMs);
+    w.Put64(config.beacon.maxIntervalMs);
+    w.Put64(config.beacon.densityNeighbors);
+    w.Put32(config.beacon.jitterPercent);
+    w.Put8(config.compactHeaders ? 1 : 0);
+    w.Put64(config.fragmentSize);
+    w.Put64(config.reassemblySlots);
+    w.Put64(config.reassemblyTimeoutMs);
+    w.Put64(config.routeCacheSize);
+    w.Put64(config.routeTimeoutMs);
+    w.Put64(config.queueLifetimeMs);
+    w.Put8(config.advertiseLoad ? 1 : 0);
+    w.Put32(config.energy.txPowerMw);
+    w.Put32(config.energy.rxPowerMw);
+    w.Put32(config.energy.bitrateKbps);
+    w.Put32(config.energy.frameOverheadBytes);
+    w.Put32(config.energy.frameWakeNj);
+    w.Put32(static_cast<uint32_t>(config.energy.goodRssi));
+    w.Put32(static_cast<uint32_t>(config.energy.deadRssi));
+    w.Put32(config.energy.maxLossPercent);
+    w.Put32(config.energy.maxAttempts);
+    w.Put8(config.energy.budgeted ? 1 : 0);
+    w.Put32(static_cast<uint32_t>(config.energy.energyWeight));
+    w.Put32(config.energy.lowPercent);
+    w.Put64(config.energy.candidates);
+    w.Put64(config.duplicateCapacity);
+    w.Put64(config.duplicateMaxAgeMs);
+    return static_cast<size_t>(w.p - out);
+}
+
+bool DecodeTraceConfig(const uint8_t* data, size_t size, THORConfig& outConfig)
+{
+    TraceBody r(data, size);
+    THORConfig config;
+    config.queueCapacity = r.Get64();
+    config.queueBytes = r.Get64();
+    config.maxPayload = r.Get64();
+    config.queueOrder = static_cast<QueueOrder>(r.Get8());
+    config.queueEviction = static_cast<QueueEviction>(r.Get8());
+    config.spreadNeighbors = r.Get64();
+    config.spreadWeight = static_cast<SpreadWeight>(r.Get8());
+    config.neighborTimeoutMs = r.Get64();
+    config.linkDecayMs = r.Get64();
+    config.beacon.minIntervalMs = r.Get64();
+    config.beacon.maxIntervalMs = r.Get64();
+    config.beacon.densityNeighbors = r.Get64();
+    config.beacon.jitterPercent = r.Get32();
+    config.compactHeaders = r.Get8() != 0;
+    config.fragmentSize = r.Get64();
+    config.reassemblySlots = r.Get64();
+    config.reassemblyTimeoutMs = r.Get64();
+    config.routeCacheSize = r.Get64();
+    config.routeTimeoutMs = r.Get64();
+    config.queueLifetimeMs = r.Get64();
+    config.advertiseLoad = r.Get8() != 0;
+    if (r.overrun) {
+        return false;
+    }
+    // Traces from before the energy settings replay with their defaults
+    if (r.Remaining() > 0) {
+        config.energy.txPowerMw = r.Get32();
+        config.energy.rxPowerMw = r.Get32();
+        config.energy.bitrateKbps = r.Get32();
+        config.energy.frameOverheadBytes = r.Get32();
+        config.energy.frameWakeNj = r.Get32();
+        config.energy.goodRssi = static_cast<int32_t>(r.Get32());
+        config.energy.deadRssi = static_cast<int32_t>(r.Get32());
+        config.energy.maxLossPercent = r.Get32();
+        config.energy.maxAttempts = r.Get32();
+        config.energy.budgeted = r.Get8() != 0;
+        config.energy.energyWeight = static_cast<int32_t>(r.Get32());
+        config.energy.lowPercent = r.Get32();
+        config.energy.candidates = r.Get64();
+        if (r.overrun) {
+            return false;
+        }
+    }
+    // And from before the duplicate cache size was configurable
+    if (r.Remaining() > 0) {
+        config.duplicateCapacity = r.Get64();
+        if (r.overrun) {
+            return false;
+        }
+    }
+    // And from before the duplicate age limit was configurable
+    if (r.Remaining() > 0) {
+        config.duplicateMaxAgeMs = r.Get64();
+        if (r.overrun) {
+            return false;
+        }
+    }
+    outConfig = config; // Bytes past TRACE_CONFIG_SIZE are settings of a newer build
+    return true;
+}
+
+bool ReplayTrace(const uint8_t* trace, size_t size, bool verify, ReplayResult& outResult)
+{
+    outResult = ReplayResult();
+    std::vector<TraceRecord> records;
+    THORConfig config;
+    if (!ReadRecords(trace, size, records, outResult.truncated) ||
+        !DecodeTraceConfig(records[0].body, records[0].bodySize, config)) {
+        return false;
+    }
+    uint64_t now = records[0].timeMs;
+    config.clock = [&now]() { return now; };
+    config.traceBytes = verify ? size + REPLAY_TRACE_SLACK : 0;
+    THOR node(config);
+
+    // The sink takes what the recorded one took, frame by frame
+    std::vector<uint8_t> answers;
+    size_t nextAnswer = 0;
+    TransmitSink sink = [&answers, &nextAnswer](const FrameView&, uint32_t) {
+        return nextAnswer < answers.size() && answers[nextAnswer++] != 0;
+    };
+
+    std::vector<uint8_t> out;
+    std::vector<FrameView> frames;
+    std::vector<std::vector<uint8_t>> batch;
+    std::vector<Packet> packets;
+    std::vector<THORVerdict> verdicts;
+    std::vector<bool> accepted;
+    for (size_t i = 1; i < records.size(); ++i) {
+        const TraceRecord& record = records[i];
+        if (IsOutput(record.kind)) {
+            ++outResult.outputs;
+            continue;
+        }
+        answers.clear();
+        nextAnswer = 0;
+        for (size_t k = i + 1; k < records.size() && IsOutput(records[k].kind); ++k) {
+            if (records[k].kind == TraceKind::SINK_ANSWER && records[k].bodySize == 1) {
+                answers.push_back(records[k].body[0]);
+            }
+        }
+
+        now = record.timeMs;
+        TraceBody body(record.body, record.bodySize);
+        PacketView view;
+        Header header;
+        bool known = true;
+        switch (record.kind) {
+        case TraceKind::DATA_IN: {
+            bool viaSink = body.Get8() != 0;
+            uint32_t myNodeId = body.Get32();
+            out.resize(body.Get32());
+            if (viaSink) {
+                node.HandleData(body.Rest(), body.Remaining(), view, myNodeId);
+            } else {
+                node.HandleData(body.Rest(), body.Remaining(), view, myNodeId, out.data(), out.size());
+            }
+            break;
+        }
+        case TraceKind::DATA_BATCH: {
+            uint32_t myNodeId = body.Get32();
+            uint32_t count = body.Get32();
+            batch.clear();
+            for (uint32_t k = 0; k < count && !body.overrun; ++k) {
+                uint32_t frameSize = body.Get32();
+                const uint8_t* frame = body.GetBytes(frameSize);
+                batch.emplace_back(frame, frame == nullptr ? frame : frame + frameSize);
+            }
+            node.HandleDataBatch(batch, packets, verdicts, myNodeId);
+            break;
+        }
+        case TraceKind::HELLO_IN:
+            node.HandleHello(record.body, record.bodySize, header);
+            break;
+        case TraceKind::ACK_IN:
+            node.HandleAck(record.body, record.bodySize, header);
+            break;
+        case TraceKind::NEIGHBOR: {
+            uint32_t nodeId = body.Get32();
+            int rssi = static_cast<int32_t>(body.Get32());
+            uint8_t flags = body.Get8();
+            node.NeighborStore(nodeId, rssi, (flags & NEIGHBOR_INTERNET_DIRECT) != 0, (flags & NEIGHBOR_INTERNET_INDIRECT) != 0,
+                               (flags & NEIGHBOR_VISITED) != 0);
+            break;
+        }
+        case TraceKind::REMOVE_OLD:
+            node.RemoveOld();
+            break;
+        case TraceKind::SEND: {
+            bool viaSink = body.Get8() != 0;
+            uint32_t dest = body.Get32();
+            uint32_t sender = body.Get32();
+            uint32_t origin = body.Get32();
+            uint32_t sequence = body.Get32();
+            QueueOptions options;
+            options.lifetimeMs = body.Get64();
+            options.supersede = body.Get8();
+            out.resize(body.Get32());
+            if (viaSink) {
+                node.SendPacket(dest, sender, origin, sequence, body.Rest(), body.Remaining(), options);
+            } else {
+                node.SendPacket(dest, sender, origin, sequence, body.Rest(), body.Remaining(), options, out.data(), out.size());
+            }
+            break;
+        }
+        case TraceKind::CREATE_HELLO: {
+            uint32_t dest = body.Get32();
+            uint32_t sender = body.Get32();
+            uint32_t origin = body.Get32();
+            uint32_t sequence = body.Get32();
+            out.resize(body.Get32());
+            node.CreateHello(dest, sender, origin, sequence, out.data(), out.size());
+            break;
+        }
+        case TraceKind::CREATE_ACK: {
+            uint32_t dest = body.Get32();
+            uint32_t sender = body.Get32();
+            uint32_t origin = body.Get32();
+            uint32_t nextHop = body.Get32();
+            uint32_t sequence = body.Get32();
+            bool myInternet = body.Get8() != 0;
+            bool intNeighbour = body.Get8() != 0;
+            out.resize(body.Get32());
+            node.CreateACK(dest, sender, origin, nextHop, sequence, myInternet, intNeighbour, out.data(), out.size());
+            break;
+        }
+        case TraceKind::CREATE_CONTROL: {
+            uint32_t sender = body.Get32();
+            uint32_t sequence = body.Get32();
+            bool myInternet = body.Get8() != 0;
+            bool intNeighbour = body.Get8() != 0;
+            out.resize(body.Get32());
+            node.CreateControl(sender, sequence, myInternet, intNeighbour, out.data(), out.size());
+            break;
+        }
+        case TraceKind::DRAIN: {
+            size_t maxFrames = static_cast<size_t>(body.Get64());
+            size_t maxBytes = static_cast<size_t>(body.Get64());
+            node.DrainQueue(maxFrames, maxBytes, frames);
+            break;
+        }
+        case TraceKind::COMMIT:
+            node.CommitQueue(static_cast<size_t>(body.Get64()));
+            break;
+        case TraceKind::COMMIT_FRAMES: {
+            uint32_t count = body.Get32();
+            accepted.clear();
+            for (uint32_t k = 0; k < count && !body.overrun; ++k) {
+                accepted.push_back(body.Get8() != 0);
+            }
+            node.CommitQueue(accepted);
+            break;
+        }
+        case TraceKind::PROCESS_QUEUE:
+            node.ProcessQueue(frames);
+            break;
+        case TraceKind::FLUSH:
+            node.Flush();
+            break;
+        case TraceKind::SET_SINK: {
+            bool set = body.Get8() != 0;
+            size_t maxFrames = static_cast<size_t>(body.Get64());
+            size_t maxBytes = static_cast<size_t>(body.Get64());
+            node.SetTransmitSink(set ? sink : TransmitSink(), maxFrames, maxBytes);
+            break;
+        }
+        case TraceKind::DELIVERY: {
+            uint32_t nodeId = body.Get32();
+            node.RecordDelivery(nodeId, body.Get8() != 0);
+            break;
+        }
+        case TraceKind::BEST_HOP:
+            node.GetBestNextHop(body.Get32());
+            break;
+        case TraceKind::QUEUE_ACK: {
+            uint32_t origin = body.Get32();
+            node.QueueAck(origin, body.Get32());
+            break;
+        }
+        case TraceKind::PRIORITY: {
+            uint32_t origin = body.Get32();
+            node.SetOriginPriority(origin, body.Get8());
+            break;
+        }
+        case TraceKind::ENERGY_BUDGET: {
+            uint64_t remainingNj = body.Get64();
+            node.SetEnergyBudget(remainingNj, body.Get64());
+            break;
+        }
+        default:
+            known = false;
+            break;
+        }
+        if (known) {
+            ++outResult.inputs;
+        } else {
+            ++outResult.skipped;
+        }
+    }
+    if (!verify) {
+        return true;
+    }
+
+    // Outputs of the replay, input by input, against the recorded ones
+    std::vector<uint8_t> replayTrace;
+    node.SnapshotTrace(replayTrace);
+    std::vector<TraceRecord> replayRecords;
+    bool replayTruncated = false;
+    ReadRecords(replayTrace.data(), replayTrace.size(), replayRecords, replayTruncated);
+    std::vector<std::vector<const TraceRecord*>> recorded;
+    std::vector<std::vector<const TraceRecord*>> replayed;
+    GroupOutputs(records, recorded);
+    GroupOutputs(replayRecords, replayed);
+    if (node.GetTracer().Dropped() != 0) {
+        replayed.clear(); // The replay outgrew its ring: nothing lines up
+    }
+    const std::vector<const TraceRecord*> none;
+    for (size_t g = 0; g < recorded.size(); ++g) {
+        const std::vector<const TraceRecord*>& mine = (g < replayed.size()) ? replayed[g] : none;
+        size_t count = std::max(recorded[g].size(), mine.size());
+        for (size_t k = 0; k < count; ++k) {
+            if (!SameRecord(k < recorded[g].size() ? recorded[g][k] : nullptr, k < mine.size() ? mine[k] : nullptr)) {
+                if (outResult.mismatches++ == 0) {
+                    outResult.firstMismatch = g;
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+#include <cstdint>
+#include <cstddef>
+#include "THOR.h"
+#include "Trace.h"
+
+// CONFIG record body: every numeric THORConfig setting, little-endian, in
+// declaration order (settings added later go at the end). Not recorded: the
+// clock, queueFile, the trace settings and a policy set with SetRoutingPolicy
+// (a replay uses the default one).
+const size_t TRACE_CONFIG_SIZE = 198;
+size_t EncodeTraceConfig(const THORConfig& config, uint8_t* out, size_t outSize);
+bool DecodeTraceConfig(const uint8_t* data, size_t size, THORConfig& outConfig);
+
+struct ReplayResult {
+    uint64_t inputs;         // Calls replayed
+    uint64_t skipped;        // Input records of a kind this build does not know
+    uint64_t outputs;        // Output records in the recording
+    uint64_t mismatches;     // Output records the replay did not reproduce (verify only)
+    uint64_t firstMismatch;  // Input index of the first one
+    bool truncated;          // The trace ends mid-record; everything before it was replayed
+};
+
+// Feeds the inputs of a trace, in order, into a fresh THOR built from its CONFIG
+// record, on a virtual clock set to each input's time. The transmit sink answers
+// what the recorded one did. With verify the replay is traced too and its outputs
+// compared with the recorded ones. False if the trace has no header or CONFIG.
+//
+// Replays are exact for a trace that starts at construction (a traceFile, or a
+// ring that never dropped) of a node whose queue started empty, as long as its
+// sink did not call back into THOR.
+bool ReplayTrace(const uint8_t* trace, size_t size, bool verify, ReplayResult& outResult);
+
+#endif /* TRACE_REPLAY_H */
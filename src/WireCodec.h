@@ -0,0 +1,176 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+#ifndef WIRE_CODEC_H
+#define WIRE_CODEC_H
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "THOR.h"
+
+// Defined byte layout of the 22-byte Header, independent of host byte order,
+// alignment and compiler bit-field packing:
+//
+//   0  type
+//   1  flags: ttl (bits 0-4), intneighbour (5), visited (6), myInternet (7)
+//   2  destinationId   6  senderId   10  originId   14  nextHopId   18  sequence
+//
+// Every id is a little-endian uint32. This is what the packed struct looks like
+// under GCC/Clang on little-endian hosts, so existing fleets keep interoperating.
+// On those hosts the loads and stores compile to plain unaligned moves.
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+#define THOR_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#elif defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64) || defined(_M_ARM)
+#define THOR_LITTLE_ENDIAN 1
+#else
+#define THOR_LITTLE_ENDIAN 0
+#endif
+
+const size_t WIRE_HEADER_SIZE = 22;
+static_assert(sizeof(Header) == WIRE_HEADER_SIZE, "Header and its wire form have the same size");
+
+constexpr size_t WIRE_TYPE_AT = 0;
+constexpr size_t WIRE_FLAGS_AT = 1;
+constexpr size_t WIRE_DESTINATION_AT = 2;
+constexpr size_t WIRE_SENDER_AT = 6;
+constexpr size_t WIRE_ORIGIN_AT = 10;
+constexpr size_t WIRE_NEXT_HOP_AT = 14;
+constexpr size_t WIRE_SEQUENCE_AT = 18;
+
+constexpr uint8_t FLAGS_TTL_MASK = 0x1F;
+constexpr unsigned FLAGS_INTNEIGHBOUR_SHIFT = 5;
+constexpr unsigned FLAGS_VISITED_SHIFT = 6;
+constexpr unsigned FLAGS_MY_INTERNET_SHIFT = 7;
+
+inline uint16_t LoadLE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline void StoreLE16(uint8_t* p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline uint32_t LoadLE32(const uint8_t* p)
+{
+#if THOR_LITTLE_ENDIAN
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+#else
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+#endif
+}
+
+inline void StoreLE32(uint8_t* p, uint32_t value)
+{
+#if THOR_LITTLE_ENDIAN
+    std::memcpy(p, &value, sizeof(value));
+#else
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+#endif
+}
+
+inline uint64_t LoadLE64(const uint8_t* p)
+{
+    return static_cast<uint64_t>(LoadLE32(p)) | (static_cast<uint64_t>(LoadLE32(p + 4)) << 32);
+}
+
+inline void StoreLE64(uint8_t* p, uint64_t value)
+{
+    StoreLE32(p, static_cast<uint32_t>(value));
+    StoreLE32(p + 4, static_cast<uint32_t>(value >> 32));
+}
+
+inline uint8_t PackFlags(const flags& f)
+{
+    return static_cast<uint8_t>((f.ttl & FLAGS_TTL_MASK) | (f.intneighbour << FLAGS_INTNEIGHBOUR_SHIFT) |
+                                (f.visited << FLAGS_VISITED_SHIFT) | (f.myInternet << FLAGS_MY_INTERNET_SHIFT));
+}
+
+inline flags UnpackFlags(uint8_t byte)
+{
+    flags f;
+    f.ttl = byte & FLAGS_TTL_MASK;
+    f.intneighbour = (byte >> FLAGS_INTNEIGHBOUR_SHIFT) & 1;
+    f.visited = (byte >> FLAGS_VISITED_SHIFT) & 1;
+    f.myInternet = (byte >> FLAGS_MY_INTERNET_SHIFT) & 1;
+    return f;
+}
+
+// Writes exactly WIRE_HEADER_SIZE bytes.
+inline void EncodeHeader(const Header& header, uint8_t* out)
+{
+    out[WIRE_TYPE_AT] = static_cast<uint8_t>(header.type);
+    out[WIRE_FLAGS_AT] = PackFlags(header.flagsAndTTL);
+    StoreLE32(out + WIRE_DESTINATION_AT, header.destinationId);
+    StoreLE32(out + WIRE_SENDER_AT, header.senderId);
+    StoreLE32(out + WIRE_ORIGIN_AT, header.originId);
+    StoreLE32(out + WIRE_NEXT_HOP_AT, header.nextHopId);
+    StoreLE32(out + WIRE_SEQUENCE_AT, header.sequence);
+}
+
+// Reads exactly WIRE_HEADER_SIZE bytes; the caller checks the length.
+inline void DecodeHeader(const uint8_t* data, Header& outHeader)
+{
+    outHeader.type = static_cast<THORPacketType>(data[WIRE_TYPE_AT]);
+    outHeader.flagsAndTTL = UnpackFlags(data[WIRE_FLAGS_AT]);
+    outHeader.destinationId = LoadLE32(data + WIRE_DESTINATION_AT);
+    outHeader.senderId = LoadLE32(data + WIRE_SENDER_AT);
+    outHeader.originId = LoadLE32(data + WIRE_ORIGIN_AT);
+    outHeader.nextHopId = LoadLE32(data + WIRE_NEXT_HOP_AT);
+    outHeader.sequence = LoadLE32(data + WIRE_SEQUENCE_AT);
+}
+
+// Fragment, control and load bodies use the same byte order
+inline void EncodeFragmentHeader(const FragmentHeader& fragment, uint8_t* out)
+{
+    out[0] = fragment.index;
+    out[1] = fragment.count;
+    StoreLE16(out + 2, fragment.offset);
+}
+
+inline FragmentHeader DecodeFragmentHeader(const uint8_t* data)
+{
+    FragmentHeader fragment;
+    fragment.index = data[0];
+    fragment.count = data[1];
+    fragment.offset = LoadLE16(data + 2);
+    return fragment;
+}
+
+inline void EncodeControlAck(const ControlAck& ack, uint8_t* out)
+{
+    StoreLE32(out, ack.originId);
+    StoreLE32(out + 4, ack.sequence);
+}
+
+inline ControlAck DecodeControlAck(const uint8_t* data)
+{
+    ControlAck ack;
+    ack.originId = LoadLE32(data);
+    ack.sequence = LoadLE32(data + 4);
+    return ack;
+}
+
+inline void EncodeLoadAdvert(const LoadAdvert& advert, uint8_t* out)
+{
+    out[0] = advert.load;
+    out[1] = advert.credits;
+}
+
+inline LoadAdvert DecodeLoadAdvert(const uint8_t* data)
+{
+    LoadAdvert advert;
+    advert.load = data[0];
+    advert.credits = data[1];
+    return advert;
+}
+
+#endif /* WIRE_CODEC_H */
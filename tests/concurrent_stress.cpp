@@ -0,0 +1,219 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * Multi-producer stress test for ConcurrentTHOR.
+ *
+ *   concurrent_stress [itemsPerProducer]
+ *
+ * Four producer threads post DATA for this node, sends and neighbor updates into
+ * one small ingress ring while the consumer polls it and two reader threads take
+ * snapshots. Checks that every posted DATA frame and send comes out exactly once
+ * with its own payload, and that no snapshot mixes two consumer steps. Build it
+ * with -fsanitize=thread as well: the ring and the seqlock are only as good as
+ * their memory ordering.
+ *
+ * Exits with status 1 if a check failed.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ConcurrentTHOR.h"
+#include "WireCodec.h"
+
+namespace {
+    const uint32_t ME = 1;
+    const uint32_t PRODUCERS = 4;
+    const uint32_t READERS = 2;
+    const uint32_t NEIGHBORS_PER_PRODUCER = 10;
+    const size_t SNAPSHOT_NEIGHBORS = 16;
+
+    std::atomic<int> failures(0);
+
+    void Fail(const char* what, uint32_t a, uint32_t b)
+    {
+        if (failures.fetch_add(1) < 20) {
+            std::fprintf(stderr, "check failed: %s (%u, %u)\n", what, a, b);
+        }
+    }
+
+    // Payload of item i from producer p, also what the consumer checks it against
+    void FillPayload(uint8_t* payload, uint32_t producer, uint32_t item)
+    {
+        StoreLE32(payload, producer);
+        StoreLE32(payload + 4, item);
+        StoreLE32(payload + 8, producer * 0x9E3779B1u ^ item);
+    }
+
+    void Produce(ConcurrentTHOR& node, uint32_t producer, uint32_t items)
+    {
+        uint8_t payload[12];
+        for (uint32_t i = 0; i < items; ++i) {
+            FillPayload(payload, producer, i);
+            bool posted = false;
+            while (!posted) {
+                switch (i % 3) {
+                case 0: {
+                    Header header = {};
+                    header.type = THORPacketType::DATA;
+                    header.flagsAndTTL.ttl = 15;
+                    header.destinationId = ME;
+                    header.senderId = 100 + producer;
+                    header.originId = 1000 + producer;
+                    header.nextHopId = ME;
+                    header.sequence = i;
+                    uint8_t frame[WIRE_HEADER_SIZE + sizeof(payload)];
+                    EncodeHeader(header, frame);
+                    std::memcpy(frame + WIRE_HEADER_SIZE, payload, sizeof(payload));
+                    posted = node.PostData(frame, sizeof(frame));
+                    break;
+                }
+                case 1:
+                    posted = node.PostSend(77, ME, 2000 + producer, i, payload, sizeof(payload));
+                    break;
+                default:
+                    // Direct internet neighbors, so every send has a route
+                    posted = node.PostNeighbor(100 + producer * NEIGHBORS_PER_PRODUCER + i % NEIGHBORS_PER_PRODUCER,
+                                               -40 - static_cast<int>(i % 50), true, false, false);
+                    break;
+                }
+                if (!posted) {
+                    std::this_thread::yield(); // Ring full
+                }
+            }
+        }
+    }
+
+    void Read(const ConcurrentTHOR& node, const std::atomic<bool>& done)
+    {
+        RoutingSnapshot snapshot;
+        size_t lastCount = 0;
+        while (!done.load()) {
+            node.Snapshot(snapshot);
+            size_t expected = snapshot.neighborCount < SNAPSHOT_NEIGHBORS ? snapshot.neighborCount : SNAPSHOT_NEIGHBORS;
+            if (snapshot.neighbors.size() != expected) {
+                Fail("rows match the neighbor count", static_cast<uint32_t>(snapshot.neighbors.size()),
+                     static_cast<uint32_t>(snapshot.neighborCount));
+            }
+            for (size_t i = 1; i < snapshot.neighbors.size(); ++i) {
+                if (snapshot.neighbors[i].score > snapshot.neighbors[i - 1].score) {
+                    Fail("rows are best first", snapshot.neighbors[i - 1].nodeId, snapshot.neighbors[i].nodeId);
+                }
+            }
+            uint32_t best = (!snapshot.neighbors.empty() && snapshot.neighbors[0].score > -1) ? snapshot.neighbors[0].nodeId : 0;
+            if (snapshot.bestHop != best) {
+                Fail("best hop is the first row", snapshot.bestHop, best);
+            }
+            // Nothing expires during the run, so the table only grows
+            if (snapshot.neighborCount < lastCount) {
+                Fail("neighbor count never goes back", static_cast<uint32_t>(snapshot.neighborCount),
+                     static_cast<uint32_t>(lastCount));
+            }
+            lastCount = snapshot.neighborCount;
+        }
+    }
+
+    // Marks one DATA frame or send as seen, from its origin, sequence and payload
+    void See(std::vector<std::vector<uint8_t>>& seen, uint32_t base, const Header& header, const uint8_t* payload, size_t size)
+    {
+        uint32_t producer = header.originId - base;
+        if (producer >= PRODUCERS || header.sequence >= seen[producer].size() || size != 12) {
+            Fail("output belongs to a posted item", header.originId, header.sequence);
+            return;
+        }
+        uint8_t expected[12];
+        FillPayload(expected, producer, header.sequence);
+        if (std::memcmp(payload, expected, sizeof(expected)) != 0) {
+            Fail("payload is the one posted", header.originId, header.sequence);
+        }
+        if (seen[producer][header.sequence]++ != 0) {
+            Fail("handled exactly once", header.originId, header.sequence);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t items = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 30000;
+
+    THORConfig config;
+    config.maxPayload = 32;
+    config.queueCapacity = PRODUCERS * items; // Nothing may be evicted
+    config.duplicateCapacity = 16;
+    ConcurrentTHOR node(ME, config, 64, SNAPSHOT_NEIGHBORS); // Small ring: producers keep running into a full one
+
+    std::vector<std::vector<uint8_t>> delivered(PRODUCERS, std::vector<uint8_t>(items, 0));
+    std::vector<std::vector<uint8_t>> sent(PRODUCERS, std::vector<uint8_t>(items, 0));
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (uint32_t r = 0; r < READERS; ++r) {
+        readers.emplace_back(Read, std::cref(node), std::cref(done));
+    }
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back(Produce, std::ref(node), p, items);
+    }
+
+    // Consumer: this thread owns the node
+    const size_t total = static_cast<size_t>(PRODUCERS) * items;
+    size_t handled = 0;
+    std::vector<FrameView> frames;
+    std::vector<PacketView> views;
+    while (handled < total) {
+        size_t step = node.Poll(frames, views);
+        handled += step;
+        for (const PacketView& view : views) {
+            See(delivered, 1000, view.header, view.payload, view.payloadSize);
+        }
+        for (const FrameView& frame : frames) {
+            Header header;
+            DecodeHeader(frame.data, header);
+            See(sent, 2000, header, frame.data + WIRE_HEADER_SIZE, frame.size - WIRE_HEADER_SIZE);
+        }
+        if (step == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    // Sends that found no route while the table was empty went to the queue
+    node.Node().NeighborStore(99, -60, true, false, false);
+    node.ProcessQueue(frames);
+    for (const FrameView& frame : frames) {
+        Header header;
+        DecodeHeader(frame.data, header);
+        See(sent, 2000, header, frame.data + WIRE_HEADER_SIZE, frame.size - WIRE_HEADER_SIZE);
+    }
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    if (handled != total || node.Poll(frames, views) != 0) {
+        Fail("every posted item is polled once", static_cast<uint32_t>(handled), static_cast<uint32_t>(total));
+    }
+    for (uint32_t p = 0; p < PRODUCERS; ++p) {
+        for (uint32_t i = 0; i < items; ++i) {
+            bool posted = (i % 3) != 2;
+            std::vector<uint8_t>& column = (i % 3) == 0 ? delivered[p] : sent[p];
+            if (posted && column[i] != 1) {
+                Fail("item came out", p, i);
+            }
+        }
+    }
+    NeighborSnapshot neighbor;
+    if (!node.GetNeighbor(node.GetBestNextHop(), neighbor) || node.NeighborCount() != PRODUCERS * NEIGHBORS_PER_PRODUCER + 1) {
+        Fail("final snapshot has the best neighbor", node.GetBestNextHop(), static_cast<uint32_t>(node.NeighborCount()));
+    }
+
+    if (failures.load() != 0) {
+        std::printf("concurrent stress: %d check(s) failed\n", failures.load());
+        return 1;
+    }
+    std::printf("concurrent stress: OK (%zu items)\n", total);
+    return 0;
+}
@@ -0,0 +1,993 @@
+// Copyright 2025 Rishit Sharma
+// Licensed under the Apache License, Version 2.0
+/*
+ * Behaviour checks for the receive path, reassembly, routing state and the queue.
+ *
+ *   core_behavior
+ *
+ * - HandleDataBatch against HandleData called once per frame, on two nodes with
+ *   the same scripted neighbors, and GetBestNextHop against a plain scan of them.
+ * - ReassemblyPool on its own and end to end (fragmenting sender, destination),
+ *   and a partly sent message that was reordered behind another one.
+ * - DuplicateCache: age-out, ring wrap, clock-free own sends and fragment keys.
+ * - Learned link quality: delivery history in the score, and its decay.
+ * - Routes learned from relayed ACKs, refreshed and aged out.
+ * - Neighbor expiry on the timer wheel: refreshes, wraps and long gaps between calls.
+ * - DrainQueue / CommitQueue: budgets, partial commits and aborts, pinned in-flight frames.
+ * - Load spreading over the top spreadNeighbors hops, within the credits they advertise.
+ * - Queue lifetimes (also while in flight) and supersede classes.
+ * - Every QueueEviction policy on a full queue (slots and bytes), in-flight entries kept.
+ * - A moved node keeps its queue (in RAM and in a file) and its trace.
+ * - A queue file written by a process that dies without cleaning up is reloaded,
+ *   and its header and slot records are little-endian.
+ *
+ * Prints every failed check and exits with status 1 if there was one.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "THOR.h"
+#include "DuplicateCache.h"
+#include "PacketQueue.h"
+#include "PacketSlab.h"
+#include "Reassembly.h"
+#include "Trace.h"
+#include "TraceReplay.h"
+#include "WireCodec.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#define THOR_TEST_FORK 1
+#endif
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                           \
+        }                                                                         \
+    } while (0)
+
+namespace {
+    int failures = 0;
+    uint64_t now = 1000;
+
+    struct ScriptedNeighbor {
+        uint32_t id;
+        int rssi;
+        bool direct;
+        bool indirect;
+    };
+
+    const ScriptedNeighbor NEIGHBORS[] = {
+        { 2, -80, false, false },
+        { 3, -55, false, true },
+        { 4, -90, true, false },
+        { 5, -60, true, false },
+        { 6, -45, false, false },
+        { 7, -60, true, false },
+    };
+
+    THORConfig TestConfig()
+    {
+        THORConfig config;
+        config.clock = [] { return now; };
+        return config;
+    }
+
+    void StoreNeighbors(THOR& node)
+    {
+        for (const ScriptedNeighbor& n : NEIGHBORS) {
+            node.NeighborStore(n.id, n.rssi, n.direct, n.indirect, false);
+        }
+    }
+
+    // The selection GetBestNextHop made before the heap: score every neighbor, lowest id on ties
+    uint32_t ScanBestNextHop(const THOR& node)
+    {
+        uint32_t best = 0;
+        int bestScore = 0;
+        for (const ScriptedNeighbor& n : NEIGHBORS) {
+            NeighborInfo info;
+            if (!node.GetNeighbor(n.id, info)) {
+                continue;
+            }
+            uint8_t flags = static_cast<uint8_t>((info.hasInternetDirect ? NEIGHBOR_INTERNET_DIRECT : 0) |
+                                                 (info.hasInternetIndirect ? NEIGHBOR_INTERNET_INDIRECT : 0) |
+                                                 (info.isVisited ? NEIGHBOR_VISITED : 0));
+            int score = ScoreWithPolicy(DefaultRoutingPolicy(), flags, info.rssi);
+            if (best == 0 || score > bestScore || (score == bestScore && n.id < best)) {
+                best = n.id;
+                bestScore = score;
+            }
+        }
+        return best;
+    }
+
+    std::vector<uint8_t> DataFrame(THOR& node, uint32_t destinationId, uint32_t originId, uint32_t sequence, uint8_t ttl)
+    {
+        Packet packet;
+        packet.header = {};
+        packet.header.type = THORPacketType::DATA;
+        packet.header.flagsAndTTL.ttl = ttl;
+        packet.header.destinationId = destinationId;
+        packet.header.senderId = 2;
+        packet.header.originId = originId;
+        packet.header.nextHopId = 1;
+        packet.header.sequence = sequence;
+        packet.payload.assign(12, static_cast<uint8_t>(sequence));
+        return node.Serialize(packet);
+    }
+
+    void CheckBatchMatchesSingle()
+    {
+        const uint32_t me = 1;
+        THOR single(TestConfig());
+        THOR batch(TestConfig());
+        StoreNeighbors(single);
+        StoreNeighbors(batch);
+        CHECK(single.GetBestNextHop() == ScanBestNextHop(single));
+        CHECK(single.GetBestNextHop() == 5); // Direct internet, best RSSI after the near bonus
+
+        std::vector<std::vector<uint8_t>> frames;
+        frames.push_back(DataFrame(single, me, 9, 1, 15));   // Ours
+        frames.push_back(DataFrame(single, 77, 9, 2, 15));   // Relay
+        frames.push_back(frames.back());                     // Duplicate
+        frames.push_back(DataFrame(single, 77, 9, 3, 1));    // No hops left
+        frames.push_back(DataFrame(single, 77, 10, 4, 15));  // Relay again, its hop is visited now
+        frames.push_back(DataFrame(single, 3, 10, 5, 15));   // To a neighbor
+        frames.push_back(std::vector<uint8_t>(10, 0));       // Too short
+
+        std::vector<THORVerdict> singleVerdicts;
+        std::vector<std::vector<uint8_t>> singleOut;
+        for (const std::vector<uint8_t>& frame : frames) {
+            uint8_t out[256];
+            PacketView view;
+            THORVerdict verdict;
+            size_t written = single.HandleData(frame.data(), frame.size(), view, me, out, sizeof(out), verdict);
+            singleVerdicts.push_back(verdict);
+            if (written != 0) {
+                singleOut.emplace_back(out, out + written);
+            }
+            CHECK(single.GetBestNextHop() == ScanBestNextHop(single));
+        }
+
+        std::vector<Packet> packets;
+        std::vector<THORVerdict> batchVerdicts;
+        std::vector<std::vector<uint8_t>> batchOut = batch.HandleDataBatch(frames, packets, batchVerdicts, me);
+        CHECK(batchVerdicts == singleVerdicts);
+        CHECK(batchOut == singleOut);
+        CHECK(batch.GetBestNextHop() == single.GetBestNextHop());
+        CHECK(batch.QueueSize() == single.QueueSize());
+
+        const THORVerdict expected[] = { THORVerdict::DELIVER, THORVerdict::FORWARD, THORVerdict::DROP, THORVerdict::DROP,
+                                         THORVerdict::FORWARD, THORVerdict::FORWARD, THORVerdict::DROP };
+        CHECK(singleVerdicts.size() == sizeof(expected) / sizeof(expected[0]));
+        for (size_t i = 0; i < singleVerdicts.size() && i < sizeof(expected) / sizeof(expected[0]); ++i) {
+            CHECK(singleVerdicts[i] == expected[i]);
+        }
+        Header header;
+        CHECK(singleOut.size() == 3);
+        if (singleOut.size() == 3) {
+            CHECK(single.DeserializeHeader(singleOut[0], header) && header.nextHopId == 5);
+            CHECK(single.DeserializeHeader(singleOut[1], header) && header.nextHopId == 5); // Visited keeps the internet tier
+            CHECK(single.DeserializeHeader(singleOut[2], header) && header.nextHopId == 3 && header.flagsAndTTL.ttl == 14);
+        }
+    }
+
+    void CheckReassemblyPool()
+    {
+        std::vector<uint8_t> message(300);
+        for (size_t i = 0; i < message.size(); ++i) {
+            message[i] = static_cast<uint8_t>(i * 7 + 1);
+        }
+        const size_t piece = 64;
+        const uint8_t count = static_cast<uint8_t>((message.size() + piece - 1) / piece);
+        ReassemblyPool pool(2, 512, 1000);
+
+        // Out of order, one fragment twice
+        const uint8_t arrival[] = { 4, 0, 3, 0, 1, 2 };
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        size_t completed = 0;
+        for (uint8_t index : arrival) {
+            FragmentHeader fragment = { index, count, static_cast<uint16_t>(index * piece) };
+            size_t length = std::min(piece, message.size() - index * piece);
+            if (pool.Add(9, 1, fragment, message.data() + index * piece, length, now, data, size)) {
+                ++completed;
+                CHECK(index == 2); // Only the last missing piece completes it
+            }
+        }
+        CHECK(completed == 1);
+        CHECK(size == message.size() && data != nullptr && std::memcmp(data, message.data(), size) == 0);
+        CHECK(pool.Pending() == 0 && pool.Stats().completed == 1);
+
+        // A message that stalls past the timeout is dropped, not completed late
+        for (uint8_t index = 0; index + 1 < count; ++index) {
+            FragmentHeader fragment = { index, count, static_cast<uint16_t>(index * piece) };
+            CHECK(!pool.Add(9, 2, fragment, message.data() + index * piece, piece, now, data, size));
+        }
+        FragmentHeader last = { static_cast<uint8_t>(count - 1), count, static_cast<uint16_t>((count - 1) * piece) };
+        CHECK(!pool.Add(9, 2, last, message.data() + (count - 1) * piece, message.size() - (count - 1) * piece, now + 1001,
+                        data, size));
+        CHECK(pool.Stats().expired == 1);
+    }
+
+    void CheckFragmentsEndToEnd()
+    {
+        THORConfig config = TestConfig();
+        config.fragmentSize = 40;
+        THOR sender(config);
+        THOR destination(config);
+        sender.NeighborStore(3, -60, false, true, false);
+
+        std::vector<uint8_t> message(200);
+        for (size_t i = 0; i < message.size(); ++i) {
+            message[i] = static_cast<uint8_t>(i * 13);
+        }
+        uint8_t out[64];
+        CHECK(sender.SendPacket(3, 1, 1, 42, message.data(), message.size(), out, sizeof(out)) == 0); // Too long: queued
+        std::vector<FrameView> views;
+        size_t frames = sender.DrainQueue(0, 0, views);
+        CHECK(frames > 1);
+        std::vector<std::vector<uint8_t>> onAir;
+        for (const FrameView& view : views) {
+            CHECK(view.size <= config.fragmentSize);
+            onAir.emplace_back(view.data, view.data + view.size);
+        }
+        sender.CommitQueue(frames);
+        CHECK(sender.QueueSize() == 0);
+
+        std::reverse(onAir.begin(), onAir.end());
+        size_t delivered = 0;
+        for (const std::vector<uint8_t>& frame : onAir) {
+            PacketView view;
+            THORVerdict verdict;
+            destination.HandleData(frame.data(), frame.size(), view, 3, out, sizeof(out), verdict);
+            if (verdict == THORVerdict::DELIVER) {
+                ++delivered;
+                CHECK(view.payloadSize == message.size() && std::memcmp(view.payload, message.data(), message.size()) == 0);
+            } else {
+                CHECK(verdict == THORVerdict::PARTIAL);
+            }
+        }
+        CHECK(delivered == 1);
+    }
+
+    // A head message the radio took part of, then reordered behind a higher priority
+    // one, goes on from its next fragment instead of starting over
+    void CheckFragmentsResumeAfterReorder()
+    {
+        THORConfig config = TestConfig();
+        config.fragmentSize = 40;
+        config.queueOrder = QueueOrder::ORIGIN_PRIORITY;
+        THOR sender(config);
+        THOR destination(config);
+        sender.NeighborStore(3, -60, false, true, false);
+        sender.SetOriginPriority(9, 5);
+
+        std::vector<uint8_t> low(200, 0x11);
+        std::vector<uint8_t> high(60, 0x22);
+        uint8_t out[64];
+        CHECK(sender.SendPacket(3, 1, 1, 42, low.data(), low.size(), out, sizeof(out)) == 0);
+        std::vector<FrameView> views;
+        CHECK(sender.DrainQueue(3, 0, views) == 3);
+        std::vector<std::vector<uint8_t>> onAir;
+        for (const FrameView& view : views) {
+            onAir.emplace_back(view.data, view.data + view.size);
+        }
+        sender.CommitQueue(2); // The radio took two of the three
+        CHECK(sender.QueueSize() == 1);
+        onAir.pop_back();
+
+        CHECK(sender.SendPacket(3, 1, 9, 7, high.data(), high.size(), out, sizeof(out)) == 0); // Ordered in front
+        size_t frames = sender.DrainQueue(0, 0, views);
+        std::vector<uint8_t> lowIndexes;
+        size_t highFrames = 0;
+        for (const FrameView& view : views) {
+            PacketView packet;
+            CHECK(sender.Deserialize(view.data, view.size, packet) && packet.header.type == THORPacketType::FRAGMENT);
+            if (packet.header.originId == 1) {
+                lowIndexes.push_back(packet.payload[0]);
+            } else {
+                CHECK(lowIndexes.empty()); // The high priority message goes first
+                ++highFrames;
+            }
+            onAir.emplace_back(view.data, view.data + view.size);
+        }
+        CHECK(highFrames > 1 && !lowIndexes.empty() && lowIndexes[0] == 2);
+        for (size_t i = 1; i < lowIndexes.size(); ++i) {
+            CHECK(lowIndexes[i] == lowIndexes[i - 1] + 1);
+        }
+        sender.CommitQueue(frames);
+        CHECK(sender.QueueSize() == 0);
+
+        size_t delivered = 0;
+        for (const std::vector<uint8_t>& frame : onAir) {
+            PacketView view;
+            THORVerdict verdict;
+            destination.HandleData(frame.data(), frame.size(), view, 3, out, sizeof(out), verdict);
+            if (verdict == THORVerdict::DELIVER) {
+                ++delivered;
+                const std::vector<uint8_t>& message = view.header.originId == 1 ? low : high;
+                CHECK(view.payloadSize == message.size() && std::memcmp(view.payload, message.data(), message.size()) == 0);
+            }
+        }
+        CHECK(delivered == 2);
+
+        // Per frame commits keep the cursor too: the third fragment is refused, the rest resend from it
+        CHECK(sender.SendPacket(3, 1, 1, 43, low.data(), low.size(), out, sizeof(out)) == 0);
+        CHECK(sender.DrainQueue(4, 0, views) == 4);
+        sender.CommitQueue(std::vector<bool>{ true, true, false, true });
+        CHECK(sender.DrainQueue(1, 0, views) == 1);
+        PacketView packet;
+        CHECK(sender.Deserialize(views[0].data, views[0].size, packet) && packet.payload[0] == 2);
+    }
+
+    void CheckDuplicateCache()
+    {
+        DuplicateCache cache(4, 100);
+        CHECK(!cache.CheckAndInsert(9, 1, 1000));
+        CHECK(cache.CheckAndInsert(9, 1, 1050));   // Repeat within the age limit
+        CHECK(!cache.CheckAndInsert(9, 1, 1101));  // Aged out: accepted again
+        CHECK(cache.Hits() == 1 && cache.Misses() == 2);
+
+        // Ring wrap: a fifth key evicts the oldest, the other three stay
+        for (uint32_t sequence = 2; sequence <= 5; ++sequence) {
+            CHECK(!cache.CheckAndInsert(9, sequence, 1102));
+        }
+        CHECK(cache.Size() == 4);
+        CHECK(!cache.CheckAndInsert(9, 1, 1103)); // Evicted by sequence 5
+        for (uint32_t lap = 0; lap < 3; ++lap) {
+            for (uint32_t sequence = 10; sequence < 14; ++sequence) {
+                CHECK(!cache.CheckAndInsert(9 + lap, sequence, 1104));
+            }
+            for (uint32_t sequence = 10; sequence < 14; ++sequence) {
+                CHECK(cache.CheckAndInsert(9 + lap, sequence, 1104));
+            }
+        }
+
+        // Fragment keys: part 0 is the whole packet, 1..256 the fragments
+        DuplicateCache parts(8, 100);
+        CHECK(!parts.CheckAndInsert(9, 7, 1000, 0));
+        CHECK(!parts.CheckAndInsert(9, 7, 1000, 256));
+        CHECK(!parts.CheckAndInsert(9, 7, 1000, 1));
+        CHECK(parts.CheckAndInsert(9, 7, 1000, 256));
+
+        // Own sends: no clock, stamped at the next lookup, then aged out like the rest
+        DuplicateCache own(4, 100);
+        own.Record(5, 1);
+        own.Record(5, 1);
+        CHECK(own.Size() == 1 && own.Hits() == 0 && own.Misses() == 0);
+        CHECK(own.CheckAndInsert(5, 1, 5000));    // Looped back
+        CHECK(own.CheckAndInsert(5, 1, 5100));
+        CHECK(!own.CheckAndInsert(5, 1, 5101));
+        for (uint32_t sequence = 2; sequence < 8; ++sequence) {
+            own.Record(5, sequence);              // Wraps the ring before any stamp
+        }
+        CHECK(own.Size() == 4);
+        CHECK(own.CheckAndInsert(5, 7, 9000) && own.CheckAndInsert(5, 4, 9000));
+        CHECK(!own.CheckAndInsert(5, 3, 9000));
+
+        // Through the node: fragment 255 and the whole packet are different frames
+        THOR node(TestConfig());
+        std::vector<uint8_t> whole = DataFrame(node, 1, 9, 40, 15);
+        std::vector<uint8_t> fragment = whole;
+        fragment[0] = static_cast<uint8_t>(THORPacketType::FRAGMENT);
+        fragment[WIRE_HEADER_SIZE] = 255;     // index
+        fragment[WIRE_HEADER_SIZE + 1] = 0;   // count: malformed, but only after the duplicate check
+        uint8_t out[64];
+        PacketView view;
+        THORVerdict verdict;
+        node.HandleData(whole.data(), whole.size(), view, 1, out, sizeof(out), verdict);
+        CHECK(verdict == THORVerdict::DELIVER);
+        node.HandleData(fragment.data(), fragment.size(), view, 1, out, sizeof(out), verdict);
+        CHECK(node.DuplicateHits() == 0);
+        node.HandleData(fragment.data(), fragment.size(), view, 1, out, sizeof(out), verdict);
+        CHECK(node.DuplicateHits() == 1);
+
+        // A loop back to the origin: its own send comes back through a relay
+        node.NeighborStore(3, -60, true, false, false);
+        std::vector<uint8_t> payload(8, 1);
+        std::vector<uint8_t> sent = node.SendPacket(77, 1, 1, 41, payload);
+        CHECK(!sent.empty());
+        sent[1 + 1 + 4] = 3;                  // senderId: the relay
+        node.HandleData(sent.data(), sent.size(), view, 1, out, sizeof(out), verdict);
+        CHECK(verdict == THORVerdict::DROP && node.DuplicateHits() == 2);
+    }
+
+    bool PushPacket(PacketQueue& queue, uint32_t originId, uint32_t sequence, uint8_t ttl)
+    {
+        Header header = {};
+        header.type = THORPacketType::DATA;
+        header.flagsAndTTL.ttl = ttl;
+        header.originId = originId;
+        header.sequence = sequence;
+        uint8_t payload[10] = {};
+        return queue.Push(header, payload, sizeof(payload));
+    }
+
+    std::vector<uint32_t> QueuedSequences(PacketQueue& queue)
+    {
+        std::vector<uint32_t> sequences;
+        for (size_t i = 0; i < queue.Size(); ++i) {
+            Header header;
+            DecodeHeader(queue.Frame(i), header);
+            sequences.push_back(static_cast<uint32_t>(header.sequence)); // Header is packed: no reference to it
+        }
+        return sequences;
+    }
+
+    // Which packet a full queue gives up, per QueueEviction, and what it never touches
+    void CheckEvictionPolicies()
+    {
+        const size_t frameSize = WIRE_HEADER_SIZE + 10;
+        {
+            PacketQueue queue(3, 0, 32, QueueOrder::ARRIVAL, QueueEviction::REJECT_NEW);
+            for (uint32_t i = 0; i < 3; ++i) {
+                CHECK(PushPacket(queue, 1, i, 10));
+            }
+            CHECK(!PushPacket(queue, 1, 3, 10));
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 0, 1, 2 }));
+            CHECK(queue.Stats().rejected == 1 && queue.Stats().evicted == 0);
+        }
+        {
+            PacketQueue queue(3, 0, 32, QueueOrder::ARRIVAL, QueueEviction::DROP_OLDEST);
+            for (uint32_t i = 0; i < 3; ++i) {
+                CHECK(PushPacket(queue, 1, i, 10));
+            }
+            CHECK(PushPacket(queue, 1, 3, 10));
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 1, 2, 3 }));
+            queue.SetInFlight(1); // The radio holds 1: the oldest one it does not hold goes
+            CHECK(PushPacket(queue, 1, 4, 10));
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 1, 3, 4 }));
+            queue.SetInFlight(3); // Everything in flight: nothing to evict
+            CHECK(!PushPacket(queue, 1, 5, 10));
+            CHECK(queue.Stats().evicted == 2 && queue.Stats().rejected == 1);
+        }
+        {
+            // The byte budget evicts the same way as the slot count
+            PacketQueue queue(8, 2 * frameSize, 32, QueueOrder::ARRIVAL, QueueEviction::DROP_OLDEST);
+            for (uint32_t i = 0; i < 3; ++i) {
+                CHECK(PushPacket(queue, 1, i, 10));
+            }
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 1, 2 }) && queue.Bytes() == 2 * frameSize);
+        }
+        {
+            PacketQueue queue(3, 0, 32, QueueOrder::ARRIVAL, QueueEviction::DROP_LOWEST_TTL);
+            CHECK(PushPacket(queue, 1, 0, 5));
+            CHECK(PushPacket(queue, 1, 1, 2));
+            CHECK(PushPacket(queue, 1, 2, 9));
+            CHECK(PushPacket(queue, 1, 3, 4)); // Drops the TTL 2 packet
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 0, 2, 3 }));
+            CHECK(!PushPacket(queue, 1, 4, 3)); // Fewer hops left than any queued one
+            CHECK(PushPacket(queue, 1, 5, 4)); // Ties go to the oldest
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 0, 2, 5 }));
+            CHECK(queue.Stats().evicted == 2 && queue.Stats().rejected == 1);
+        }
+        {
+            PacketQueue queue(3, 0, 32, QueueOrder::ARRIVAL, QueueEviction::FAIR_SHARE);
+            CHECK(PushPacket(queue, 7, 0, 10));
+            CHECK(PushPacket(queue, 7, 1, 10));
+            CHECK(PushPacket(queue, 8, 2, 10));
+            CHECK(PushPacket(queue, 9, 3, 10)); // Origin 7 holds the most: its oldest goes
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 1, 2, 3 }));
+            CHECK(PushPacket(queue, 8, 4, 10)); // The newcomer counts for its origin: 8 now holds two
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 1, 3, 4 }));
+            CHECK(PushPacket(queue, 5, 5, 10)); // One each: the oldest overall
+            CHECK((QueuedSequences(queue) == std::vector<uint32_t>{ 3, 4, 5 }));
+            CHECK(queue.Stats().evicted == 3);
+        }
+    }
+
+    // Sequence numbers of a drain, in hand-out order
+    std::vector<uint32_t> FrameSequences(THOR& node, const std::vector<FrameView>& views)
+    {
+        std::vector<uint32_t> sequences;
+        for (const FrameView& view : views) {
+            PacketView packet;
+            CHECK(node.Deserialize(view.data, view.size, packet));
+            sequences.push_back(static_cast<uint32_t>(packet.header.sequence));
+        }
+        return sequences;
+    }
+
+    // Budgeted drains: uncommitted frames come back first, in-flight ones stay pinned,
+    // a commit removes only what the radio took
+    void CheckDrainAndCommit()
+    {
+        THORConfig config = TestConfig();
+        config.queueCapacity = 4;
+        config.queueEviction = QueueEviction::DROP_OLDEST;
+        config.queueOrder = QueueOrder::ORIGIN_PRIORITY;
+        THOR node(config);
+        std::vector<uint8_t> payload(10, 1);
+        for (uint32_t i = 0; i < 4; ++i) {
+            CHECK(node.SendPacket(77, 1, 5, i, payload).empty()); // No neighbors: queued
+        }
+        node.NeighborStore(9, -60, true, false, false);
+        std::vector<FrameView> views;
+        CHECK(node.DrainQueue(2, 0, views) == 2);
+        CHECK((FrameSequences(node, views) == std::vector<uint32_t>{ 0, 1 }));
+        PacketView packet;
+        CHECK(node.Deserialize(views[0].data, views[0].size, packet) && packet.header.nextHopId == 9);
+
+        // No commit: the next drain starts over, and the byte budget counts whole frames
+        CHECK(node.DrainQueue(0, 2 * views[0].size, views) == 2);
+        CHECK(node.DrainQueue(3, 0, views) == 3);
+        CHECK((FrameSequences(node, views) == std::vector<uint32_t>{ 0, 1, 2 }));
+
+        // While 0..2 are in flight, the neighbor goes away and a higher priority packet
+        // arrives on a full queue: it evicts the one packet not in flight and queues behind them
+        now += config.neighborTimeoutMs + 1000; // Past the wheel tick it expires on
+        node.RemoveOld();
+        node.SetOriginPriority(6, 9);
+        CHECK(node.SendPacket(77, 1, 6, 100, payload).empty());
+        CHECK(node.QueueSize() == 4 && node.GetQueueStats().evicted == 1);
+
+        node.NeighborStore(9, -60, true, false, false);
+        node.CommitQueue(2); // The radio took two of the three
+        CHECK(node.QueueSize() == 2);
+        CHECK(node.DrainQueue(0, 0, views) == 2);
+        CHECK((FrameSequences(node, views) == std::vector<uint32_t>{ 2, 100 }));
+        node.CommitQueue(0); // Aborted: nothing leaves
+        CHECK(node.QueueSize() == 2);
+        CHECK(node.ProcessQueue(views) == 2 && node.QueueSize() == 0);
+        node.CommitQueue(1); // Nothing in flight any more: a stray commit is harmless
+        CHECK(node.QueueSize() == 0);
+    }
+
+    // Load spreading: a drain goes round the best spreadNeighbors hops by score, and a
+    // hop that advertised few credits takes no more than those
+    void CheckSpreadWithCredits()
+    {
+        THORConfig config = TestConfig();
+        config.spreadNeighbors = 3;
+        THOR node(config);
+        std::vector<uint8_t> payload(10, 1);
+        for (uint32_t i = 0; i < 9; ++i) {
+            CHECK(node.SendPacket(77, 1, 1, i, payload).empty());
+        }
+        node.NeighborStore(2, -60, true, false, false);  // 350
+        node.NeighborStore(3, -60, false, true, false);  // 250
+        node.NeighborStore(4, -45, true, false, false);  // 250
+        node.NeighborStore(5, -60, false, false, false); // 150: not in the top three
+        std::vector<FrameView> views;
+        CHECK(node.DrainQueue(0, 0, views) == 9);
+        size_t perHop[6] = {};
+        for (const FrameView& view : views) {
+            PacketView packet;
+            CHECK(node.Deserialize(view.data, view.size, packet) && packet.header.nextHopId < 6);
+            ++perHop[packet.header.nextHopId < 6 ? packet.header.nextHopId : 0];
+        }
+        CHECK(perHop[2] + perHop[3] + perHop[4] == 9 && perHop[5] == 0);
+        CHECK(perHop[2] >= perHop[3] && perHop[2] >= perHop[4] && perHop[3] > 0 && perHop[4] > 0);
+        node.CommitQueue(0);
+
+        // Hop 2 hears from a peer with two free slots: it may take two frames per advertisement
+        THORConfig peerConfig = TestConfig();
+        peerConfig.queueCapacity = 2;
+        THOR peer(peerConfig);
+        Header hello;
+        CHECK(node.HandleHello(peer.CreateHello(0, 2, 2, 1), hello));
+        node.NeighborStore(2, -60, true, false, false);
+        size_t frames = node.DrainQueue(0, 0, views);
+        size_t toCredited = 0;
+        for (const FrameView& view : views) {
+            PacketView packet;
+            CHECK(node.Deserialize(view.data, view.size, packet));
+            toCredited += packet.header.nextHopId == 2 ? 1 : 0;
+        }
+        CHECK(frames > 0 && toCredited <= 2);
+        node.CommitQueue(frames);
+
+        // Out of credits: it leaves the spread set until it advertises again
+        if (node.QueueSize() > 0) {
+            CHECK(node.DrainQueue(0, 0, views) > 0);
+            for (const FrameView& view : views) {
+                PacketView packet;
+                CHECK(node.Deserialize(view.data, view.size, packet) && packet.header.nextHopId != 2);
+            }
+        }
+        CHECK(toCredited == 2 && node.QueueSize() > 0);
+    }
+
+    bool Knows(const THOR& node, uint32_t nodeId)
+    {
+        NeighborInfo info;
+        return node.GetNeighbor(nodeId, info);
+    }
+
+    // Neighbor expiry on the timer wheel (64 buckets over one timeout, here 100 ms each)
+    void CheckNeighborWheel()
+    {
+        THORConfig config = TestConfig();
+        config.neighborTimeoutMs = 6400;
+        THOR node(config);
+        const uint64_t start = now;
+        node.NeighborStore(2, -60, true, false, false);
+        node.NeighborStore(3, -60, true, false, false);
+        node.RemoveOld();
+
+        // A HELLO from 2 halfway through pushes its expiry back; 3 goes on time
+        now = start + 3200;
+        node.NeighborStore(2, -60, true, false, false);
+        node.RemoveOld();
+        now = start + 6400 + 200;
+        node.RemoveOld();
+        CHECK(Knows(node, 2) && !Knows(node, 3));
+        now = start + 3200 + 6400 - 100; // Not yet
+        node.RemoveOld();
+        CHECK(Knows(node, 2));
+        now = start + 3200 + 6400 + 200;
+        node.RemoveOld();
+        CHECK(!Knows(node, 2) && node.NeighborCount() == 0);
+
+        // 4 is heard every 3 s for three rotations of the wheel and never expires;
+        // 5, stored a rotation and a half in, lands in a bucket already passed once
+        uint64_t base = now;
+        node.NeighborStore(4, -60, true, false, false);
+        for (uint64_t t = 100; t <= 3 * 6400; t += 100) {
+            now = base + t;
+            if (t % 3000 == 0) {
+                node.NeighborStore(4, -60, true, false, false);
+            }
+            if (t == 9600) {
+                node.NeighborStore(5, -60, true, false, false);
+            }
+            node.RemoveOld();
+            CHECK(Knows(node, 4));
+            CHECK(Knows(node, 5) == (t >= 9600 && t <= 9600 + 6400));
+        }
+
+        // One Expire more than 64 ticks after the last: every bucket is visited once,
+        // the overdue neighbor goes and the one heard during the gap stays
+        base = now;
+        node.NeighborStore(6, -60, true, false, false);
+        node.RemoveOld();
+        now = base + 9000;
+        node.NeighborStore(7, -60, true, false, false);
+        now = base + 2 * 6400 + 50; // 128 ticks since the last RemoveOld
+        node.RemoveOld();
+        CHECK(!Knows(node, 4) && !Knows(node, 6) && Knows(node, 7));
+        now = base + 9000 + 6400 + 200;
+        node.RemoveOld();
+        CHECK(!Knows(node, 7) && node.NeighborCount() == 0);
+    }
+
+    // Learned link quality: failures push a neighbor below an equal one, and the
+    // history fades back to neutral with the half-life
+    void CheckLinkQuality()
+    {
+        THORConfig config = TestConfig();
+        config.linkDecayMs = 1000;
+        THOR node(config);
+        node.NeighborStore(2, -60, true, false, false);
+        node.NeighborStore(3, -60, true, false, false);
+        CHECK(node.GetBestNextHop() == 2); // Equal scores: lowest id
+
+        for (int i = 0; i < 4; ++i) {
+            node.RecordDelivery(2, false);
+            node.RecordDelivery(3, true);
+        }
+        NeighborInfo failing;
+        NeighborInfo working;
+        CHECK(node.GetNeighbor(2, failing) && node.GetNeighbor(3, working));
+        CHECK(failing.link.delivery < LINK_DELIVERY_NEUTRAL && working.link.delivery > LINK_DELIVERY_NEUTRAL);
+        CHECK(failing.link.samples == 4);
+        CHECK(node.GetBestNextHop() == 3);
+
+        // One half-life: half the deviation is left (a HELLO applies it)
+        now += 1000;
+        node.NeighborStore(2, -60, true, false, false);
+        NeighborInfo halved;
+        CHECK(node.GetNeighbor(2, halved));
+        CHECK(halved.link.delivery == LINK_DELIVERY_NEUTRAL - (LINK_DELIVERY_NEUTRAL - failing.link.delivery) / 2);
+        CHECK(halved.link.samples == 2);
+
+        // Sixteen: forgotten, both links neutral again and the tie is back
+        now += 16 * 1000;
+        node.NeighborStore(2, -60, true, false, false);
+        node.NeighborStore(3, -60, true, false, false);
+        CHECK(node.GetNeighbor(2, failing) && node.GetNeighbor(3, working));
+        CHECK(failing.link.delivery == LINK_DELIVERY_NEUTRAL && working.link.delivery == LINK_DELIVERY_NEUTRAL);
+        CHECK(failing.link.samples == 0);
+        CHECK(node.GetBestNextHop() == 2);
+    }
+
+    // Per-destination routes: learned from a relayed ACK, used over internet gravity,
+    // refreshed by the next ACK, ignored once older than routeTimeoutMs
+    void CheckRouteAging()
+    {
+        THORConfig config = TestConfig();
+        config.routeTimeoutMs = 5000;
+        THOR node(config);
+        THOR relay(TestConfig());
+        node.NeighborStore(2, -60, true, false, false);  // Gravity's pick
+        node.NeighborStore(3, -60, false, false, false);
+        CHECK(node.GetBestNextHop(50) == 2);
+
+        Header ack;
+        CHECK(node.HandleAck(relay.CreateACK(1, 3, 50, 1, 9, false, false), ack)); // 50 answered through 3
+        CHECK(node.GetBestNextHop(50) == 3 && node.GetBestNextHop(51) == 2);
+        CHECK(node.GetBestNextHop(3) == 3); // A neighbor is its own route
+
+        now += 4000;
+        CHECK(node.HandleAck(relay.CreateACK(1, 3, 50, 1, 10, false, false), ack)); // Refreshed
+        now += 4000;
+        node.NeighborStore(3, -60, false, false, false);
+        CHECK(node.GetBestNextHop(50) == 3);
+        now += 1001; // 5001 ms since the last ACK
+        node.NeighborStore(2, -60, true, false, false);
+        node.NeighborStore(3, -60, false, false, false);
+        CHECK(node.GetBestNextHop(50) == 2);
+        const RouteStats& stats = node.GetRouteStats();
+        CHECK(stats.learned == 2 && stats.hits == 2);
+
+        // A route through a neighbor that went away is dropped, not used
+        CHECK(node.HandleAck(relay.CreateACK(1, 3, 50, 1, 11, false, false), ack));
+        now += config.neighborTimeoutMs + 1000;
+        node.NeighborStore(2, -60, true, false, false);
+        node.RemoveOld();
+        CHECK(node.GetBestNextHop(50) == 2);
+    }
+
+    // Queue lifetimes and supersede classes
+    void CheckQueueExpiryAndSupersede()
+    {
+        THORConfig config = TestConfig();
+        config.queueLifetimeMs = 10000;
+        THOR node(config);
+        uint8_t payload[10] = {};
+        uint8_t out[64];
+        const uint64_t start = now;
+        QueueOptions shortLived;
+        shortLived.lifetimeMs = 2000;
+        CHECK(node.SendPacket(77, 1, 5, 1, payload, sizeof(payload), out, sizeof(out)) == 0); // No neighbors: queued
+        CHECK(node.SendPacket(77, 1, 5, 2, payload, sizeof(payload), shortLived, out, sizeof(out)) == 0);
+        now = start + 1999;
+        node.RemoveOld();
+        CHECK(node.QueueSize() == 2);
+        now = start + 2000; // Its lifetime is up
+        node.RemoveOld();
+        CHECK(node.QueueSize() == 1 && node.GetQueueStats().expired == 1);
+
+        // Due while in flight: it waits for the commit, then the next drain drops it
+        node.NeighborStore(9, -60, true, false, false);
+        std::vector<FrameView> views;
+        CHECK(node.DrainQueue(0, 0, views) == 1);
+        now = start + 10000;
+        node.RemoveOld();
+        CHECK(node.QueueSize() == 1);
+        node.CommitQueue(0);
+        CHECK(node.DrainQueue(0, 0, views) == 0 && node.QueueSize() == 0 && node.GetQueueStats().expired == 2);
+
+        // A newer beacon of the same origin and class replaces the queued one, queued or sent
+        now += config.neighborTimeoutMs + 1000;
+        node.RemoveOld();
+        CHECK(node.NeighborCount() == 0);
+        QueueOptions location;
+        location.supersede = 1;
+        QueueOptions status;
+        status.supersede = 2;
+        CHECK(node.SendPacket(77, 1, 5, 10, payload, sizeof(payload), location, out, sizeof(out)) == 0);
+        CHECK(node.SendPacket(77, 1, 5, 11, payload, sizeof(payload), status, out, sizeof(out)) == 0);
+        CHECK(node.SendPacket(77, 1, 6, 12, payload, sizeof(payload), location, out, sizeof(out)) == 0);
+        CHECK(node.SendPacket(77, 1, 5, 13, payload, sizeof(payload), location, out, sizeof(out)) == 0);
+        CHECK(node.QueueSize() == 3 && node.GetQueueStats().superseded == 1);
+        node.NeighborStore(9, -60, true, false, false);
+        CHECK(node.SendPacket(77, 1, 6, 14, payload, sizeof(payload), location, out, sizeof(out)) > 0); // Sent
+        CHECK(node.QueueSize() == 2 && node.GetQueueStats().superseded == 2);
+        CHECK(node.ProcessQueue(views) == 2);
+        CHECK((FrameSequences(node, views) == std::vector<uint32_t>{ 11, 13 }));
+    }
+
+    static_assert(std::is_nothrow_move_constructible<THOR>::value && std::is_move_assignable<THOR>::value,
+                  "THOR moves");
+    static_assert(!std::is_copy_constructible<THOR>::value, "THOR owns its queue slab and trace, it does not copy");
+
+    void CheckMoveKeepsState()
+    {
+        THORConfig config = TestConfig();
+        config.traceBytes = 1 << 16;
+        THOR source(config);
+        std::vector<uint8_t> payload(10, 0x5A);
+        source.SendPacket(77, 5, 5, 1, payload); // No neighbors: queued
+
+        THOR node(std::move(source));
+        CHECK(node.QueueSize() == 1);
+        now += 500;
+        StoreNeighbors(node);
+        source = std::move(node); // And back, by assignment
+        std::vector<FrameView> views;
+        CHECK(source.ProcessQueue(views) == 1);
+        PacketView view;
+        CHECK(views.size() == 1 && source.Deserialize(views[0].data, views[0].size, view));
+        CHECK(view.header.sequence == 1 && view.payloadSize == 10 && view.payload[0] == 0x5A);
+
+        // The trace followed the node, and its calls carry their own time
+        std::vector<uint8_t> trace;
+        source.SnapshotTrace(trace);
+        TraceReader reader;
+        CHECK(reader.Open(trace.data(), trace.size()));
+        TraceRecord record;
+        uint64_t lastMs = 0;
+        while (reader.Next(record)) {
+            lastMs = record.timeMs;
+        }
+        CHECK(lastMs == now);
+        ReplayResult result;
+        CHECK(ReplayTrace(trace.data(), trace.size(), true, result) && result.mismatches == 0);
+    }
+
+#ifdef THOR_TEST_FORK
+    // Runs 'body' in a child that exits without destructors or msync, like a killed app
+    template <typename Body>
+    bool RunAndDie(Body body)
+    {
+        pid_t child = fork();
+        if (child == 0) {
+            body();
+            _exit(0);
+        }
+        int status = 0;
+        return child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status);
+    }
+
+    std::string TempPath(const char* name)
+    {
+        const char* dir = std::getenv("TMPDIR");
+        std::string path = std::string(dir != nullptr ? dir : "/tmp") + "/" + name + "." + std::to_string(getpid());
+        unlink(path.c_str());
+        return path;
+    }
+
+    void CheckQueueSurvivesCrash()
+    {
+        THORConfig config = TestConfig();
+        config.queueFile = TempPath("thor_core_behavior_queue");
+        config.queueCapacity = 8;
+        config.maxPayload = 32;
+        CHECK(RunAndDie([&config] {
+            THOR node(config); // No neighbors: everything is queued
+            for (uint32_t i = 0; i < 5; ++i) {
+                std::vector<uint8_t> payload(10, static_cast<uint8_t>(i));
+                node.SendPacket(77, 5, 5, 100 + i, payload);
+            }
+        }));
+
+        THOR node(config);
+        CHECK(node.QueuePersistent());
+        CHECK(node.QueueSize() == 5);
+        node.NeighborStore(9, -60, true, false, false);
+        std::vector<FrameView> views;
+        size_t frames = node.ProcessQueue(views);
+        CHECK(frames == 5);
+        for (size_t i = 0; i < frames && i < views.size(); ++i) {
+            PacketView view;
+            CHECK(node.Deserialize(views[i].data, views[i].size, view));
+            CHECK(view.header.sequence == 100 + i && view.header.nextHopId == 9); // Arrival order, routed afresh
+            CHECK(view.payloadSize == 10 && view.payload[0] == i);
+        }
+        unlink(config.queueFile.c_str());
+    }
+
+    void CheckMovedQueueFile()
+    {
+        THORConfig config = TestConfig();
+        config.queueFile = TempPath("thor_core_behavior_moved");
+        config.queueCapacity = 4;
+        config.maxPayload = 32;
+        {
+            THOR source(config);
+            std::vector<uint8_t> payload(10, 7);
+            source.SendPacket(77, 5, 5, 200, payload);
+            THOR node(std::move(source)); // The mapping moves; the source must not unmap it
+            CHECK(node.QueuePersistent() && node.QueueSize() == 1);
+            source = THOR(TestConfig());
+            node.SendPacket(77, 5, 5, 201, payload);
+        }
+
+        THOR node(config);
+        CHECK(node.QueueSize() == 2);
+        node.NeighborStore(9, -60, true, false, false);
+        std::vector<FrameView> views;
+        CHECK(node.ProcessQueue(views) == 2);
+        unlink(config.queueFile.c_str());
+    }
+
+    void CheckTornSlotIsDropped()
+    {
+        std::string path = TempPath("thor_core_behavior_slab");
+        Header header = {};
+        header.type = THORPacketType::DATA;
+        header.flagsAndTTL.ttl = 15;
+        CHECK(RunAndDie([&path, &header] {
+            PacketSlab slab(4, 16, path);
+            for (uint32_t i = 0; i < 3; ++i) {
+                long slot = slab.Acquire();
+                header.sequence = i;
+                EncodeHeader(header, slab.Frame(static_cast<size_t>(slot)));
+                if (i != 1) {
+                    slab.Commit(static_cast<size_t>(slot), WIRE_HEADER_SIZE, i); // Slot 1 dies half written
+                }
+            }
+        }));
+
+        PacketSlab slab(4, 16, path);
+        CHECK(slab.Persistent());
+        const std::vector<std::pair<uint64_t, uint32_t>>& recovered = slab.Recovered();
+        CHECK(recovered.size() == 2);
+        CHECK(slab.InUse() == 2);
+        for (const auto& entry : recovered) {
+            Header back;
+            DecodeHeader(slab.Frame(entry.second), back);
+            CHECK(entry.first != 1 && back.sequence == entry.first);
+        }
+        unlink(path.c_str());
+    }
+
+    // The queue file is the same bytes on every host: little-endian header and records
+    void CheckSlabFileLayout()
+    {
+        std::string path = TempPath("thor_core_behavior_layout");
+        {
+            PacketSlab slab(2, 16, path);
+            long slot = slab.Acquire();
+            std::memset(slab.Frame(static_cast<size_t>(slot)), 0, WIRE_HEADER_SIZE);
+            slab.Commit(static_cast<size_t>(slot), WIRE_HEADER_SIZE, 0x0102030405060708ull);
+        }
+        std::vector<uint8_t> file(64 + 2 * 16);
+        std::FILE* in = std::fopen(path.c_str(), "rb");
+        CHECK(in != nullptr && std::fread(file.data(), 1, file.size(), in) == file.size());
+        if (in != nullptr) {
+            std::fclose(in);
+        }
+        const uint8_t magic[] = { 'T', 'H', 'Q', '1', 1, 0, 0, 0, 2, 0, 0, 0, WIRE_HEADER_SIZE + 16, 0, 0, 0 };
+        CHECK(std::memcmp(file.data(), magic, sizeof(magic)) == 0);
+        const uint8_t record[] = { 8, 7, 6, 5, 4, 3, 2, 1, WIRE_HEADER_SIZE, 0, 0, 0 };
+        CHECK(std::memcmp(file.data() + 64, record, sizeof(record)) == 0);
+
+        PacketSlab slab(2, 16, path);
+        CHECK(slab.Recovered().size() == 1 && slab.Recovered()[0].first == 0x0102030405060708ull);
+        unlink(path.c_str());
+    }
+#endif
+}
+
+int main()
+{
+    CheckBatchMatchesSingle();
+    CheckReassemblyPool();
+    CheckFragmentsEndToEnd();
+    CheckFragmentsResumeAfterReorder();
+    CheckDuplicateCache();
+    CheckNeighborWheel();
+    CheckLinkQuality();
+    CheckRouteAging();
+    CheckEvictionPolicies();
+    CheckDrainAndCommit();
+    CheckSpreadWithCredits();
+    CheckQueueExpiryAndSupersede();
+    CheckMoveKeepsState();
+#ifdef THOR_TEST_FORK
+    CheckQueueSurvivesCrash();
+    CheckMovedQueueFile();
+    CheckTornSlotIsDropped();
+    CheckSlabFileLayout();
+#else
+    std::printf("core behavior: crash recovery checks need fork(), skipped\n");
+#endif
+    if (failures != 0) {
+        std::printf("core behavior: %d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("core behavior: OK\n");
+    return 0;
+}